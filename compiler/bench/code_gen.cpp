@@ -0,0 +1,84 @@
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include <codegen/code_gen.hpp>
+#include <codegen/single_pass.hpp>
+#include <parser/lexer.hpp>
+#include <parser/parser.hpp>
+#include <sema/resolver.hpp>
+
+namespace helium {
+namespace {
+
+using ::std::string;
+using ::std::vector;
+
+// a well typed line of a repl session
+string Line(int statements) {
+  string source;
+  for (int i = 0; i < statements; i++) {
+    auto a = "a" + ::std::to_string(i);
+    source += "var " + a + " = (1 + 2 * -3) / 4 - 5\n"
+              "{ var b = { " + a + " * 2 }\n  if (true) { -b + 1 } else { b - 1 } }\n"
+              "while (false) " + a + " = " + a + " - 1\n";
+  }
+
+  return source;
+}
+
+// parses, checks, resolves and generates code one after another
+void BM_CompilePipeline(benchmark::State& state) {
+  const auto source = Line(static_cast<int>(state.range(0)));
+  vector<uint8_t> code;
+
+  for (auto _ : state) {
+    code.clear();
+    ErrorReporter reporter("");
+    Interner interner;
+    ConstantPool constants;
+    auto ast = Parser::Parse(Lexer::Lex(source), reporter, interner, constants);
+    TypeContext types(interner);
+    TypeCheck check(reporter, types);
+    for (auto* node : ast) node->Accept(check);
+    Resolver resolver;
+    for (auto* node : ast) resolver.Resolve(*node);
+    CodeGen::Generate(ast, interner, constants, code);
+    if (reporter.HadErrors()) state.SkipWithError("errors");
+    benchmark::DoNotOptimize(code.data());
+  }
+
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * source.size()));
+}
+
+void BM_CompileSinglePass(benchmark::State& state) {
+  const auto source = Line(static_cast<int>(state.range(0)));
+  vector<uint8_t> code;
+
+  for (auto _ : state) {
+    code.clear();
+    ErrorReporter reporter("");
+    Interner interner;
+    ConstantPool constants;
+    if (!SinglePass::Compile(source, reporter, interner, constants, code)) {
+      state.SkipWithError("errors");
+    }
+    benchmark::DoNotOptimize(code.data());
+  }
+
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * source.size()));
+}
+
+BENCHMARK(BM_CompilePipeline)
+    ->ArgName("statements")
+    ->Arg(1)
+    ->Arg(1000)
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_CompileSinglePass)
+    ->ArgName("statements")
+    ->Arg(1)
+    ->Arg(1000)
+    ->Unit(benchmark::kMicrosecond);
+
+}
+}
@@ -0,0 +1,232 @@
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include <compiler.hpp>
+#include <parser/ast_printer.hpp>
+#include <parser/document.hpp>
+#include <parser/flat_ast.hpp>
+#include <parser/lexer.hpp>
+#include <parser/parser.hpp>
+#include <sema/document_check.hpp>
+#include <sema/type_check.hpp>
+#include <sema/type_context.hpp>
+#include "generator.hpp"
+
+// Every stage of the front end on the programs of ProgramGenerator.
+// The results have the throughput in bytes of source and in nodes of
+// its tree per second, run with --benchmark_format=json or build the
+// compiler-bench-json target to get them as json
+
+namespace helium {
+namespace {
+
+using ::std::string;
+using ::std::vector;
+
+constexpr uint32_t kSeed = 2019;
+
+// discards the output, but it is still formatted
+class NullBuffer final : public std::streambuf {
+  char buffer_[1 << 12];
+
+ public:
+  NullBuffer() { setp(buffer_, buffer_ + sizeof(buffer_)); }
+
+ protected:
+  int overflow(int c) override {
+    setp(buffer_, buffer_ + sizeof(buffer_));
+    return traits_type::not_eof(c);
+  }
+};
+
+struct Program {
+  string source;
+  ErrorReporter reporter;
+  Interner interner;
+  ConstantPool constants;
+  TypeContext types;
+  AstTree ast;
+  size_t nodes;
+
+  explicit Program(const benchmark::State& state)
+  : source(ProgramGenerator(kSeed).Generate(static_cast<Shape>(state.range(0)),
+                                            static_cast<int>(state.range(1)))),
+    reporter(""),
+    types(interner),
+    ast(Parser::Parse(source, reporter, interner, constants)),
+    nodes(FlatAst::From(ast).Size()) {
+    TypeCheck check(reporter, types);
+    for (auto* node : ast) node->Accept(check);
+  }
+
+  // reports the throughput, the program must be well typed
+  void Report(benchmark::State& state) {
+    if (reporter.HadErrors()) state.SkipWithError("the program has errors");
+
+    state.SetLabel(ShapeName(static_cast<Shape>(state.range(0))));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * source.size()));
+    state.counters["nodes"] = benchmark::Counter(
+        static_cast<double>(nodes), benchmark::Counter::kIsIterationInvariantRate);
+  }
+};
+
+void BM_FrontEndLex(benchmark::State& state) {
+  Program program(state);
+  for (auto _ : state) {
+    auto tokens = Lexer::Lex(program.source);
+    benchmark::DoNotOptimize(tokens.Size());
+  }
+
+  program.Report(state);
+}
+
+void BM_FrontEndParse(benchmark::State& state) {
+  Program program(state);
+  const auto tokens = Lexer::Lex(program.source);
+  for (auto _ : state) {
+    ErrorReporter reporter("");
+    Interner interner;
+    ConstantPool constants;
+    auto ast = Parser::Parse(tokens, reporter, interner, constants);
+    benchmark::DoNotOptimize(ast.size());
+  }
+
+  program.Report(state);
+}
+
+void BM_FrontEndTypeCheck(benchmark::State& state) {
+  Program program(state);
+  for (auto _ : state) {
+    TypeContext types(program.interner);
+    TypeCheck check(program.reporter, types);
+    for (auto* node : program.ast) node->Accept(check);
+  }
+
+  program.Report(state);
+}
+
+// the units of a module on a number of threads
+void BM_FrontEndTypeCheckParallel(benchmark::State& state) {
+  Program program(state);
+  const auto threads = static_cast<size_t>(state.range(2));
+  for (auto _ : state) {
+    TypeContext types(program.interner);
+    TypeCheck::CheckParallel(program.ast, program.reporter, types, threads);
+  }
+
+  program.Report(state);
+}
+
+// a literal in the middle of a module is edited and checked, see
+// BM_FrontEndTypeCheck for checking all of it
+void BM_FrontEndDocumentCheck(benchmark::State& state) {
+  Program program(state);
+  Document document(program.source);
+  DocumentCheck check("");
+  check.Check(document);
+
+  const auto middle = "var d" + std::to_string(state.range(1) / 2) + " = {";
+  const auto offset = static_cast<uint32_t>(program.source.find(
+      "= ", program.source.find(middle) + middle.size()) + 2);
+  const string digit(1, program.source[offset]);
+
+  size_t rechecked = 0;
+  for (auto _ : state) {
+    document.Apply({offset, 1, digit == "7" ? "8" : "7"});
+    check.Check(document);
+    rechecked += check.Rechecked();
+    document.Apply({offset, 1, digit});
+    check.Check(document);
+    rechecked += check.Rechecked();
+  }
+
+  if (check.HadErrors()) state.SkipWithError("the program has errors");
+  state.SetLabel(ShapeName(static_cast<Shape>(state.range(0))));
+  state.counters["rechecked"] = static_cast<double>(rechecked) / (2 * state.iterations());
+}
+
+// the identifiers of the program, as the parser interns them
+void BM_FrontEndIntern(benchmark::State& state) {
+  Program program(state);
+  const auto tokens = Lexer::Lex(program.source);
+  vector<size_t> identifiers;
+  for (size_t i = 0; i < tokens.Size(); i++) {
+    if (tokens.Type(i) == TokenType::kIdentifier) identifiers.push_back(i);
+  }
+
+  for (auto _ : state) {
+    Interner interner;
+    for (auto i : identifiers) {
+      benchmark::DoNotOptimize(interner.Intern(tokens.Lexeme(i), tokens.Hash(i)));
+    }
+  }
+
+  program.Report(state);
+  state.counters["identifiers"] = static_cast<double>(identifiers.size());
+}
+
+void BM_FrontEndPrint(benchmark::State& state) {
+  Program program(state);
+  NullBuffer buffer;
+  std::ostream os(&buffer);
+  for (auto _ : state) {
+    AstPrinter printer(true, os, program.interner);
+    for (auto* node : program.ast) node->Accept(printer);
+  }
+
+  program.Report(state);
+}
+
+// lexing, parsing, checking, printing and generating code
+void BM_FrontEndFromSource(benchmark::State& state) {
+  Program program(state);
+  NullBuffer buffer;
+  auto* cout = std::cout.rdbuf(&buffer);
+
+  vector<uint8_t> code;
+  for (auto _ : state) {
+    code.clear();
+    if (Compiler::FromSource(program.source, code)) {
+      state.SkipWithError("the program has errors");
+      break;
+    }
+  }
+
+  std::cout.rdbuf(cout);
+  program.Report(state);
+}
+
+// every shape at a small and a large size
+void Programs(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({"shape", "size"});
+  for (int shape = 0; shape < kShapes; shape++) {
+    benchmark->Args({shape, 1000});
+    benchmark->Args({shape, 10000});
+  }
+}
+
+// a large module on a growing number of threads
+void Threads(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({"shape", "size", "threads"});
+  for (int threads : {1, 2, 4, 8}) {
+    benchmark->Args({static_cast<int>(Shape::kModule), 10000, threads});
+  }
+}
+
+BENCHMARK(BM_FrontEndLex)->Apply(Programs)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_FrontEndParse)->Apply(Programs)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_FrontEndTypeCheck)->Apply(Programs)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_FrontEndTypeCheckParallel)->Apply(Threads)->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_FrontEndDocumentCheck)
+    ->ArgNames({"shape", "size"})
+    ->Args({static_cast<int>(Shape::kModule), 10000})
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_FrontEndIntern)->Apply(Programs)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_FrontEndPrint)->Apply(Programs)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_FrontEndFromSource)->Apply(Programs)->Unit(benchmark::kMicrosecond);
+
+}
+}
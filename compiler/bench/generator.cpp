@@ -0,0 +1,175 @@
+#include <vector>
+#include "generator.hpp"
+
+namespace helium {
+
+using ::std::string;
+using ::std::to_string;
+
+namespace {
+
+constexpr int kChainLength = 100;
+constexpr int kModuleGroups = 64;
+
+}
+
+const char* ShapeName(Shape shape) {
+  switch (shape) {
+    case Shape::kDeep: return "deep";
+    case Shape::kWide: return "wide";
+    case Shape::kVariables: return "variables";
+    case Shape::kArithmetic: return "arithmetic";
+    case Shape::kModule: return "module";
+  }
+
+  return "";
+}
+
+string ProgramGenerator::Generate(Shape shape, int size) {
+  source_.clear();
+  switch (shape) {
+    case Shape::kDeep:
+      Deep(size);
+      break;
+    case Shape::kWide:
+      Wide(size);
+      break;
+    case Shape::kVariables:
+      Variables(size);
+      break;
+    case Shape::kArithmetic:
+      Arithmetic(size);
+      break;
+    case Shape::kModule:
+      Module(size);
+      break;
+  }
+
+  return source_;
+}
+
+void ProgramGenerator::Deep(int size) {
+  // the closing parts of the levels, innermost last
+  std::vector<string> closing;
+  source_ += "var deep = ";
+  for (int i = 0; i < size; i++) {
+    switch (Next(4)) {
+      case 0:
+        source_ += "{ var d" + to_string(i) + " = ";
+        Operand(0);
+        source_ += "\n";
+        closing.emplace_back(" }");
+        break;
+      case 1:
+        source_ += Next(2) ? "if (true) " : "if (false) ";
+        closing.push_back(" else " + to_string(Next(100)));
+        break;
+      case 2:
+        source_ += "(" + to_string(Next(100)) + " * ";
+        closing.emplace_back(")");
+        break;
+      default:
+        source_ += "- ";
+        closing.emplace_back("");
+        break;
+    }
+  }
+
+  Operand(0);
+  for (auto it = closing.rbegin(); it != closing.rend(); ++it) {
+    source_ += *it;
+  }
+
+  source_ += "\n";
+}
+
+void ProgramGenerator::Wide(int size) {
+  source_ += "{\n";
+  for (int i = 0; i < size; i++) {
+    source_ += "  var v" + to_string(i) + " = ";
+    if (Next(4) == 0) {
+      source_ += Next(2) ? "if (true) " : "if (false) ";
+      Chain(2, i);
+      source_ += " else ";
+    }
+
+    Chain(3, i);
+    source_ += "\n";
+  }
+
+  source_ += "  unit\n}\n";
+}
+
+void ProgramGenerator::Variables(int size) {
+  for (int i = 0; i < size; i++) {
+    source_ += "var v" + to_string(i) + " = ";
+    Chain(2 + static_cast<int>(Next(3)), i);
+    source_ += "\n";
+  }
+}
+
+void ProgramGenerator::Arithmetic(int size) {
+  for (int i = 0; size > 0; i++, size -= kChainLength) {
+    source_ += "var v" + to_string(i) + " = ";
+    Chain(size < kChainLength ? size : kChainLength, i);
+    source_ += "\n";
+  }
+}
+
+// a definition is a block of locals that uses the previous definition
+// of its group, the groups are independent of each other
+void ProgramGenerator::Module(int size) {
+  for (int i = 0; i < size; i++) {
+    source_ += "var d" + to_string(i) + " = {\n";
+    const int locals = 1 + static_cast<int>(Next(8));
+    for (int j = 0; j < locals; j++) {
+      source_ += "  var v" + to_string(j) + " = ";
+      Chain(3, j);
+      source_ += "\n";
+    }
+
+    source_ += "  v" + to_string(locals - 1);
+    if (i >= kModuleGroups) source_ += " + d" + to_string(i - kModuleGroups);
+    source_ += "\n}\n";
+  }
+}
+
+void ProgramGenerator::Operand(int vars) {
+  if (vars > 0 && Next(2)) {
+    source_ += "v" + to_string(Next(static_cast<uint32_t>(vars)));
+  } else {
+    source_ += to_string(1 + Next(1000));
+  }
+}
+
+void ProgramGenerator::Chain(int operands, int vars) {
+  static const char* const kOps[] = {" + ", " - ", " * ", " / "};
+
+  for (int i = 0; i < operands; i++) {
+    if (i > 0) source_ += kOps[Next(4)];
+    // a few grouped pairs and negations
+    switch (Next(8)) {
+      case 0:
+        if (i + 1 < operands) {
+          source_ += "(";
+          Operand(vars);
+          source_ += kOps[Next(4)];
+          Operand(vars);
+          source_ += ")";
+          i++;
+          break;
+        }
+        Operand(vars);
+        break;
+      case 1:
+        source_ += "-";
+        Operand(vars);
+        break;
+      default:
+        Operand(vars);
+        break;
+    }
+  }
+}
+
+}
@@ -0,0 +1,51 @@
+#ifndef HELIUM_COMPILER_BENCH_GENERATOR_HPP_
+#define HELIUM_COMPILER_BENCH_GENERATOR_HPP_
+
+#include <cstdint>
+#include <random>
+#include <string>
+
+namespace helium {
+
+enum class Shape {
+  kDeep,       // expressions nested `size` levels deep
+  kWide,       // a block of `size` statements
+  kVariables,  // `size` variables using the ones declared before them
+  kArithmetic, // operator chains with `size` operands in total
+  kModule,     // `size` definitions in groups that only use their own group
+};
+
+constexpr int kShapes = 5;
+
+const char* ShapeName(Shape shape);
+
+// Generates well typed programs, the same for the same arguments on any
+// platform: numbers are taken from the engine directly since the standard
+// distributions are implementation defined
+class ProgramGenerator final {
+  std::mt19937 random_;
+  std::string source_;
+
+ public:
+  explicit ProgramGenerator(uint32_t seed) : random_(seed), source_() {}
+
+  std::string Generate(Shape shape, int size);
+
+ private:
+  // a number in [0, n)
+  uint32_t Next(uint32_t n) { return random_() % n; }
+
+  void Deep(int size);
+  void Wide(int size);
+  void Variables(int size);
+  void Arithmetic(int size);
+  void Module(int size);
+
+  // an Int expression of a few operands, names are vN with N below vars
+  void Operand(int vars);
+  void Chain(int operands, int vars);
+};
+
+}
+
+#endif //HELIUM_COMPILER_BENCH_GENERATOR_HPP_
@@ -0,0 +1,69 @@
+#include <random>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include <parser/token.hpp>
+
+namespace helium {
+namespace {
+
+using ::std::string;
+using ::std::vector;
+using ::absl::string_view;
+using ::absl::flat_hash_map;
+using TT = TokenType;
+
+// mostly plain names, some of them close to keywords
+vector<string> Identifiers(size_t count) {
+  static const char* const kWords[] = {
+      "var", "while", "if", "else", "true", "false", "unit",
+      "x", "i", "value", "index", "iff", "variable", "elsewhere",
+      "trueish", "counter", "whilst", "u", "fals", "result"
+  };
+
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<size_t> pick(0, sizeof(kWords) / sizeof(*kWords) - 1);
+
+  vector<string> result;
+  for (size_t i = 0; i < count; i++) {
+    result.emplace_back(kWords[pick(gen)]);
+  }
+
+  return result;
+}
+
+// what Parser::ParseIdentifier used to do
+TT MapIdentifierType(string_view id) {
+  static const flat_hash_map<string_view, TT> keywords = {
+      {"var",   TT::kVar},
+      {"while", TT::kWhile},
+      {"if",    TT::kIf},
+      {"else",  TT::kElse},
+      {"true",  TT::kTrue},
+      {"false", TT::kFalse},
+      {"unit",  TT::kUnit}
+  };
+
+  return keywords.contains(id) ? keywords.at(id) : TT::kIdentifier;
+}
+
+template <TT (*F)(string_view)>
+void BM_Keywords(benchmark::State& state) {
+  const auto ids = Identifiers(4096);
+
+  for (auto _ : state) {
+    for (const auto& id : ids) {
+      benchmark::DoNotOptimize(F(id));
+    }
+  }
+
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * ids.size()));
+}
+
+BENCHMARK_TEMPLATE(BM_Keywords, MapIdentifierType);
+BENCHMARK_TEMPLATE(BM_Keywords, IdentifierType);
+
+}
+}
@@ -0,0 +1,100 @@
+#include <string>
+#include <benchmark/benchmark.h>
+#include <parser/lexer.hpp>
+#include <parser/scan.hpp>
+
+namespace helium {
+namespace {
+
+using ::std::string;
+using ::std::to_string;
+
+// long lexemes, lots of space and comments
+string LexerHeavySource(int statements) {
+  string source;
+  for (int i = 0; i < statements; i++) {
+    auto n = to_string(i);
+    source += "        // statement number " + n + " of a generated program\n";
+    source += "var some_long_identifier_name_" + n + " = \"a string literal that\n"
+              "spans a couple of lines\n  and has an escape \\\" inside\"\n";
+    source += "{\t\t\t\tanother_rather_long_identifier_" + n +
+              "    +    1234567890123456    *    98765.4321000    }\n";
+  }
+
+  return source;
+}
+
+void BM_Lexer(benchmark::State& state) {
+  auto level = static_cast<scan::Level>(state.range(0));
+  if (!scan::IsSupported(level)) {
+    state.SkipWithError("scan level is not supported");
+    return;
+  }
+
+  const auto source = LexerHeavySource(10000);
+  scan::Select(level);
+
+  for (auto _ : state) {
+    auto tokens = Lexer::Lex(source);
+    benchmark::DoNotOptimize(tokens.Size());
+  }
+
+  scan::Select(scan::BestLevel());
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * source.size()));
+}
+
+BENCHMARK(BM_Lexer)
+    ->ArgName("level")
+    ->Arg(static_cast<int>(scan::Level::kScalar))
+    ->Arg(static_cast<int>(scan::Level::kSse2))
+    ->Arg(static_cast<int>(scan::Level::kAvx2))
+    ->Unit(benchmark::kMillisecond);
+
+void BM_Utf8(benchmark::State& state) {
+  auto level = static_cast<scan::Level>(state.range(0));
+  if (!scan::IsSupported(level)) {
+    state.SkipWithError("scan level is not supported");
+    return;
+  }
+
+  // mostly ascii with some localized strings
+  auto source = LexerHeavySource(10000);
+  for (size_t i = 0; i < source.size(); i += 1000) {
+    source.replace(i, 6, "\xc3\xa9\xe2\x82\xac\x20");
+  }
+
+  const auto& table = scan::Get(level);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(table.utf8(source.data(), 0, source.size()));
+  }
+
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * source.size()));
+}
+
+BENCHMARK(BM_Utf8)
+    ->ArgName("level")
+    ->Arg(static_cast<int>(scan::Level::kScalar))
+    ->Arg(static_cast<int>(scan::Level::kSse2))
+    ->Arg(static_cast<int>(scan::Level::kAvx2));
+
+void BM_LexerParallel(benchmark::State& state) {
+  const auto threads = static_cast<size_t>(state.range(0));
+  const auto source = LexerHeavySource(40000);
+
+  for (auto _ : state) {
+    auto tokens = Lexer::LexParallel(source, threads * 4, threads);
+    benchmark::DoNotOptimize(tokens.Size());
+  }
+
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * source.size()));
+}
+
+BENCHMARK(BM_LexerParallel)
+    ->ArgName("threads")
+    ->RangeMultiplier(2)
+    ->Range(1, 16)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+}
+}
@@ -0,0 +1,55 @@
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include <parser/number.hpp>
+
+namespace helium {
+namespace {
+
+using ::std::string;
+using ::std::vector;
+
+// lexemes of a generated data table
+vector<string> RealLexemes() {
+  std::mt19937 gen(1);
+  std::uniform_real_distribution<double> value(0, 1e6);
+  vector<string> result;
+  for (int i = 0; i < 10000; i++) {
+    result.push_back(std::to_string(value(gen)));
+  }
+
+  return result;
+}
+
+void BM_ParseReal(benchmark::State& state) {
+  const auto lexemes = RealLexemes();
+  for (auto _ : state) {
+    for (const auto& lexeme : lexemes) {
+      double value;
+      benchmark::DoNotOptimize(number::ParseReal(lexeme, &value));
+      benchmark::DoNotOptimize(value);
+    }
+  }
+
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * lexemes.size()));
+}
+
+BENCHMARK(BM_ParseReal);
+
+void BM_Strtod(benchmark::State& state) {
+  const auto lexemes = RealLexemes();
+  for (auto _ : state) {
+    for (const auto& lexeme : lexemes) {
+      benchmark::DoNotOptimize(std::strtod(lexeme.c_str(), nullptr));
+    }
+  }
+
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * lexemes.size()));
+}
+
+BENCHMARK(BM_Strtod);
+
+}
+}
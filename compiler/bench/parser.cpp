@@ -0,0 +1,203 @@
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <benchmark/benchmark.h>
+#include <parser/ast_cache.hpp>
+#include <parser/document.hpp>
+#include <parser/flat_ast.hpp>
+#include <parser/parser.hpp>
+
+namespace helium {
+namespace {
+
+using ::std::string;
+using ::std::to_string;
+
+// arithmetic in nested blocks, most of the nodes are small expressions
+string ParserHeavySource(int statements) {
+  string source;
+  for (int i = 0; i < statements; i++) {
+    auto n = to_string(i);
+    source += "var x" + n + " = (1 + 2.5 * -3) / 4 - (x + y * " + n + ")\n";
+    source += "{ var y" + n + " = { x" + n + " * 2 }\n"
+              "  if (y" + n + ") { -y" + n + " + 1 } else { y" + n + " - 1 } }\n";
+    source += "while (x" + n + ") x" + n + " = x" + n + " - 1\n";
+  }
+
+  return source;
+}
+
+void BM_Parse(benchmark::State& state) {
+  const auto source = ParserHeavySource(static_cast<int>(state.range(0)));
+  const auto tokens = Lexer::Lex(source);
+
+  size_t nodes = 0, blocks = 0, bytes = 0;
+  for (auto _ : state) {
+    ErrorReporter reporter("");
+    Interner interner;
+    ConstantPool constants;
+    auto ast = Parser::Parse(tokens, reporter, interner, constants);
+    nodes = ast.size();
+    benchmark::DoNotOptimize(nodes);
+    blocks = ast.Arena().Blocks();
+    bytes = ast.Arena().Allocated();
+  }
+
+  // the nodes are allocated from the arena, a parse makes few blocks
+  state.counters["arena_blocks"] = static_cast<double>(blocks);
+  state.counters["arena_bytes"] = static_cast<double>(bytes);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * source.size()));
+}
+
+// top level statements are parsed by several threads
+void BM_ParseParallel(benchmark::State& state) {
+  const auto source = ParserHeavySource(static_cast<int>(state.range(0)));
+  const auto tokens = Lexer::Lex(source);
+  const auto threads = static_cast<size_t>(state.range(1));
+
+  for (auto _ : state) {
+    ErrorReporter reporter("");
+    Interner interner;
+    ConstantPool constants;
+    auto ast = Parser::ParseParallel(tokens, reporter, interner, constants,
+                                     threads * 4, threads);
+    benchmark::DoNotOptimize(ast.size());
+  }
+
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * source.size()));
+}
+
+// only the top level is parsed, as when declarations are indexed
+void BM_ParseLazy(benchmark::State& state) {
+  const auto source = ParserHeavySource(static_cast<int>(state.range(0)));
+  const auto tokens = Lexer::Lex(source);
+
+  size_t blocks = 0, bytes = 0;
+  for (auto _ : state) {
+    ErrorReporter reporter("");
+    Interner interner;
+    ConstantPool constants;
+    auto ast = Parser::ParseLazy(tokens, reporter, interner, constants);
+    benchmark::DoNotOptimize(ast.size());
+    blocks = ast.Arena().Blocks();
+    bytes = ast.Arena().Allocated();
+  }
+
+  state.counters["arena_blocks"] = static_cast<double>(blocks);
+  state.counters["arena_bytes"] = static_cast<double>(bytes);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * source.size()));
+}
+
+// nested parentheses and operators, time must grow linearly with depth
+void BM_ParseDeep(benchmark::State& state) {
+  const auto depth = static_cast<size_t>(state.range(0));
+  const auto source = string(depth, '(') + string(depth, '-') + "1" + string(depth, ')');
+  const auto tokens = Lexer::Lex(source);
+
+  for (auto _ : state) {
+    ErrorReporter reporter("");
+    Interner interner;
+    ConstantPool constants;
+    auto ast = Parser::Parse(tokens, reporter, interner, constants);
+    benchmark::DoNotOptimize(ast.size());
+  }
+
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * depth));
+}
+
+// the whole way from source to a flat ast, parsed or from the cache
+void BM_SourceToFlat(benchmark::State& state) {
+  const auto source = ParserHeavySource(static_cast<int>(state.range(0)));
+  const bool cached = state.range(1) != 0;
+  const auto path = "/tmp/helium-bench-" + to_string(state.range(0)) + ".ast";
+  if (cached) {
+    ErrorReporter reporter("");
+    Interner interner;
+    ConstantPool constants;
+    auto ast = FlatAst::From(Parser::Parse(source, reporter, interner, constants));
+    if (!AstCache::Save(path, source, ast, interner, constants)) {
+      state.SkipWithError("can't write the cache");
+    }
+  }
+
+  for (auto _ : state) {
+    ErrorReporter reporter("");
+    Interner interner;
+    ConstantPool constants;
+    FlatAst ast;
+    if (cached) {
+      auto cache = AstCache::Load(path, source, ast, interner, constants);
+      if (!cache) state.SkipWithError("can't load the cache");
+      benchmark::DoNotOptimize(ast.Size());
+    } else {
+      ast = FlatAst::From(Parser::Parse(source, reporter, interner, constants));
+      benchmark::DoNotOptimize(ast.Size());
+    }
+  }
+
+  if (cached) std::remove(path.c_str());
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * source.size()));
+}
+
+// an edit in the middle of a large source and one that undoes it,
+// see BM_SourceToFlat for parsing all of it
+void BM_DocumentEdit(benchmark::State& state) {
+  const auto source = ParserHeavySource(static_cast<int>(state.range(0)));
+  Document document(source);
+  const auto offset = static_cast<uint32_t>(source.find("x" + to_string(state.range(0) / 2) + " ="));
+
+  size_t reparsed = 0;
+  for (auto _ : state) {
+    document.Apply({offset, 1, "y"});
+    reparsed += document.Reparsed();
+    document.Apply({offset, 1, "x"});
+    reparsed += document.Reparsed();
+  }
+
+  if (document.HadErrors()) state.SkipWithError("parse errors");
+  state.counters["lines"] = static_cast<double>(std::count(source.begin(), source.end(), '\n'));
+  state.counters["reparsed"] = static_cast<double>(reparsed) / (2 * state.iterations());
+}
+
+BENCHMARK(BM_Parse)
+    ->ArgName("statements")
+    ->Arg(1000)
+    ->Arg(20000)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_ParseDeep)
+    ->ArgName("depth")
+    ->Arg(10000)
+    ->Arg(100000)
+    ->Arg(1000000)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_ParseLazy)
+    ->ArgName("statements")
+    ->Arg(1000)
+    ->Arg(20000)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_DocumentEdit)
+    ->ArgName("statements")
+    ->Arg(20000)
+    ->Arg(33000)
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_SourceToFlat)
+    ->ArgNames({"statements", "cached"})
+    ->Args({20000, 0})
+    ->Args({20000, 1})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_ParseParallel)
+    ->ArgNames({"statements", "threads"})
+    ->Args({20000, 1})
+    ->Args({20000, 2})
+    ->Args({20000, 4})
+    ->Args({20000, 8})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+}
+}
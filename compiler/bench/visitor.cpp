@@ -0,0 +1,140 @@
+#include <string>
+#include <utility>
+#include <benchmark/benchmark.h>
+#include <parser/parser.hpp>
+#include <sema/type_check.hpp>
+#include <sema/type_context.hpp>
+
+namespace helium {
+namespace {
+
+using ::std::string;
+
+// the same pass written against both interfaces
+class VirtualCounter final : public AstVisitor {
+ public:
+  size_t nodes = 0;
+
+  void Visit(VariableStmt& node) override { nodes++; node.GetExpr()->Accept(*this); }
+  void Visit(BinaryExpr& node) override {
+    nodes++;
+    node.Left()->Accept(*this);
+    node.Right()->Accept(*this);
+  }
+  void Visit(UnaryExpr& node) override { nodes++; node.Operand()->Accept(*this); }
+  void Visit(LiteralExpr&) override { nodes++; }
+  void Visit(IdentifierExpr&) override { nodes++; }
+  void Visit(BlockExpr& node) override {
+    nodes++;
+    for (auto* stmt : node.Body()) stmt->Accept(*this);
+  }
+  void Visit(IfExpr& node) override {
+    nodes++;
+    node.Cond()->Accept(*this);
+    node.Then()->Accept(*this);
+    if (node.Else()) node.Else()->Accept(*this);
+  }
+  void Visit(WhileExpr& node) override {
+    nodes++;
+    node.Cond()->Accept(*this);
+    node.Body()->Accept(*this);
+  }
+  void Visit(AssignExpr& node) override { nodes++; node.Expr()->Accept(*this); }
+};
+
+class StaticCounter final : public StaticAstVisitor<StaticCounter> {
+ public:
+  size_t nodes = 0;
+
+  void Visit(VariableStmt& node) { nodes++; Dispatch(*node.GetExpr()); }
+  void Visit(BinaryExpr& node) {
+    nodes++;
+    Dispatch(*node.Left());
+    Dispatch(*node.Right());
+  }
+  void Visit(UnaryExpr& node) { nodes++; Dispatch(*node.Operand()); }
+  void Visit(LiteralExpr&) { nodes++; }
+  void Visit(IdentifierExpr&) { nodes++; }
+  void Visit(BlockExpr& node) {
+    nodes++;
+    for (auto* stmt : node.Body()) Dispatch(*stmt);
+  }
+  void Visit(IfExpr& node) {
+    nodes++;
+    Dispatch(*node.Cond());
+    Dispatch(*node.Then());
+    if (node.Else()) Dispatch(*node.Else());
+  }
+  void Visit(WhileExpr& node) {
+    nodes++;
+    Dispatch(*node.Cond());
+    Dispatch(*node.Body());
+  }
+  void Visit(AssignExpr& node) { nodes++; Dispatch(*node.Expr()); }
+};
+
+// a long left leaning chain of operators, as deep as it is long
+string DeepSource(int depth) {
+  string source = "var x = 1\nx";
+  for (int i = 0; i < depth; i++) {
+    source += i % 2 ? " + -x" : " * 1";
+  }
+
+  return source;
+}
+
+struct Parsed {
+  string source;
+  ErrorReporter reporter;
+  Interner interner;
+  ConstantPool constants;
+  AstTree ast;
+
+  explicit Parsed(string text)
+  : source(std::move(text)),
+    reporter(""),
+    ast(Parser::Parse(source, reporter, interner, constants))
+  {}
+};
+
+void BM_VirtualVisitor(benchmark::State& state) {
+  Parsed parsed(DeepSource(static_cast<int>(state.range(0))));
+  for (auto _ : state) {
+    VirtualCounter counter;
+    for (auto* node : parsed.ast) node->Accept(counter);
+    benchmark::DoNotOptimize(counter.nodes);
+  }
+
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * state.range(0)));
+}
+
+void BM_StaticVisitor(benchmark::State& state) {
+  Parsed parsed(DeepSource(static_cast<int>(state.range(0))));
+  for (auto _ : state) {
+    StaticCounter counter;
+    for (auto* node : parsed.ast) counter.Dispatch(*node);
+    benchmark::DoNotOptimize(counter.nodes);
+  }
+
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * state.range(0)));
+}
+
+// types are set through the same dispatch
+void BM_TypeCheck(benchmark::State& state) {
+  Parsed parsed(DeepSource(static_cast<int>(state.range(0))));
+  for (auto _ : state) {
+    TypeContext types(parsed.interner);
+    TypeCheck check(parsed.reporter, types);
+    for (auto* node : parsed.ast) node->Accept(check);
+  }
+
+  if (parsed.reporter.HadErrors()) state.SkipWithError("type errors");
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * state.range(0)));
+}
+
+BENCHMARK(BM_VirtualVisitor)->ArgName("depth")->Arg(1000)->Arg(10000);
+BENCHMARK(BM_StaticVisitor)->ArgName("depth")->Arg(1000)->Arg(10000);
+BENCHMARK(BM_TypeCheck)->ArgName("depth")->Arg(1000)->Arg(10000);
+
+}
+}
@@ -12,6 +12,7 @@
 #include "absl/memory/memory.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
+#include <istream>
 #include <ostream>
 #include <string>
 #include <vector>
@@ -24,13 +25,26 @@ class Compiler final {
 
   Compiler() = default;
   static absl::optional<std::string> Compile(
-      const std::string& name, const std::string& source, std::vector<uint8_t>& out);
+      const std::string& name, absl::string_view source, std::vector<uint8_t>& out);
 
  public:
+  // "-" reads the program from stdin
   static absl::optional<std::string> FromFile(const std::string& name, std::vector<uint8_t>& out);
+  // reads and lexes the program window by window
+  static absl::optional<std::string> FromStream(
+      const std::string& name, std::istream& input, std::vector<uint8_t>& out);
+  // like FromFile(), but the parsed program is kept in cache_dir keyed by a
+  // hash of the source, so an unchanged file isn't lexed and parsed again
+  static absl::optional<std::string> FromFileCached(
+      const std::string& name, const std::string& cache_dir, std::vector<uint8_t>& out);
   static absl::optional<std::string> FromSource(const std::string& source, std::vector<uint8_t>& out) {
     return Compile("<source string>", source, out);
   }
+  // checks and compiles the program while it is parsed, for short inputs
+  // that must be compiled quickly. The errors and the code are the same
+  // as FromSource() gives, but the checked tree isn't printed
+  static absl::optional<std::string> FromSourceSinglePass(
+      const std::string& source, std::vector<uint8_t>& out);
 };
 
 } // namespace helium
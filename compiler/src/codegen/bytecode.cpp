@@ -0,0 +1,107 @@
+#include <cstring>
+#include "bytecode.hpp"
+
+namespace helium {
+namespace {
+
+using ::std::vector;
+
+const char* Name(OpCode op) {
+  switch (op) {
+    case OpCode::kInt: return "int";
+    case OpCode::kReal: return "real";
+    case OpCode::kChar: return "char";
+    case OpCode::kTrue: return "true";
+    case OpCode::kFalse: return "false";
+    case OpCode::kUnit: return "unit";
+    case OpCode::kLoad: return "load";
+    case OpCode::kStore: return "store";
+    case OpCode::kPop: return "pop";
+    case OpCode::kIntAdd: return "int_add";
+    case OpCode::kIntSub: return "int_sub";
+    case OpCode::kIntMul: return "int_mul";
+    case OpCode::kIntDiv: return "int_div";
+    case OpCode::kIntNeg: return "int_neg";
+    case OpCode::kRealAdd: return "real_add";
+    case OpCode::kRealSub: return "real_sub";
+    case OpCode::kRealMul: return "real_mul";
+    case OpCode::kRealDiv: return "real_div";
+    case OpCode::kRealNeg: return "real_neg";
+    case OpCode::kFail: return "fail";
+    case OpCode::kJump: return "jump";
+    case OpCode::kJumpIfFalse: return "jump_if_false";
+    case OpCode::kReturn: return "return";
+  }
+
+  return "?";
+}
+
+uint64_t Read(const vector<uint8_t>& code, size_t at, size_t size) {
+  uint64_t bits = 0;
+  for (size_t i = 0; i < size; i++) {
+    bits |= static_cast<uint64_t>(code[at + i]) << (8 * i);
+  }
+
+  return bits;
+}
+
+}
+
+size_t InstructionSize(OpCode op) {
+  switch (op) {
+    case OpCode::kInt:
+    case OpCode::kReal:
+      return 9;
+    case OpCode::kChar:
+    case OpCode::kLoad:
+    case OpCode::kStore:
+    case OpCode::kJump:
+    case OpCode::kJumpIfFalse:
+      return 5;
+    default:
+      return 1;
+  }
+}
+
+void Disassemble(const vector<uint8_t>& code, ::std::ostream& os) {
+  for (size_t at = 0; at < code.size();) {
+    const auto op = static_cast<OpCode>(code[at]);
+    const auto size = InstructionSize(op);
+    os << at << ": " << Name(op);
+    if (at + size > code.size()) {
+      os << " <truncated>\n";
+      return;
+    }
+
+    switch (op) {
+      case OpCode::kInt:
+        os << ' ' << static_cast<int64_t>(Read(code, at + 1, 8));
+        break;
+      case OpCode::kReal: {
+        auto bits = Read(code, at + 1, 8);
+        double value;
+        ::std::memcpy(&value, &bits, sizeof(value));
+        os << ' ' << value;
+        break;
+      }
+      case OpCode::kChar:
+      case OpCode::kLoad:
+      case OpCode::kStore:
+        os << ' ' << Read(code, at + 1, 4);
+        break;
+      case OpCode::kJump:
+      case OpCode::kJumpIfFalse: {
+        auto offset = static_cast<int32_t>(static_cast<uint32_t>(Read(code, at + 1, 4)));
+        os << " -> " << static_cast<int64_t>(at + size) + offset;
+        break;
+      }
+      default:
+        break;
+    }
+
+    os << '\n';
+    at += size;
+  }
+}
+
+}
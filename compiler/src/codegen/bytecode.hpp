@@ -0,0 +1,52 @@
+#ifndef HELIUM_COMPILER_SRC_CODEGEN_BYTECODE_HPP_
+#define HELIUM_COMPILER_SRC_CODEGEN_BYTECODE_HPP_
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace helium {
+
+// Instructions of a stack machine. Every expression leaves one value on
+// the stack, variables live in numbered slots of the frame. Operands
+// follow the opcode in little endian order, their size is in the comment
+enum class OpCode : uint8_t {
+  kInt,  // 8, the value
+  kReal, // 8, the bits of the value
+  kChar, // 4, the code point
+  kTrue,
+  kFalse,
+  kUnit,
+
+  kLoad,  // 4, the slot
+  kStore, // 4, the slot, pops the value
+  kPop,
+
+  kIntAdd,
+  kIntSub,
+  kIntMul,
+  kIntDiv,
+  kIntNeg,
+  kRealAdd,
+  kRealSub,
+  kRealMul,
+  kRealDiv,
+  kRealNeg,
+  // an operator applied to a value the checker gave the error type to
+  // without reporting it (assignments are typed so), stops the program
+  kFail,
+
+  kJump,        // 4, signed offset from the end of the instruction
+  kJumpIfFalse, // 4, the same, pops the condition
+  kReturn,      // the value of the program
+};
+
+// size of the opcode and its operand
+size_t InstructionSize(OpCode op);
+
+// one instruction per line: its offset, name and operand
+void Disassemble(const std::vector<uint8_t>& code, std::ostream& os);
+
+}
+
+#endif //HELIUM_COMPILER_SRC_CODEGEN_BYTECODE_HPP_
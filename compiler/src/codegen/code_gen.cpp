@@ -0,0 +1,209 @@
+#include "code_gen.hpp"
+#include "sema/symbol_table.hpp"
+
+namespace helium {
+
+using ::std::vector;
+
+void CodeGen::Generate(const AstTree& ast, const Interner& interner,
+                       const ConstantPool& constants, vector<uint8_t>& out) {
+  CodeGen gen(out, interner, constants);
+  for (auto* node : ast) {
+    gen.emit_.Statement();
+    gen.Walk(*node);
+  }
+
+  gen.emit_.End();
+}
+
+void CodeGen::Generate(const FlatAst& ast, const Interner& interner,
+                       const ConstantPool& constants, vector<uint8_t>& out) {
+  using Kind = FlatAst::Kind;
+  using Index = FlatAst::Index;
+  struct Entry {
+    Index node;
+    size_t next; // child to be compiled next, patterns aside
+  };
+
+  CodeGen gen(out, interner, constants);
+  auto& emit = gen.emit_;
+  SymbolTable names;
+  vector<Entry> open;
+
+  auto complete = [&](Index node) {
+    switch (ast.GetKind(node)) {
+      case Kind::kVariable:
+        // the initializer doesn't see the name it initializes
+        names.Declare(ast.Data(ast.FirstChild(node)), nullptr);
+        emit.Variable();
+        break;
+      case Kind::kBinary:
+        emit.Binary(ast.GetIntrinsic(node));
+        break;
+      case Kind::kUnary:
+        emit.Unary(ast.Op(node), ast.GetIntrinsic(node));
+        break;
+      case Kind::kLiteral:
+        emit.Literal(ast.Op(node), ast.Data(node), ast.Aux(node));
+        break;
+      case Kind::kIdentifier:
+        emit.Load(names.SlotOf(ast.Data(node)));
+        break;
+      case Kind::kAssign:
+        emit.Assign(names.SlotOf(ast.Data(node)));
+        break;
+      case Kind::kBlock:
+        names.Exit();
+        emit.BlockEnd();
+        break;
+      case Kind::kIf: {
+        const auto then = ast.NextSibling(ast.FirstChild(node));
+        emit.IfEnd(ast.NextSibling(then) != ast.End(node));
+        break;
+      }
+      case Kind::kWhile:
+        emit.WhileEnd();
+        break;
+      default:
+        break;
+    }
+  };
+
+  for (Index node = 0; node < ast.Size(); node++) {
+    while (!open.empty() && ast.End(open.back().node) <= node) {
+      complete(open.back().node);
+      open.pop_back();
+    }
+
+    const auto kind = ast.GetKind(node);
+    if (open.empty()) {
+      emit.Statement();
+    } else if (kind != Kind::kPattern) {
+      const auto parent = open.back().node;
+      const auto i = open.back().next++;
+      switch (ast.GetKind(parent)) {
+        case Kind::kBlock:
+          emit.Statement();
+          break;
+        case Kind::kIf:
+          if (i == 1) emit.IfCondition();
+          else if (i == 2) emit.IfElse();
+          break;
+        case Kind::kWhile:
+          if (i == 1) emit.WhileCondition();
+          break;
+        default:
+          break;
+      }
+    }
+
+    if (kind == Kind::kBlock) {
+      names.Enter();
+      emit.BlockBegin();
+    } else if (kind == Kind::kWhile) {
+      emit.WhileBegin();
+    }
+
+    if (ast.IsLeaf(node)) complete(node);
+    else open.push_back({node, 0});
+  }
+
+  while (!open.empty()) {
+    complete(open.back().node);
+    open.pop_back();
+  }
+
+  emit.End();
+}
+
+void CodeGen::Walk(AstNode& root) {
+  struct Entry {
+    AstNode* node;
+    size_t next; // child to be compiled next
+  };
+
+  vector<Entry> stack = {{&root, 0}};
+  Enter(root);
+  while (!stack.empty()) {
+    auto& top = stack.back();
+    auto* node = top.node;
+
+    if (auto* child = ChildAt(*node, top.next)) {
+      Before(*node, top.next++);
+      stack.push_back({child, 0});
+      Enter(*child);
+      continue;
+    }
+
+    stack.pop_back();
+    Complete(*node);
+  }
+}
+
+void CodeGen::Enter(AstNode& node) {
+  switch (node.GetKind()) {
+    case AstKind::kBlock:
+      emit_.BlockBegin();
+      break;
+    case AstKind::kWhile:
+      emit_.WhileBegin();
+      break;
+    default:
+      break;
+  }
+}
+
+void CodeGen::Before(AstNode& node, size_t i) {
+  switch (node.GetKind()) {
+    case AstKind::kBlock:
+      emit_.Statement();
+      break;
+    case AstKind::kIf:
+      if (i == 1) emit_.IfCondition();
+      else if (i == 2) emit_.IfElse();
+      break;
+    case AstKind::kWhile:
+      if (i == 1) emit_.WhileCondition();
+      break;
+    default:
+      break;
+  }
+}
+
+void CodeGen::Complete(AstNode& node) {
+  switch (node.GetKind()) {
+    case AstKind::kVariable:
+      emit_.Variable();
+      break;
+    case AstKind::kBinary:
+      emit_.Binary(static_cast<BinaryExpr&>(node).GetIntrinsic());
+      break;
+    case AstKind::kUnary: {
+      const auto& expr = static_cast<UnaryExpr&>(node);
+      emit_.Unary(expr.Op(), expr.GetIntrinsic());
+      break;
+    }
+    case AstKind::kLiteral: {
+      const auto& expr = static_cast<LiteralExpr&>(node);
+      emit_.Literal(expr.Kind(), expr.Value(), expr.Constant());
+      break;
+    }
+    case AstKind::kIdentifier:
+      emit_.Load(static_cast<IdentifierExpr&>(node).GetResolution().slot);
+      break;
+    case AstKind::kAssign:
+      emit_.Assign(static_cast<AssignExpr&>(node).GetResolution().slot);
+      break;
+    case AstKind::kBlock:
+      emit_.BlockEnd();
+      break;
+    case AstKind::kIf:
+      emit_.IfEnd(static_cast<IfExpr&>(node).Else() != nullptr);
+      break;
+    case AstKind::kWhile:
+      emit_.WhileEnd();
+      break;
+  }
+}
+
+}
@@ -0,0 +1,40 @@
+#ifndef HELIUM_COMPILER_SRC_CODEGEN_CODE_GEN_HPP_
+#define HELIUM_COMPILER_SRC_CODEGEN_CODE_GEN_HPP_
+
+#include <cstdint>
+#include <vector>
+#include "emitter.hpp"
+#include "parser/ast.hpp"
+#include "parser/flat_ast.hpp"
+
+namespace helium {
+
+// Compiles a checked and resolved tree without errors, see Emitter and
+// Resolver. The tree is walked with a stack, so its depth doesn't matter
+class CodeGen final {
+  Emitter emit_;
+
+ public:
+  static void Generate(const AstTree& ast, const Interner& interner,
+                       const ConstantPool& constants, std::vector<uint8_t>& out);
+  // the same code from a checked flat ast without errors, which is not
+  // resolved: the locals get the slots the Resolver gives them as the
+  // nodes are compiled
+  static void Generate(const FlatAst& ast, const Interner& interner,
+                       const ConstantPool& constants, std::vector<uint8_t>& out);
+
+ private:
+  CodeGen(std::vector<uint8_t>& out, const Interner& interner, const ConstantPool& constants)
+  : emit_(out, interner, constants)
+  {}
+
+  void Walk(AstNode& root);
+  void Enter(AstNode& node);
+  // the children before the i-th one are compiled
+  void Before(AstNode& node, size_t i);
+  void Complete(AstNode& node);
+};
+
+}
+
+#endif //HELIUM_COMPILER_SRC_CODEGEN_CODE_GEN_HPP_
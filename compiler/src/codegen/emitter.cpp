@@ -0,0 +1,187 @@
+#include <cassert>
+#include "emitter.hpp"
+#include "parser/unicode.hpp"
+
+namespace helium {
+namespace {
+
+using TT = TokenType;
+
+// TODO: escapes are not defined yet, \x stands for x
+uint32_t CodePoint(::absl::string_view lexeme) {
+  size_t at = 1; // the opening '
+  if (lexeme[at] == '\\') at++;
+  uint32_t code_point = 0;
+  unicode::Decode(lexeme.data(), at, lexeme.size(), &code_point);
+  return code_point;
+}
+
+OpCode Instruction(IntrinsicOp intrinsic) {
+  switch (intrinsic) {
+    case IntrinsicOp::kIntAdd: return OpCode::kIntAdd;
+    case IntrinsicOp::kIntSub: return OpCode::kIntSub;
+    case IntrinsicOp::kIntMul: return OpCode::kIntMul;
+    case IntrinsicOp::kIntDiv: return OpCode::kIntDiv;
+    case IntrinsicOp::kIntNeg: return OpCode::kIntNeg;
+    case IntrinsicOp::kRealAdd: return OpCode::kRealAdd;
+    case IntrinsicOp::kRealSub: return OpCode::kRealSub;
+    case IntrinsicOp::kRealMul: return OpCode::kRealMul;
+    case IntrinsicOp::kRealDiv: return OpCode::kRealDiv;
+    case IntrinsicOp::kRealNeg: return OpCode::kRealNeg;
+    case IntrinsicOp::kNone: return OpCode::kFail;
+  }
+
+  return OpCode::kFail;
+}
+
+}
+
+Emitter::Emitter(std::vector<uint8_t>& out, const Interner& interner,
+                 const ConstantPool& constants)
+: out_(out),
+  interner_(interner),
+  constants_(constants),
+  blocks_({{0, false}}),
+  locals_(0)
+{}
+
+void Emitter::Statement() {
+  if (blocks_.back().value) Emit(OpCode::kPop);
+  blocks_.back().value = true;
+}
+
+void Emitter::Variable() {
+  Emit(OpCode::kStore, locals_++, 4);
+  blocks_.back().value = false;
+}
+
+void Emitter::Literal(TokenType kind, Interner::Data value, ConstantPool::Index constant) {
+  switch (kind) {
+    case TT::kInt:
+    case TT::kReal:
+      // out of range literals are errors
+      Emit(kind == TT::kInt ? OpCode::kInt : OpCode::kReal,
+           constant == ConstantPool::kNone ? 0 : constants_.Get(constant).bits, 8);
+      break;
+    case TT::kChar:
+      Emit(OpCode::kChar, CodePoint(*interner_.LookUp(value)), 4);
+      break;
+    case TT::kTrue:
+      Emit(OpCode::kTrue);
+      break;
+    case TT::kFalse:
+      Emit(OpCode::kFalse);
+      break;
+    case TT::kUnit:
+      Emit(OpCode::kUnit);
+      break;
+    default:
+      assert(false && "Unimplemented");
+      Emit(OpCode::kFail);
+      break;
+  }
+}
+
+void Emitter::Load(uint32_t slot) {
+  Emit(OpCode::kLoad, slot, 4);
+}
+
+void Emitter::Unary(TokenType op, IntrinsicOp intrinsic) {
+  // + leaves the operand as it is
+  if (op == TT::kPlus && intrinsic == IntrinsicOp::kNone) return;
+  Emit(Instruction(intrinsic));
+}
+
+void Emitter::Binary(IntrinsicOp intrinsic) {
+  Emit(Instruction(intrinsic));
+}
+
+void Emitter::Assign(uint32_t slot) {
+  Emit(OpCode::kStore, slot, 4);
+  Emit(OpCode::kUnit);
+}
+
+void Emitter::BlockBegin() {
+  blocks_.push_back({locals_, false});
+}
+
+void Emitter::BlockEnd() {
+  if (!blocks_.back().value) Emit(OpCode::kUnit);
+  locals_ = blocks_.back().locals;
+  blocks_.pop_back();
+}
+
+// cond; jump_if_false else; then; jump end; else: else; end:
+// without else the then branch is popped and the value is unit
+void Emitter::IfCondition() {
+  labels_.push_back(Jump(OpCode::kJumpIfFalse));
+}
+
+void Emitter::IfElse() {
+  auto condition = labels_.back();
+  labels_.back() = Jump(OpCode::kJump);
+  Patch(condition);
+}
+
+void Emitter::IfEnd(bool has_else) {
+  if (!has_else) Emit(OpCode::kPop);
+  Patch(labels_.back());
+  labels_.pop_back();
+  if (!has_else) Emit(OpCode::kUnit);
+}
+
+// start: cond; jump_if_false end; body; pop; jump start; end: unit
+void Emitter::WhileBegin() {
+  labels_.push_back(out_.size());
+}
+
+void Emitter::WhileCondition() {
+  labels_.push_back(Jump(OpCode::kJumpIfFalse));
+}
+
+void Emitter::WhileEnd() {
+  auto exit = labels_.back();
+  labels_.pop_back();
+  auto start = labels_.back();
+  labels_.pop_back();
+
+  Emit(OpCode::kPop);
+  auto end = out_.size() + InstructionSize(OpCode::kJump);
+  Emit(OpCode::kJump, static_cast<uint64_t>(static_cast<int64_t>(start) - static_cast<int64_t>(end)), 4);
+
+  Patch(exit);
+  Emit(OpCode::kUnit);
+}
+
+void Emitter::End() {
+  assert(blocks_.size() == 1 && labels_.empty());
+  if (!blocks_.back().value) Emit(OpCode::kUnit);
+  Emit(OpCode::kReturn);
+}
+
+void Emitter::Emit(OpCode op) {
+  out_.push_back(static_cast<uint8_t>(op));
+}
+
+void Emitter::Emit(OpCode op, uint64_t operand, size_t size) {
+  Emit(op);
+  for (size_t i = 0; i < size; i++) {
+    out_.push_back(static_cast<uint8_t>(operand >> (8 * i)));
+  }
+}
+
+size_t Emitter::Jump(OpCode op) {
+  auto at = out_.size();
+  Emit(op, 0, 4);
+  return at;
+}
+
+// the jump goes to the end of the code
+void Emitter::Patch(size_t jump) {
+  auto offset = static_cast<uint64_t>(out_.size() - jump - InstructionSize(OpCode::kJump));
+  for (size_t i = 0; i < 4; i++) {
+    out_[jump + 1 + i] = static_cast<uint8_t>(offset >> (8 * i));
+  }
+}
+
+}
@@ -0,0 +1,75 @@
+#ifndef HELIUM_COMPILER_SRC_CODEGEN_EMITTER_HPP_
+#define HELIUM_COMPILER_SRC_CODEGEN_EMITTER_HPP_
+
+#include <cstdint>
+#include <vector>
+#include "bytecode.hpp"
+#include "constant_pool.hpp"
+#include "interner.hpp"
+#include "parser/ast.hpp"
+#include "parser/token.hpp"
+
+namespace helium {
+
+// Writes the code of a checked program as its constructs complete, in
+// the order of ParseEvents: the code generator walking a tree and the
+// single pass compiler call it the same way and get the same bytes.
+// Forward jumps are patched when the code they skip is complete.
+//
+// The program is a block: statements leave their values on the stack
+// until the next statement starts, the value of the last one is the
+// value of the block (unit if it is a var statement or there is none)
+class Emitter final {
+  struct Block {
+    uint32_t locals; // declared before the block
+    bool value;      // the last statement left one
+  };
+
+  std::vector<uint8_t>& out_;
+  const Interner& interner_;
+  const ConstantPool& constants_;
+  std::vector<Block> blocks_; // the program and the open blocks
+  uint32_t locals_; // slots in use, a declaration takes the next one
+  std::vector<size_t> labels_; // jumps to be patched and loop starts
+
+ public:
+  // code is appended to out
+  Emitter(std::vector<uint8_t>& out, const Interner& interner, const ConstantPool& constants);
+
+  Emitter(const Emitter&) = delete;
+  Emitter& operator =(const Emitter&) = delete;
+
+  void Statement();
+  // stores the value of the initializer in the next slot,
+  // see Resolver for the slots
+  void Variable();
+
+  void Literal(TokenType kind, Interner::Data value, ConstantPool::Index constant);
+  void Load(uint32_t slot);
+  void Unary(TokenType op, IntrinsicOp intrinsic);
+  void Binary(IntrinsicOp intrinsic);
+  void Assign(uint32_t slot);
+
+  void BlockBegin();
+  void BlockEnd();
+  void IfCondition();
+  void IfElse();
+  void IfEnd(bool has_else);
+  void WhileBegin();
+  void WhileCondition();
+  void WhileEnd();
+
+  // returns the value of the last statement
+  void End();
+
+ private:
+  void Emit(OpCode op);
+  void Emit(OpCode op, uint64_t operand, size_t size);
+  // the offset of the jump
+  size_t Jump(OpCode op);
+  void Patch(size_t jump);
+};
+
+}
+
+#endif //HELIUM_COMPILER_SRC_CODEGEN_EMITTER_HPP_
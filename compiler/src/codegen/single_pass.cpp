@@ -0,0 +1,186 @@
+#include <cassert>
+#include "parser/lexer.hpp"
+#include "parser/parser.hpp"
+#include "single_pass.hpp"
+
+namespace helium {
+
+using ::std::vector;
+using ::absl::string_view;
+
+SinglePass::SinglePass(const ErrorReporter& syntax, ErrorReporter& types, Interner& interner,
+                       const ConstantPool& constants, vector<uint8_t>& out)
+: syntax_(syntax),
+  context_(interner),
+  check_(types, context_),
+  emit_(out, interner, constants) {
+  blocks_.push_back({check_.kUnit, false});
+}
+
+bool SinglePass::Compile(string_view source, ErrorReporter& reporter,
+                         Interner& interner, ConstantPool& constants,
+                         vector<uint8_t>& out) {
+  const auto size = out.size();
+  ErrorReporter types(reporter.FileName());
+  types.SetSource(source);
+
+  {
+    auto tokens = Lexer::Lex(source);
+    SinglePass pass(reporter, types, interner, constants, out);
+    Parser::Parse(tokens, reporter, interner, constants, pass);
+    if (!pass.Failed()) {
+      pass.EndStatement();
+      pass.emit_.End();
+    }
+  }
+
+  if (!reporter.HadErrors()) reporter.Append(types);
+  if (reporter.HadErrors()) {
+    out.resize(size);
+    return false;
+  }
+
+  return true;
+}
+
+void SinglePass::Statement() {
+  if (Failed()) return;
+  EndStatement();
+  blocks_.back().value = true;
+  emit_.Statement();
+}
+
+void SinglePass::Pattern(Interner::Data name, Span span) {
+  if (Failed()) return;
+  patterns_.push_back({name, span, nullptr});
+}
+
+void SinglePass::PatternType(Interner::Data type) {
+  if (Failed()) return;
+  patterns_.back().type = context_.Single(type);
+}
+
+void SinglePass::Variable() {
+  if (Failed()) return;
+  const auto pattern = patterns_.back();
+  patterns_.pop_back();
+  check_.DeclareRule(pattern.name, pattern.span, pattern.type, Pop());
+
+  auto& block = blocks_.back();
+  if (!Is<ErrorType>(block.type)) block.type = check_.kUnit;
+  block.value = false;
+  emit_.Variable();
+}
+
+void SinglePass::Literal(TokenType kind, Interner::Data value, ConstantPool::Index constant) {
+  if (Failed()) return;
+  types_.push_back(check_.LiteralRule(kind));
+  emit_.Literal(kind, value, constant);
+}
+
+void SinglePass::Identifier(Interner::Data name, Span span) {
+  if (Failed()) return;
+  types_.push_back(check_.IdentifierRule(name, span));
+  emit_.Load(check_.symbols_.SlotOf(name));
+}
+
+void SinglePass::Unary(TokenType op, Span span) {
+  if (Failed()) return;
+  const auto* type = check_.UnaryRule(op, span, Pop());
+  types_.push_back(type);
+  emit_.Unary(op, check_.Intrinsic(op, type, true));
+}
+
+void SinglePass::Binary(TokenType op, Span span) {
+  if (Failed()) return;
+  const auto* right = Pop();
+  const auto* left = Pop();
+  const auto* type = check_.BinaryRule(op, span, left, right);
+  types_.push_back(type);
+  emit_.Binary(check_.Intrinsic(op, type, false));
+}
+
+void SinglePass::Assign(Interner::Data name, Span span) {
+  if (Failed()) return;
+  types_.push_back(check_.AssignRule(name, span, Pop()));
+  emit_.Assign(check_.symbols_.SlotOf(name));
+}
+
+void SinglePass::BlockBegin() {
+  if (Failed()) return;
+  check_.symbols_.Enter();
+  blocks_.push_back({check_.kUnit, false});
+  emit_.BlockBegin();
+}
+
+void SinglePass::BlockEnd() {
+  if (Failed()) return;
+  EndStatement();
+  types_.push_back(blocks_.back().type);
+  blocks_.pop_back();
+  check_.symbols_.Exit();
+  emit_.BlockEnd();
+}
+
+void SinglePass::IfCondition() {
+  if (Failed()) return;
+  check_.ConditionRule(types_.back(), "Type of condition must be Bool");
+  elses_.push_back(false);
+  emit_.IfCondition();
+}
+
+void SinglePass::IfElse() {
+  if (Failed()) return;
+  elses_.back() = true;
+  emit_.IfElse();
+}
+
+void SinglePass::IfEnd() {
+  if (Failed()) return;
+  const bool has_else = elses_.back();
+  elses_.pop_back();
+
+  const auto* else_type = has_else ? Pop() : nullptr;
+  const auto* then_type = Pop();
+  const auto* cond = Pop();
+  types_.push_back(check_.IfRule(cond, then_type, else_type));
+  emit_.IfEnd(has_else);
+}
+
+void SinglePass::WhileBegin() {
+  if (Failed()) return;
+  emit_.WhileBegin();
+}
+
+void SinglePass::WhileCondition() {
+  if (Failed()) return;
+  check_.ConditionRule(types_.back(), "Type of condition expression must be Bool");
+  emit_.WhileCondition();
+}
+
+void SinglePass::WhileEnd() {
+  if (Failed()) return;
+  const auto* body = Pop();
+  const auto* cond = Pop();
+  types_.push_back(check_.WhileRule(cond, body));
+  emit_.WhileEnd();
+}
+
+const Type* SinglePass::Pop() {
+  // operands are only missing after syntax errors
+  assert(!types_.empty());
+  const auto* type = types_.back();
+  types_.pop_back();
+  return type;
+}
+
+void SinglePass::EndStatement() {
+  auto& block = blocks_.back();
+  if (!block.value) return;
+
+  const auto* type = Pop();
+  if (!Is<ErrorType>(block.type)) block.type = type;
+  block.value = false;
+}
+
+}
@@ -0,0 +1,83 @@
+#ifndef HELIUM_COMPILER_SRC_CODEGEN_SINGLE_PASS_HPP_
+#define HELIUM_COMPILER_SRC_CODEGEN_SINGLE_PASS_HPP_
+
+#include <cstdint>
+#include <vector>
+#include "absl/strings/string_view.h"
+#include "emitter.hpp"
+#include "error_reporter.hpp"
+#include "parser/parse_events.hpp"
+#include "sema/type_check.hpp"
+#include "sema/type_context.hpp"
+
+namespace helium {
+
+// Checks and compiles a program while it is parsed, no tree is built.
+// The rules of TypeCheck are applied as the constructs complete, with
+// the types of the operands on a stack, and the code is written by the
+// Emitter the code generator uses, locals are addressed by the slots of
+// the symbol table of the check, which are the ones the Resolver gives.
+// The errors and the code are the ones parsing, checking and generating
+// code one after another would give
+class SinglePass final : public ParseEvents {
+  struct Declared {
+    Interner::Data name;
+    Span span;
+    const Type* type; // null if inferred
+  };
+
+  struct Block {
+    const Type* type; // of the statements so far
+    bool value; // the type of the last statement is on the stack
+  };
+
+  const ErrorReporter& syntax_; // nothing is checked after a syntax error
+  TypeContext context_;
+  TypeCheck check_;
+  std::vector<Declared> patterns_; // of the var statements being parsed
+  std::vector<Block> blocks_; // the program and the open blocks
+  std::vector<const Type*> types_; // of the operands
+  std::vector<bool> elses_; // of the open ifs
+  Emitter emit_;
+
+ public:
+  // Returns false if there are errors, they are reported in the order
+  // the pipeline reports them: syntax errors first and type errors only
+  // if there are none. Code is appended to out if there are no errors
+  static bool Compile(absl::string_view source, ErrorReporter& reporter,
+                      Interner& interner, ConstantPool& constants,
+                      std::vector<uint8_t>& out);
+
+  void Statement() override;
+  void Pattern(Interner::Data name, Span span) override;
+  void PatternType(Interner::Data type) override;
+  void Variable() override;
+
+  void Literal(TokenType kind, Interner::Data value, ConstantPool::Index constant) override;
+  void Identifier(Interner::Data name, Span span) override;
+  void Unary(TokenType op, Span span) override;
+  void Binary(TokenType op, Span span) override;
+  void Assign(Interner::Data name, Span span) override;
+
+  void BlockBegin() override;
+  void BlockEnd() override;
+  void IfCondition() override;
+  void IfElse() override;
+  void IfEnd() override;
+  void WhileBegin() override;
+  void WhileCondition() override;
+  void WhileEnd() override;
+
+ private:
+  SinglePass(const ErrorReporter& syntax, ErrorReporter& types, Interner& interner,
+             const ConstantPool& constants, std::vector<uint8_t>& out);
+
+  bool Failed() const { return syntax_.HadErrors(); }
+  const Type* Pop();
+  // adds the type of the last statement to the one of its block
+  void EndStatement();
+};
+
+}
+
+#endif //HELIUM_COMPILER_SRC_CODEGEN_SINGLE_PASS_HPP_
@@ -2,16 +2,24 @@
 // Created by vasniktel on 26.08.2019.
 //
 
+#include <unistd.h>
+#include <cinttypes>
+#include <cstdio>
 #include <iostream>
-#include <fstream>
 #include <utility>
 #include <parser/ast_printer.hpp>
+#include "codegen/code_gen.hpp"
+#include "codegen/single_pass.hpp"
+#include "parser/ast_cache.hpp"
+#include "parser/flat_ast.hpp"
+#include "parser/lexer.hpp"
 #include "parser/parser.hpp"
+#include "sema/resolver.hpp"
 #include "compiler.hpp"
 #include "error_reporter.hpp"
+#include "source_file.hpp"
 
 namespace helium {
-namespace {
 
 using ::std::vector;
 using ::std::string;
@@ -22,59 +30,140 @@ using ::absl::optional;
 using ::absl::nullopt;
 using ::absl::make_optional;
 
-bool ReadFile(const string& name, string& data) {
-  using ::std::ifstream;
-  using ::std::istream_iterator;
+namespace {
+
+constexpr size_t kStreamWindow = 1 << 16;
+
+// parse must fill the ast using the given reporter, interner and constants,
+// nullopt if the source couldn't be read
+template <typename F>
+optional<string> Run(const string& name, F parse, vector<uint8_t>& out) {
+  ErrorReporter reporter(name);
+  Interner interner;
+  ConstantPool constants;
+  optional<AstTree> parsed = parse(reporter, interner, constants);
+  if (!parsed) {
+    return make_optional("Unable to read from file: " + name);
+  }
+
+  AstTree& ast = *parsed;
+  if (reporter.HadErrors()) {
+    return make_optional(reporter.GetErrors());
+  }
 
-  ifstream fin(name);
-  if (!fin) return false;
+  TypeContext types(interner);
+  TypeCheck::Check(ast, reporter, types);
 
-  fin.seekg(0, ::std::ios::end);
-  data.reserve(fin.tellg());
-  fin.seekg(0, ::std::ios::beg);
+  if (reporter.HadErrors()) {
+    return make_optional(reporter.GetErrors());
+  }
+
+  Resolver resolver;
+  for (const auto& node : ast) {
+    resolver.Resolve(*node);
+  }
+  
+  AstPrinter printer(true, ::std::cout, interner);
+
+  for (const auto& node : ast) {
+    node->Accept(printer);
+  }
+
+  CodeGen::Generate(ast, interner, constants, out);
+  return nullopt;
+}
 
-  data.assign(istream_iterator<char>{fin}, istream_iterator<char>{});
-  return true;
+optional<string> CompileStream(const string& name, SourceStream input, vector<uint8_t>& out) {
+  // the lexer keeps the lexemes until compilation is done
+  StreamLexer lexer(input, kStreamWindow);
+  return Run(name, [&lexer, &input](ErrorReporter& reporter, Interner& interner,
+                                    ConstantPool& constants) -> optional<AstTree> {
+    auto ast = Parser::Parse(lexer, reporter, interner, constants);
+    // the errors of a truncated source would be misleading
+    if (input.Failed()) return nullopt;
+    return make_optional(move(ast));
+  }, out);
 }
 
 }
 
 optional<string> Compiler::FromFile(const string& name, vector<uint8_t>& out) {
-  string source;
-  if (!ReadFile(name, source))
+  // stdin may be the output of a generator, don't keep all of it in memory
+  if (name == "-") {
+    return CompileStream(name, SourceStream::FromFd(STDIN_FILENO), out);
+  }
+
+  // the file must stay open (mapped) until compilation is done
+  auto file = SourceFile::Open(name);
+  if (!file)
     return make_optional("Unable to read from file: " + name);
-  return Compile(name, source, out);
+  return Compile(name, file->Contents(), out);
 }
 
-// TODO: remove boilerplate
-optional<string> Compiler::Compile(const string& name,
-    const string& source, vector<uint8_t>& out) {
-  (void)out;
-  ErrorReporter reporter(name);
-  Interner interner;
-  auto ast = Parser::Parse(source, reporter, interner);
+optional<string> Compiler::FromFileCached(const string& name, const string& cache_dir,
+                                          vector<uint8_t>& out) {
+  auto file = SourceFile::Open(name);
+  if (!file)
+    return make_optional("Unable to read from file: " + name);
 
-  if (reporter.HadErrors()) {
-    return make_optional(reporter.GetErrors());
-  }
+  auto source = file->Contents();
+  char key[17];
+  snprintf(key, sizeof(key), "%016" PRIx64, AstCache::Hash(source));
+  auto path = cache_dir + "/" + key + ".ast";
 
-  TypeCheck check(reporter, interner);
-  
-  for (const auto& node : ast) {
-    node->Accept(check);
+  ErrorReporter reporter(name);
+  reporter.SetSource(source);
+  Interner interner;
+  ConstantPool constants;
+  FlatAst ast;
+
+  // the cache owns the memory of the loaded ast and names
+  auto cache = AstCache::Load(path, source, ast, interner, constants);
+  if (!cache) {
+    auto tree = Parser::Parse(source, reporter, interner, constants);
+    if (reporter.HadErrors()) {
+      return make_optional(reporter.GetErrors());
+    }
+
+    ast = FlatAst::From(tree);
+    // a failed write only costs the next run a parse
+    AstCache::Save(path, source, ast, interner, constants);
   }
 
+  TypeContext types(interner);
+  TypeCheck check(reporter, types);
+  check.Check(ast);
   if (reporter.HadErrors()) {
     return make_optional(reporter.GetErrors());
   }
-  
+
   AstPrinter printer(true, ::std::cout, interner);
+  printer.Print(ast);
+  CodeGen::Generate(ast, interner, constants, out);
+  return nullopt;
+}
 
-  for (const auto& node : ast) {
-    node->Accept(printer);
+optional<string> Compiler::FromStream(const string& name, ::std::istream& input, vector<uint8_t>& out) {
+  return CompileStream(name, SourceStream::FromStream(input), out);
+}
+
+optional<string> Compiler::FromSourceSinglePass(const string& source, vector<uint8_t>& out) {
+  ErrorReporter reporter("<source string>");
+  Interner interner;
+  ConstantPool constants;
+  if (!SinglePass::Compile(source, reporter, interner, constants, out)) {
+    return make_optional(reporter.GetErrors());
   }
 
   return nullopt;
 }
 
+optional<string> Compiler::Compile(const string& name,
+    string_view source, vector<uint8_t>& out) {
+  return Run(name, [source](ErrorReporter& reporter, Interner& interner,
+                            ConstantPool& constants) {
+    return Parser::Parse(source, reporter, interner, constants);
+  }, out);
+}
+
 }
@@ -0,0 +1,77 @@
+#ifndef HELIUM_COMPILER_SRC_CONSTANT_POOL_HPP_
+#define HELIUM_COMPILER_SRC_CONSTANT_POOL_HPP_
+
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+#include "absl/container/flat_hash_map.h"
+
+namespace helium {
+
+// values of the numeric literals of a compilation, equal values
+// (bit for bit, so 0.0 and -0.0 differ) share one entry
+class ConstantPool final {
+ public:
+  using Index = uint32_t;
+  static constexpr Index kNone = UINT32_MAX;
+
+  enum class Kind : uint8_t {
+    kInt,
+    kReal
+  };
+
+  struct Constant final {
+    Kind kind;
+    uint64_t bits; // the value of kInt, the representation of kReal
+
+    int64_t Int() const { return static_cast<int64_t>(bits); }
+    double Real() const {
+      double value;
+      ::std::memcpy(&value, &bits, sizeof(value));
+      return value;
+    }
+
+    bool operator ==(const Constant& other) const {
+      return kind == other.kind && bits == other.bits;
+    }
+
+    template <typename H>
+    friend H AbslHashValue(H state, const Constant& constant) {
+      return H::combine(::std::move(state), constant.kind, constant.bits);
+    }
+  };
+
+ private:
+  ::std::vector<Constant> constants_;
+  ::absl::flat_hash_map<Constant, Index> index_;
+
+ public:
+  Index AddInt(int64_t value) {
+    return Add({Kind::kInt, static_cast<uint64_t>(value)});
+  }
+
+  Index AddReal(double value) {
+    uint64_t bits;
+    ::std::memcpy(&bits, &value, sizeof(bits));
+    return Add({Kind::kReal, bits});
+  }
+
+  const Constant& Get(Index index) const { return constants_[index]; }
+  size_t Size() const { return constants_.size(); }
+
+ private:
+  Index Add(Constant constant) {
+    auto it = index_.find(constant);
+    if (it != index_.end()) return it->second;
+
+    auto index = static_cast<Index>(constants_.size());
+    index_.emplace(constant, index);
+    constants_.push_back(constant);
+    return index;
+  }
+};
+
+}
+
+#endif //HELIUM_COMPILER_SRC_CONSTANT_POOL_HPP_
@@ -46,9 +46,9 @@ ostream& operator <<(ostream& os, const Token& token) {
     default: assert(false && "Unknown enum value (forgot to handle)");
   }
 
-  return os << StreamFormat("[%s <%s> at %d:%d]", enum_name,
+  return os << StreamFormat("[%s <%s> at %d+%d]", enum_name,
       token.type == TT::kEol ? "\\n" : token.lexeme,
-      token.line, token.col);
+      token.span.offset, token.span.length);
 }
 
 }
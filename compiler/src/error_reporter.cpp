@@ -16,21 +16,34 @@ void ErrorReporter::ErrorAt(string_view msg, int line, int col) {
       "Error at %s:%d:%d:\n\t%s\n", file_name_, line, col, msg);
 }
 
+void ErrorReporter::ErrorAt(string_view msg, Span span) {
+  auto pos = lines_->At(span.offset);
+  ErrorAt(msg, pos.line + first_line_ - 1, pos.col);
+}
+
 void ErrorReporter::ErrorAt(string_view msg, const Token& token) {
-  switch (token.type) {
-    case TokenType::kEol:
-      StrAppendFormat(&buffer_, "Error at end of line in %s:%d:\n\t%s\n",
-          file_name_, token.line - 1, msg);
-      break;
-    case TokenType::kEof:
-      StrAppendFormat(&buffer_, "Error at end of file in %s:\n\t%s\n", file_name_, msg);
-      break;
-    default:
-      StrAppendFormat(&buffer_, "Error at '%s' in %s:%d:%d:\n\t%s\n", token.lexeme, file_name_,
-          token.line, token.col - static_cast<int>(token.lexeme.size()), msg);
+  if (token.type == TokenType::kEof) {
+    StrAppendFormat(&buffer_, "Error at end of file in %s:\n\t%s\n", file_name_, msg);
+    return;
+  }
+
+  auto pos = lines_->At(token.span.offset);
+  pos.line += first_line_ - 1;
+  if (token.type == TokenType::kEol) {
+    StrAppendFormat(&buffer_, "Error at end of line in %s:%d:\n\t%s\n",
+        file_name_, pos.line, msg);
+  } else {
+    StrAppendFormat(&buffer_, "Error at '%s' in %s:%d:%d:\n\t%s\n", token.lexeme, file_name_,
+        pos.line, pos.col, msg);
   }
 }
 
+void ErrorReporter::ShareSource(const ErrorReporter& other) {
+  other.lines_->At(0); // a pending source is scanned on the first lookup
+  lines_ = other.lines_;
+  first_line_ = other.first_line_;
+}
+
 void ErrorReporter::Error(string_view msg) {
   StrAppendFormat(&buffer_, "Error in %s:\n\t%s\n", file_name_, msg);
 }
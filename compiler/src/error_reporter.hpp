@@ -9,6 +9,7 @@
 #include <utility>
 #include "absl/strings/string_view.h"
 #include "parser/token.hpp"
+#include "line_table.hpp"
 
 namespace helium {
 
@@ -18,19 +19,52 @@ class ErrorReporter {
  private:
   absl::string_view file_name_;
   std::string buffer_;
+  LineTable own_lines_;
+  const LineTable* lines_; // spans are resolved with it
+  int first_line_; // of the source the spans are in
 
  public:
   ErrorReporter() = delete;
+  ErrorReporter(const ErrorReporter&) = delete;
+  ErrorReporter& operator =(const ErrorReporter&) = delete;
   explicit ErrorReporter(absl::string_view file_name)
   : file_name_(file_name),
-    buffer_()
+    buffer_(),
+    own_lines_(),
+    lines_(&own_lines_),
+    first_line_(1)
   {}
 
   bool HadErrors() const { return !buffer_.empty(); }
   const std::string& GetErrors() const { return buffer_; }
+  absl::string_view FileName() const { return file_name_; }
+
+  // reports the errors of another reporter after the ones reported so far
+  void Append(const ErrorReporter& other) { buffer_ += other.buffer_; }
+  // errors formatted by a reporter, e.g. a part of its GetErrors()
+  void Append(absl::string_view errors) { buffer_.append(errors.data(), errors.size()); }
+
+  // source of the spans, must outlive this object
+  void SetSource(absl::string_view source) {
+    own_lines_.Reset(source);
+    lines_ = &own_lines_;
+  }
+
+  // the source of the spans is a part of a larger one that starts at the
+  // beginning of the given line
+  void SetFirstLine(int line) { first_line_ = line; }
+
+  // for sources that aren't kept in memory as a whole
+  void SetLines(const LineTable& lines) { lines_ = &lines; }
+
+  // resolves spans like the other reporter does, it must outlive this one.
+  // Reporters sharing a source can report on different threads once
+  // they are set up
+  void ShareSource(const ErrorReporter& other);
 
   // TODO: think about better formatting
   void ErrorAt(absl::string_view msg, int line, int col);
+  void ErrorAt(absl::string_view msg, Span span);
   void ErrorAt(absl::string_view msg, const Token& token);
 
   void Error(absl::string_view msg);
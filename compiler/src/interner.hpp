@@ -5,29 +5,97 @@
 #ifndef HELIUM_COMPILER_SRC_INTERNER_HPP_
 #define HELIUM_COMPILER_SRC_INTERNER_HPP_
 
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
 #include "absl/container/flat_hash_map.h"
 #include <absl/strings/string_view.h>
 
 namespace helium {
 
 class Interner {
-  ::absl::flat_hash_map<::absl::string_view, size_t> map_;
+  // the hash is computed once, usually by the lexer
+  struct Key {
+    ::absl::string_view name;
+    uint32_t hash;
+  };
+
+  struct KeyHash {
+    size_t operator ()(const Key& key) const { return key.hash; }
+  };
+
+  struct KeyEq {
+    bool operator ()(const Key& a, const Key& b) const {
+      return a.hash == b.hash && a.name == b.name;
+    }
+  };
+
+  ::absl::flat_hash_map<Key, size_t, KeyHash, KeyEq> map_;
   ::std::vector<::absl::string_view> vec_;
+  ::std::vector<::std::unique_ptr<char[]>> owned_; // copies made by Own()
 
  public:
   using Data = size_t;
 
+  // hashes 8 bytes at a time, the result is well mixed in all bits
+  static uint32_t Hash(::absl::string_view s) {
+    constexpr uint64_t kMul = 0x9E3779B97F4A7C15u;
+    uint64_t hash = 0xA0761D6478BD642Fu ^ s.size();
+    const char* data = s.data();
+    size_t size = s.size();
+
+    uint64_t word;
+    for (; size > 8; data += 8, size -= 8) {
+      ::std::memcpy(&word, data, 8);
+      hash = Mix(hash ^ word, kMul);
+    }
+
+    word = 0;
+    if (size > 0) ::std::memcpy(&word, data, size);
+    hash = Mix(Mix(hash ^ word, kMul), kMul);
+    return static_cast<uint32_t>(hash ^ (hash >> 32));
+  }
+
   Data Intern(::absl::string_view s) {
-    auto it = map_.find(s);
-    if (it != map_.end()) return it->second;
-    map_[s] = vec_.size();
-    vec_.push_back(s);
-    return vec_.size() - 1;
+    return Intern(s, Hash(s));
+  }
+
+  // hash must be Hash(s)
+  Data Intern(::absl::string_view s, uint32_t hash) {
+    auto result = map_.emplace(Key{s, hash}, vec_.size());
+    if (result.second) vec_.push_back(s);
+    return result.first->second;
+  }
+
+  // names are numbered from 0 in the order they were interned
+  size_t Size() const { return vec_.size(); }
+
+  // copies the names numbered from `from` on into memory of the interner,
+  // so the source they were interned from may go away
+  void Own(Data from) {
+    for (auto data = from; data < vec_.size(); data++) {
+      auto name = vec_[data];
+      auto hash = Hash(name);
+      owned_.emplace_back(new char[name.size() + 1]);
+      ::std::memcpy(owned_.back().get(), name.data(), name.size());
+
+      ::absl::string_view copy(owned_.back().get(), name.size());
+      map_.erase(Key{name, hash});
+      map_.emplace(Key{copy, hash}, data);
+      vec_[data] = copy;
+    }
   }
 
   ::absl::optional<::absl::string_view> LookUp(Data data) const {
     return data < vec_.size() ? ::absl::make_optional(vec_[data]) : ::absl::nullopt;
   }
+
+ private:
+  static uint64_t Mix(uint64_t a, uint64_t b) {
+    auto product = static_cast<unsigned __int128>(a) * b;
+    return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+  }
 };
 
 }
@@ -0,0 +1,39 @@
+#include <algorithm>
+#include "line_table.hpp"
+#include "parser/scan.hpp"
+
+namespace helium {
+
+void LineTable::Reset(absl::string_view source) {
+  pending_ = source;
+  starts_.assign(1, 0);
+}
+
+void LineTable::Append(absl::string_view text, uint32_t base) {
+  Scan(text, base);
+}
+
+void LineTable::Scan(absl::string_view text, uint32_t base) const {
+  const auto& scan = scan::Active();
+  for (size_t pos = 0;; pos++) {
+    pos = scan.line(text.data(), pos, text.size());
+    if (pos == text.size()) break;
+    starts_.push_back(base + static_cast<uint32_t>(pos) + 1);
+  }
+}
+
+LineTable::Position LineTable::At(uint32_t offset) const {
+  if (!pending_.empty()) {
+    Scan(pending_, 0);
+    pending_ = {};
+  }
+
+  // the last line start that is not after the offset
+  auto it = ::std::upper_bound(starts_.begin(), starts_.end(), offset) - 1;
+  return {
+      static_cast<int>(it - starts_.begin()) + 1,
+      static_cast<int>(offset - *it) + 1
+  };
+}
+
+}
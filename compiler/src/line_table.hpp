@@ -0,0 +1,44 @@
+#ifndef HELIUM_COMPILER_SRC_LINE_TABLE_HPP_
+#define HELIUM_COMPILER_SRC_LINE_TABLE_HPP_
+
+#include <cstdint>
+#include <vector>
+#include "absl/strings/string_view.h"
+
+namespace helium {
+
+// offsets of line starts of a source, used to turn an offset
+// into a line and a column. A whole source is scanned lazily,
+// on the first lookup; streamed sources are added piece by piece
+class LineTable final {
+  mutable absl::string_view pending_; // not scanned yet
+  mutable std::vector<uint32_t> starts_;
+
+ public:
+  struct Position {
+    int line;
+    int col;
+  };
+
+  LineTable()
+  : pending_(),
+    starts_(1, 0)
+  {}
+
+  // source must outlive the table
+  void Reset(absl::string_view source);
+
+  // text goes right after the previously appended one,
+  // scanned immediately so it doesn't have to outlive the table
+  void Append(absl::string_view text, uint32_t base);
+
+  // both are 1-based
+  Position At(uint32_t offset) const;
+
+ private:
+  void Scan(absl::string_view text, uint32_t base) const;
+};
+
+}
+
+#endif //HELIUM_COMPILER_SRC_LINE_TABLE_HPP_
@@ -0,0 +1,36 @@
+#ifndef HELIUM_COMPILER_SRC_PARALLEL_HPP_
+#define HELIUM_COMPILER_SRC_PARALLEL_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace helium {
+
+// calls f(i) for every i in [0, tasks) on the given number of threads,
+// the calling thread is one of them
+template <typename F>
+void RunParallel(size_t tasks, size_t threads, F f) {
+  ::std::atomic<size_t> next(0);
+  auto work = [&]() {
+    for (size_t i; (i = next++) < tasks;) {
+      f(i);
+    }
+  };
+
+  ::std::vector<::std::thread> pool;
+  for (size_t i = 1; i < ::std::min(threads, tasks); i++) {
+    pool.emplace_back(work);
+  }
+
+  work();
+  for (auto& thread : pool) {
+    thread.join();
+  }
+}
+
+}
+
+#endif //HELIUM_COMPILER_SRC_PARALLEL_HPP_
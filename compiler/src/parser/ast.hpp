@@ -5,16 +5,20 @@
 #ifndef HELIUM_COMPILER_SRC_AST_HPP_
 #define HELIUM_COMPILER_SRC_AST_HPP_
 
+#include <cassert>
+#include <cstdint>
 #include <vector>
 #include <utility>
 #include <sema/type.hpp>
 #include "absl/memory/memory.h"
+#include "ast_arena.hpp"
+#include "constant_pool.hpp"
 #include "token.hpp"
 #include "visitor.hpp"
 
 namespace helium {
 
-enum class IntrinsicOp {
+enum class IntrinsicOp : uint8_t {
   kNone, // used in constructor
   kRealAdd,
   kIntAdd,
@@ -28,6 +32,16 @@ enum class IntrinsicOp {
   kIntNeg
 };
 
+// What the Resolver bound a name to: the declaration, numbered in
+// the order of the program, and the slot of the local in its frame
+struct Resolution {
+  uint32_t symbol;
+  uint32_t slot;
+};
+
+// names are unresolved until the Resolver runs or if they aren't declared
+constexpr Resolution kUnresolved = {UINT32_MAX, UINT32_MAX};
+
 class Pattern {
  public:
   virtual ~Pattern() = default;
@@ -35,70 +49,156 @@ class Pattern {
 };
 
 class TypedPattern : public Pattern {
-  Token name_;
-  ::std::unique_ptr<Type> type_; // Might be null, in which case type is inferred
+  Interner::Data name_;
+  Span span_;
+  Type* type_; // Might be null, in which case type is inferred
+  Resolution resolution_;
 
  public:
   TypedPattern() = delete;
-  TypedPattern(const Token& name, ::std::unique_ptr<Type> type)
+  TypedPattern(Interner::Data name, Span span, Type* type)
       : name_(name),
-        type_(::std::move(type))
+        span_(span),
+        type_(type),
+        resolution_(kUnresolved)
   {}
 
   void Accept(PatternVisitor& visitor) override {
     visitor.Visit(*this);
   }
 
-  const ::std::unique_ptr<Type>& GetType() const {
+  Type* GetType() const {
     return type_;
   }
 
-  const Token& GetName() const {
+  void SetType(Type* type) {
+    type_ = type;
+  }
+
+  Resolution GetResolution() const { return resolution_; }
+  void Resolve(Resolution resolution) { resolution_ = resolution; }
+
+  Interner::Data GetName() const {
     return name_;
   }
+
+  void SetName(Interner::Data name) {
+    name_ = name;
+  }
+
+  Span GetSpan() const {
+    return span_;
+  }
+};
+
+enum class AstKind : uint8_t {
+  kVariable,
+  kBinary,
+  kAssign,
+  kUnary,
+  kLiteral,
+  kIdentifier,
+  kBlock,
+  kIf,
+  kWhile
 };
 
 class AstNode {
+  const AstKind kind_;
+
+ protected:
+  explicit AstNode(AstKind kind)
+  : kind_(kind)
+  {}
+
  public:
   virtual ~AstNode() = default;
   virtual void Accept(AstVisitor& visitor) = 0;
-  virtual bool IsExpr() const { return false; }
+
+  AstKind GetKind() const { return kind_; }
+  bool IsExpr() const { return kind_ != AstKind::kVariable; }
 };
 
-using AstTree = ::std::vector<::std::unique_ptr<AstNode>>;
+// parses the bodies of blocks that were skipped by the parser
+class BlockSource {
+ public:
+  virtual ~BlockSource() = default;
+  // the body is made of tokens in [begin, end)
+  virtual ::std::vector<AstNode*> ParseBody(uint32_t begin, uint32_t end) = 0;
+};
+
+// top level nodes of a program, the arena owns them and all their children
+class AstTree final {
+  AstArena arena_;
+  ::std::vector<AstNode*> nodes_;
+  ::std::unique_ptr<BlockSource> lazy_; // of skipped blocks, might be null
+
+ public:
+  using const_iterator = ::std::vector<AstNode*>::const_iterator;
+
+  AstTree() = default;
+  AstTree(AstArena&& arena, ::std::vector<AstNode*>&& nodes)
+  : arena_(::std::move(arena)),
+    nodes_(::std::move(nodes))
+  {}
+
+  AstTree(AstArena&& arena, ::std::vector<AstNode*>&& nodes,
+          ::std::unique_ptr<BlockSource>&& lazy)
+  : arena_(::std::move(arena)),
+    nodes_(::std::move(nodes)),
+    lazy_(::std::move(lazy))
+  {}
+
+  AstTree(AstTree&&) = default;
+  AstTree& operator =(AstTree&&) = default;
+
+  const_iterator begin() const { return nodes_.begin(); }
+  const_iterator end() const { return nodes_.end(); }
+  size_t size() const { return nodes_.size(); }
+  bool empty() const { return nodes_.empty(); }
+  AstNode* operator [](size_t i) const { return nodes_[i]; }
+
+  const AstArena& Arena() const { return arena_; }
+  // block bodies might still be parsed when they are first walked
+  bool IsLazy() const { return lazy_ != nullptr; }
+};
 
 class Expr : public AstNode {
  protected:
-  ::std::unique_ptr<Type> type_;
+  const Type* type_; // owned by the TypeContext of the check
+
+  explicit Expr(AstKind kind)
+  : AstNode(kind),
+    type_(nullptr)
+  {}
 
  public:
-  virtual const ::std::unique_ptr<Type>& GetType() const {
+  const Type* GetType() const {
     return type_;
   }
 
-  bool IsExpr() const final { return true; }
-
-  virtual void SetType(::std::unique_ptr<Type> type) {
-    type_ = ::std::move(type);
+  void SetType(const Type* type) {
+    type_ = type;
   }
 };
 
 class VariableStmt final : public AstNode {
-  ::std::unique_ptr<Pattern> pattern_;
-  ::std::unique_ptr<Expr> expr_;
+  Pattern* pattern_;
+  Expr* expr_;
 
  public:
   VariableStmt() = delete;
-  VariableStmt(::std::unique_ptr<Pattern> pattern, ::std::unique_ptr<Expr> expr)
-  : pattern_(::std::move(pattern)),
-    expr_(::std::move(expr))
+  VariableStmt(Pattern* pattern, Expr* expr)
+  : AstNode(AstKind::kVariable),
+    pattern_(pattern),
+    expr_(expr)
   {}
 
-  const ::std::unique_ptr<Pattern>& GetPattern() const {
+  Pattern* GetPattern() const {
     return pattern_;
   }
 
-  const ::std::unique_ptr<Expr>& GetExpr() const {
+  Expr* GetExpr() const {
     return expr_;
   }
 
@@ -108,23 +208,27 @@ class VariableStmt final : public AstNode {
 };
 
 class BinaryExpr final : public Expr {
-  ::std::unique_ptr<Expr> left_;
-  Token op_;
-  ::std::unique_ptr<Expr> right_;
+  Expr* left_;
+  Expr* right_;
+  Span span_; // of the operator
+  TokenType op_;
   IntrinsicOp intrinsic_;
 
  public:
   BinaryExpr() = delete;
-  BinaryExpr(::std::unique_ptr<Expr> left, Token op, ::std::unique_ptr<Expr> right)
-  : left_(::std::move(left)),
+  BinaryExpr(Expr* left, TokenType op, Span span, Expr* right)
+  : Expr(AstKind::kBinary),
+    left_(left),
+    right_(right),
+    span_(span),
     op_(op),
-    right_(::std::move(right)),
     intrinsic_(IntrinsicOp::kNone)
   {}
 
-  const ::std::unique_ptr<Expr>& Left() const { return left_; }
-  const Token& Op() const { return op_; }
-  const ::std::unique_ptr<Expr>& Right() const { return right_; }
+  Expr* Left() const { return left_; }
+  TokenType Op() const { return op_; }
+  Span GetSpan() const { return span_; }
+  Expr* Right() const { return right_; }
 
   IntrinsicOp GetIntrinsic() const { return intrinsic_; }
   void SetIntrinsic(IntrinsicOp value) { intrinsic_ = value; }
@@ -135,50 +239,71 @@ class BinaryExpr final : public Expr {
 };
 
 class AssignExpr final : public Expr {
-  ::std::unique_ptr<Expr> receiver_;
-  Token name_;
-  ::std::unique_ptr<Expr> expr_;
+  Expr* receiver_;
+  Interner::Data name_;
+  Span span_; // of the name
+  Expr* expr_;
+  Resolution resolution_;
 
  public:
   AssignExpr() = delete;
-  AssignExpr(::std::unique_ptr<Expr> receiver, const Token& name, ::std::unique_ptr<Expr> expr)
-  : receiver_(::std::move(receiver)),
+  AssignExpr(Expr* receiver, Interner::Data name, Span span,
+             Expr* expr)
+  : ::helium::Expr(AstKind::kAssign),
+    receiver_(receiver),
     name_(name),
-    expr_(::std::move(expr))
+    span_(span),
+    expr_(expr),
+    resolution_(kUnresolved)
   {}
 
-  const ::std::unique_ptr<Expr>& Receiver() const {
+  Expr* Receiver() const {
     return receiver_;
   }
 
-  const Token& Name() const {
+  Interner::Data Name() const {
     return name_;
   }
 
-  const ::std::unique_ptr<Expr>& Expr() const {
+  void SetName(Interner::Data name) {
+    name_ = name;
+  }
+
+  Span GetSpan() const {
+    return span_;
+  }
+
+  Expr* Expr() const {
     return expr_;
   }
 
+  Resolution GetResolution() const { return resolution_; }
+  void Resolve(Resolution resolution) { resolution_ = resolution; }
+
   void Accept(AstVisitor& visitor) override {
     visitor.Visit(*this);
   }
 };
 
 class UnaryExpr final : public Expr {
-  Token op_;
-  ::std::unique_ptr<Expr> operand_;
+  Expr* operand_;
+  Span span_; // of the operator
+  TokenType op_;
   IntrinsicOp intrinsic_;
 
  public:
   UnaryExpr() = delete;
-  UnaryExpr(Token op, ::std::unique_ptr<Expr> operand)
-  : op_(op),
-    operand_(::std::move(operand)),
+  UnaryExpr(TokenType op, Span span, Expr* operand)
+  : Expr(AstKind::kUnary),
+    operand_(operand),
+    span_(span),
+    op_(op),
     intrinsic_(IntrinsicOp::kNone)
   {}
 
-  const Token& Op() const { return op_; }
-  const ::std::unique_ptr<Expr>& Operand() const { return operand_; }
+  TokenType Op() const { return op_; }
+  Span GetSpan() const { return span_; }
+  Expr* Operand() const { return operand_; }
 
   IntrinsicOp GetIntrinsic() const { return intrinsic_; }
   void SetIntrinsic(IntrinsicOp value) { intrinsic_ = value; }
@@ -197,15 +322,31 @@ class UnaryExpr final : public Expr {
 //  kFalse,
 //  kUnit
 class LiteralExpr final : public Expr {
-  Token value_;
+  Interner::Data value_; // lexeme
+  Span span_;
+  ConstantPool::Index constant_; // value of kInt and kReal
+  TokenType kind_;
 
  public:
   LiteralExpr() = delete;
-  explicit LiteralExpr(Token value)
-  : value_(value)
+  LiteralExpr(TokenType kind, Interner::Data value, Span span,
+              ConstantPool::Index constant = ConstantPool::kNone)
+  : Expr(AstKind::kLiteral),
+    value_(value),
+    span_(span),
+    constant_(constant),
+    kind_(kind)
   {}
 
-  const Token& Value() const { return value_; }
+  TokenType Kind() const { return kind_; }
+  Interner::Data Value() const { return value_; }
+  ConstantPool::Index Constant() const { return constant_; }
+  Span GetSpan() const { return span_; }
+
+  void SetValue(Interner::Data value, ConstantPool::Index constant) {
+    value_ = value;
+    constant_ = constant;
+  }
 
   void Accept(AstVisitor& visitor) override {
     visitor.Visit(*this);
@@ -213,23 +354,26 @@ class LiteralExpr final : public Expr {
 };
 
 class IdentifierExpr final : public Expr {
-  Token value_;
-
-  // depth in the locals array in vm
-  // TODO: reconsider this when functions are added
-  uint16_t local_depth_;
+  Interner::Data name_;
+  Span span_;
+  // TODO: reconsider the slots when functions are added
+  Resolution resolution_;
 
  public:
   IdentifierExpr() = delete;
-  explicit IdentifierExpr(const Token& value)
-  : value_(value),
-    local_depth_(0)
+  IdentifierExpr(Interner::Data name, Span span)
+  : Expr(AstKind::kIdentifier),
+    name_(name),
+    span_(span),
+    resolution_(kUnresolved)
   {}
 
-  const Token& Value() const { return value_; }
+  Interner::Data Name() const { return name_; }
+  void SetName(Interner::Data name) { name_ = name; }
+  Span GetSpan() const { return span_; }
 
-  uint16_t GetDepth() const { return local_depth_; }
-  void SetDepth(uint16_t depth) { local_depth_ = depth; }
+  Resolution GetResolution() const { return resolution_; }
+  void Resolve(Resolution resolution) { resolution_ = resolution; }
 
   void Accept(AstVisitor& visitor) override {
     visitor.Visit(*this);
@@ -238,40 +382,64 @@ class IdentifierExpr final : public Expr {
 
 class BlockExpr final : public Expr {
   // TODO: decide to use absl::inlined_vector
-  ::std::vector<::std::unique_ptr<AstNode>> body_;
+  mutable ::std::vector<AstNode*> body_;
+  mutable BlockSource* source_; // until a skipped body is parsed
+  uint32_t begin_;
+  uint32_t end_;
 
  public:
   BlockExpr() = delete;
-  explicit BlockExpr(::std::vector<::std::unique_ptr<AstNode>>&& body)
-  : body_(::std::move(body))
+  explicit BlockExpr(::std::vector<AstNode*>&& body)
+  : Expr(AstKind::kBlock),
+    body_(::std::move(body)),
+    source_(nullptr),
+    begin_(0),
+    end_(0)
+  {}
+
+  // the body is parsed from the source on first access
+  BlockExpr(BlockSource& source, uint32_t begin, uint32_t end)
+  : Expr(AstKind::kBlock),
+    body_(),
+    source_(&source),
+    begin_(begin),
+    end_(end)
   {}
 
-  const ::std::vector<::std::unique_ptr<AstNode>>& Body() const {
+  const ::std::vector<AstNode*>& Body() const {
+    if (source_) {
+      body_ = source_->ParseBody(begin_, end_);
+      source_ = nullptr;
+    }
+
     return body_;
   }
 
+  bool IsParsed() const { return source_ == nullptr; }
+
   void Accept(AstVisitor& visitor) override {
     visitor.Visit(*this);
   }
 };
 
 class IfExpr final : public Expr {
-  ::std::unique_ptr<Expr> cond_;
-  ::std::unique_ptr<Expr> then_;
-  ::std::unique_ptr<Expr> else_;
+  Expr* cond_;
+  Expr* then_;
+  Expr* else_;
 
  public:
   IfExpr() = delete;
-  IfExpr(::std::unique_ptr<Expr> condition, ::std::unique_ptr<Expr> then_branch,
-         ::std::unique_ptr<Expr> else_branch)
-  : cond_(::std::move(condition)),
-    then_(::std::move(then_branch)),
-    else_(::std::move(else_branch))
+  IfExpr(Expr* condition, Expr* then_branch,
+         Expr* else_branch)
+  : Expr(AstKind::kIf),
+    cond_(condition),
+    then_(then_branch),
+    else_(else_branch)
   {}
 
-  const ::std::unique_ptr<Expr>& Cond() const { return cond_; }
-  const ::std::unique_ptr<Expr>& Then() const { return then_; }
-  const ::std::unique_ptr<Expr>& Else() const { return else_; }
+  Expr* Cond() const { return cond_; }
+  Expr* Then() const { return then_; }
+  Expr* Else() const { return else_; }
 
   void Accept(AstVisitor& visitor) override {
     visitor.Visit(*this);
@@ -279,24 +447,92 @@ class IfExpr final : public Expr {
 };
 
 class WhileExpr final : public Expr {
-  ::std::unique_ptr<Expr> cond_;
-  ::std::unique_ptr<Expr> body_;
+  Expr* cond_;
+  Expr* body_;
 
  public:
   WhileExpr() = delete;
-  WhileExpr(::std::unique_ptr<Expr> condition, ::std::unique_ptr<Expr> body)
-  : cond_(::std::move(condition)),
-    body_(::std::move(body))
+  WhileExpr(Expr* condition, Expr* body)
+  : Expr(AstKind::kWhile),
+    cond_(condition),
+    body_(body)
   {}
 
-  const ::std::unique_ptr<Expr>& Cond() const { return cond_; }
-  const ::std::unique_ptr<Expr>& Body() const { return body_; }
+  Expr* Cond() const { return cond_; }
+  Expr* Body() const { return body_; }
 
   void Accept(AstVisitor& visitor) override {
     visitor.Visit(*this);
   }
 };
 
+// Visits nodes with a switch on their kind instead of the two virtual
+// calls of Accept() and AstVisitor::Visit(). Visit() overloads of a final
+// Derived are called directly and can be inlined into the traversal:
+//
+//   class Pass final : public StaticAstVisitor<Pass> {
+//    public:
+//     void Visit(BinaryExpr& expr) { Dispatch(*expr.Left()); ... }
+//     ...
+//   };
+template <typename Derived, typename R = void>
+class StaticAstVisitor {
+ public:
+  R Dispatch(AstNode& node) {
+    auto& self = static_cast<Derived&>(*this);
+    switch (node.GetKind()) {
+      case AstKind::kVariable: return self.Visit(static_cast<VariableStmt&>(node));
+      case AstKind::kBinary: return self.Visit(static_cast<BinaryExpr&>(node));
+      case AstKind::kAssign: return self.Visit(static_cast<AssignExpr&>(node));
+      case AstKind::kUnary: return self.Visit(static_cast<UnaryExpr&>(node));
+      case AstKind::kLiteral: return self.Visit(static_cast<LiteralExpr&>(node));
+      case AstKind::kIdentifier: return self.Visit(static_cast<IdentifierExpr&>(node));
+      case AstKind::kBlock: return self.Visit(static_cast<BlockExpr&>(node));
+      case AstKind::kIf: return self.Visit(static_cast<IfExpr&>(node));
+      case AstKind::kWhile: return self.Visit(static_cast<WhileExpr&>(node));
+    }
+
+    assert(false && "Invalid node kind");
+    return R();
+  }
+};
+
+// The i-th child of a node in the order the children are evaluated,
+// null past the last one. Patterns and types are not nodes. Passes that
+// must survive deeply nested input walk the tree with it and a stack
+inline AstNode* ChildAt(const AstNode& node, size_t i) {
+  switch (node.GetKind()) {
+    case AstKind::kVariable:
+      return i == 0 ? static_cast<const VariableStmt&>(node).GetExpr() : nullptr;
+    case AstKind::kBinary: {
+      const auto& binary = static_cast<const BinaryExpr&>(node);
+      return i == 0 ? binary.Left() : i == 1 ? binary.Right() : nullptr;
+    }
+    case AstKind::kAssign:
+      return i == 0 ? static_cast<const AssignExpr&>(node).Expr() : nullptr;
+    case AstKind::kUnary:
+      return i == 0 ? static_cast<const UnaryExpr&>(node).Operand() : nullptr;
+    case AstKind::kLiteral:
+    case AstKind::kIdentifier:
+      return nullptr;
+    case AstKind::kBlock: {
+      const auto& body = static_cast<const BlockExpr&>(node).Body();
+      return i < body.size() ? body[i] : nullptr;
+    }
+    case AstKind::kIf: {
+      const auto& branch = static_cast<const IfExpr&>(node);
+      return i == 0 ? branch.Cond() : i == 1 ? branch.Then() : i == 2 ? branch.Else() : nullptr;
+    }
+    case AstKind::kWhile: {
+      const auto& loop = static_cast<const WhileExpr&>(node);
+      return i == 0 ? loop.Cond() : i == 1 ? loop.Body() : nullptr;
+    }
+  }
+
+  assert(false && "Invalid node kind");
+  return nullptr;
+}
+
 }
 
 #endif //HELIUM_COMPILER_SRC_AST_HPP_
@@ -0,0 +1,89 @@
+#include "ast_arena.hpp"
+#include "absl/memory/memory.h"
+
+namespace helium {
+
+constexpr size_t AstArena::kBlockSize;
+
+AstArena::AstArena(AstArena&& other) noexcept
+: blocks_(::std::move(other.blocks_)),
+  destructors_(::std::move(other.destructors_)),
+  merged_(::std::move(other.merged_)),
+  next_(other.next_),
+  end_(other.end_),
+  allocated_(other.allocated_) {
+  other.blocks_.clear();
+  other.destructors_.clear();
+  other.merged_.clear();
+  other.next_ = other.end_ = nullptr;
+  other.allocated_ = 0;
+}
+
+AstArena& AstArena::operator =(AstArena&& other) noexcept {
+  if (this == &other) return *this;
+
+  Clear();
+  blocks_ = ::std::move(other.blocks_);
+  destructors_ = ::std::move(other.destructors_);
+  merged_ = ::std::move(other.merged_);
+  next_ = other.next_;
+  end_ = other.end_;
+  allocated_ = other.allocated_;
+
+  other.blocks_.clear();
+  other.destructors_.clear();
+  other.merged_.clear();
+  other.next_ = other.end_ = nullptr;
+  other.allocated_ = 0;
+  return *this;
+}
+
+void AstArena::Clear() {
+  // objects only point to each other, so the order doesn't matter
+  // for correctness, but the reverse one visits parents first
+  for (auto it = destructors_.rbegin(); it != destructors_.rend(); ++it) {
+    it->destroy(it->object);
+  }
+
+  destructors_.clear();
+  blocks_.clear();
+  merged_.clear();
+  next_ = end_ = nullptr;
+  allocated_ = 0;
+}
+
+void AstArena::Merge(AstArena&& other) {
+  if (this == &other) return;
+
+  // nodes stay where they are, the other arena is kept whole
+  allocated_ += other.allocated_;
+  merged_.push_back(::absl::make_unique<AstArena>(::std::move(other)));
+}
+
+size_t AstArena::Blocks() const {
+  size_t blocks = blocks_.size();
+  for (const auto& arena : merged_) {
+    blocks += arena->Blocks();
+  }
+
+  return blocks;
+}
+
+void* AstArena::AllocateSlow(size_t size, size_t align) {
+  // blocks come from new[] and are aligned for any node
+  const size_t worst = size + align;
+  if (worst > kBlockSize / 4) {
+    // a dedicated block, the current one is kept for small objects
+    blocks_.emplace_back(new char[worst]);
+    auto address = reinterpret_cast<uintptr_t>(blocks_.back().get());
+    allocated_ += size;
+    return blocks_.back().get() + (align - address % align) % align;
+  }
+
+  blocks_.emplace_back(new char[kBlockSize]);
+  next_ = blocks_.back().get();
+  end_ = next_ + kBlockSize;
+  return Allocate(size, align);
+}
+
+}
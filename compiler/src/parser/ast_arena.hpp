@@ -0,0 +1,92 @@
+#ifndef HELIUM_COMPILER_SRC_PARSER_AST_ARENA_HPP_
+#define HELIUM_COMPILER_SRC_PARSER_AST_ARENA_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace helium {
+
+// Owns the nodes of one ast. They are bump allocated in large blocks
+// and destroyed all at once (in reverse order, without recursion)
+// together with the arena, so nodes refer to each other with plain pointers.
+class AstArena final {
+ public:
+  static constexpr size_t kBlockSize = 64 * 1024;
+
+ private:
+  struct Destructor {
+    void* object;
+    void (*destroy)(void*);
+  };
+
+  ::std::vector<::std::unique_ptr<char[]>> blocks_;
+  ::std::vector<Destructor> destructors_; // of objects that need one
+  ::std::vector<::std::unique_ptr<AstArena>> merged_;
+  char* next_;
+  char* end_;
+  size_t allocated_; // bytes handed out
+
+ public:
+  AstArena()
+  : next_(nullptr),
+    end_(nullptr),
+    allocated_(0)
+  {}
+
+  AstArena(const AstArena&) = delete;
+  AstArena& operator =(const AstArena&) = delete;
+
+  AstArena(AstArena&& other) noexcept;
+  AstArena& operator =(AstArena&& other) noexcept;
+
+  ~AstArena() { Clear(); }
+
+  template <typename T, typename... Args>
+  T* New(Args&&... args) {
+    auto* object = new (Allocate(sizeof(T), alignof(T))) T(::std::forward<Args>(args)...);
+    if (!::std::is_trivially_destructible<T>::value) {
+      destructors_.push_back({object, &Destroy<T>});
+    }
+
+    return object;
+  }
+
+  void* Allocate(size_t size, size_t align) {
+    auto address = reinterpret_cast<uintptr_t>(next_);
+    auto padding = (align - address % align) % align;
+    if (next_ == nullptr || static_cast<size_t>(end_ - next_) < size + padding) {
+      return AllocateSlow(size, align);
+    }
+
+    auto* result = next_ + padding;
+    next_ = result + size;
+    allocated_ += size;
+    return result;
+  }
+
+  // destroys all objects and frees the memory
+  void Clear();
+
+  // takes over the objects of the other arena
+  void Merge(AstArena&& other);
+
+  size_t Blocks() const;
+  size_t Allocated() const { return allocated_; }
+
+ private:
+  void* AllocateSlow(size_t size, size_t align);
+
+  template <typename T>
+  static void Destroy(void* object) {
+    static_cast<T*>(object)->~T();
+  }
+};
+
+}
+
+#endif //HELIUM_COMPILER_SRC_PARSER_AST_ARENA_HPP_
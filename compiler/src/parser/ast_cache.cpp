@@ -0,0 +1,419 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+#include <vector>
+#include "ast_cache.hpp"
+
+namespace helium {
+namespace {
+
+using ::std::string;
+using ::std::vector;
+using ::absl::string_view;
+using ::absl::optional;
+using ::absl::nullopt;
+
+using Kind = FlatAst::Kind;
+
+constexpr char kMagic[4] = {'H', 'E', 'A', 'C'};
+constexpr uint32_t kVersion = 3;
+constexpr uint32_t kByteOrder = 0x01020304;
+constexpr size_t kAlign = 8;
+
+static_assert(sizeof(Kind) == 1 && sizeof(TokenType) == 1,
+              "The cache stores single byte enums");
+
+struct Header {
+  char magic[4];
+  uint32_t version;
+  uint32_t byte_order; // kByteOrder as written
+  uint32_t nodes;
+  uint32_t roots;
+  uint32_t names;
+  uint32_t constants;
+  uint32_t reserved;
+  uint64_t name_bytes;
+  uint64_t source_hash;
+  uint64_t source_size;
+  uint64_t size; // of the whole file, catches truncated ones
+};
+
+static_assert(sizeof(Header) % kAlign == 0, "Sections must stay aligned");
+
+// offsets of the sections, in the order they are stored
+struct Sections {
+  size_t kinds;
+  size_t ops;
+  size_t offsets;
+  size_t data;
+  size_t aux;
+  size_t ends;
+  size_t types;
+  size_t roots;
+  size_t name_ends; // uint64_t end of each name in the name bytes
+  size_t constant_kinds;
+  size_t constant_bits;
+  size_t names;
+  size_t size;
+};
+
+Sections Place(const Header& header) {
+  size_t at = sizeof(Header);
+  auto place = [&at](size_t bytes) {
+    auto offset = at;
+    at = (at + bytes + kAlign - 1) / kAlign * kAlign;
+    return offset;
+  };
+
+  const size_t nodes = header.nodes;
+  Sections sections{};
+  sections.kinds = place(nodes * sizeof(Kind));
+  sections.ops = place(nodes * sizeof(TokenType));
+  sections.offsets = place(nodes * sizeof(uint32_t));
+  sections.data = place(nodes * sizeof(uint32_t));
+  sections.aux = place(nodes * sizeof(uint32_t));
+  sections.ends = place(nodes * sizeof(FlatAst::Index));
+  sections.types = place(nodes * sizeof(FlatAst::TypeId));
+  sections.roots = place(header.roots * sizeof(FlatAst::Index));
+  sections.name_ends = place(header.names * sizeof(uint64_t));
+  sections.constant_kinds = place(header.constants * sizeof(ConstantPool::Kind));
+  sections.constant_bits = place(header.constants * sizeof(uint64_t));
+  sections.names = place(header.name_bytes);
+  sections.size = at;
+  return sections;
+}
+
+template <typename T>
+void Put(vector<char>& image, size_t offset, const FlatColumn<T>& column) {
+  if (column.size() == 0) return;
+  ::std::memcpy(image.data() + offset, column.data(), column.size() * sizeof(T));
+}
+
+template <typename T>
+void View(char* image, size_t offset, size_t size, FlatColumn<T>& column) {
+  column.View(reinterpret_cast<T*>(image + offset), size);
+}
+
+uint64_t Mix(uint64_t a, uint64_t b) {
+  auto product = static_cast<unsigned __int128>(a) * b;
+  return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+}
+
+template <typename T>
+const T* At(const char* image, size_t offset) {
+  return reinterpret_cast<const T*>(image + offset);
+}
+
+bool IsName(uint32_t id, const Header& header) {
+  return id < header.names;
+}
+
+// The columns must describe an ast FlatAst::From() could have made,
+// whatever the bytes: the checker and the code generator trust it.
+// Enums are read as bytes, a value out of range isn't an enum value
+bool ValidNodes(const char* image, const Header& header, const Sections& sections) {
+  const auto* kinds = At<uint8_t>(image, sections.kinds);
+  const auto* ops = At<uint8_t>(image, sections.ops);
+  const auto* offsets = At<uint32_t>(image, sections.offsets);
+  const auto* data = At<uint32_t>(image, sections.data);
+  const auto* aux = At<uint32_t>(image, sections.aux);
+  const auto* ends = At<FlatAst::Index>(image, sections.ends);
+  const auto* types = At<FlatAst::TypeId>(image, sections.types);
+  const auto* roots = At<FlatAst::Index>(image, sections.roots);
+  const auto nodes = header.nodes;
+
+  auto op_is = [&](FlatAst::Index node, TokenType op) {
+    return ops[node] == static_cast<uint8_t>(op);
+  };
+
+  // every subtree lies within the ones open around it, so the children
+  // of a node can be walked
+  vector<FlatAst::Index> open;
+  for (FlatAst::Index node = 0; node < nodes; node++) {
+    while (!open.empty() && ends[open.back()] <= node) open.pop_back();
+    if (ends[node] <= node || ends[node] > nodes) return false;
+    if (!open.empty() && ends[node] > ends[open.back()]) return false;
+    open.push_back(node);
+  }
+
+  for (FlatAst::Index node = 0; node < nodes; node++) {
+    if (offsets[node] > header.source_size) return false;
+    const auto type = types[node];
+    if (type != FlatAst::kNoType && type != FlatAst::kErrorType && !IsName(type, header)) {
+      return false;
+    }
+
+    size_t children = 0;
+    for (auto child = node + 1; child < ends[node]; child = ends[child]) children++;
+    // a pattern is only the first child of a variable
+    const auto first = node + 1;
+    const bool pattern_first = children > 0 &&
+                               kinds[first] == static_cast<uint8_t>(Kind::kPattern);
+    if (pattern_first && kinds[node] != static_cast<uint8_t>(Kind::kVariable)) return false;
+
+    bool valid;
+    switch (static_cast<Kind>(kinds[node])) {
+      case Kind::kVariable:
+        valid = children == 2 && pattern_first && op_is(node, TokenType::kVar);
+        break;
+      case Kind::kPattern:
+        valid = children == 0 && IsName(data[node], header) &&
+                (aux[node] == FlatAst::kNoType || IsName(aux[node], header)) &&
+                op_is(node, TokenType::kIdentifier);
+        break;
+      case Kind::kBinary:
+        valid = children == 2 && aux[node] <= static_cast<uint32_t>(IntrinsicOp::kIntNeg) &&
+                (op_is(node, TokenType::kPlus) || op_is(node, TokenType::kMinus) ||
+                 op_is(node, TokenType::kStar) || op_is(node, TokenType::kSlash));
+        break;
+      case Kind::kUnary:
+        valid = children == 1 && aux[node] <= static_cast<uint32_t>(IntrinsicOp::kIntNeg) &&
+                (op_is(node, TokenType::kPlus) || op_is(node, TokenType::kMinus));
+        break;
+      case Kind::kLiteral:
+        valid = children == 0 && IsName(data[node], header) &&
+                (aux[node] == ConstantPool::kNone || aux[node] < header.constants);
+        switch (static_cast<TokenType>(ops[node])) {
+          case TokenType::kInt:
+          case TokenType::kReal:
+          case TokenType::kChar:
+          case TokenType::kString:
+          case TokenType::kTrue:
+          case TokenType::kFalse:
+          case TokenType::kUnit:
+            break;
+          default:
+            valid = false;
+            break;
+        }
+        break;
+      case Kind::kIdentifier:
+        // the slot is only an annotation
+        valid = children == 0 && IsName(data[node], header) &&
+                op_is(node, TokenType::kIdentifier);
+        break;
+      case Kind::kBlock:
+        valid = op_is(node, TokenType::kLeftBrace);
+        break;
+      case Kind::kIf:
+        valid = (children == 2 || children == 3) && op_is(node, TokenType::kIf);
+        break;
+      case Kind::kWhile:
+        valid = children == 2 && op_is(node, TokenType::kWhile);
+        break;
+      case Kind::kAssign:
+        valid = children == 1 && IsName(data[node], header) &&
+                op_is(node, TokenType::kEqual);
+        break;
+      default:
+        valid = false;
+        break;
+    }
+
+    if (!valid) return false;
+  }
+
+  // the top level statements split the nodes
+  FlatAst::Index next = 0;
+  for (size_t i = 0; i < header.roots; i++) {
+    if (roots[i] != next || next >= nodes) return false;
+    next = ends[next];
+  }
+
+  return next == nodes;
+}
+
+bool WriteAll(int fd, const char* data, size_t size) {
+  while (size > 0) {
+    ssize_t n = write(fd, data, size);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+
+    data += n;
+    size -= static_cast<size_t>(n);
+  }
+
+  return true;
+}
+
+}
+
+AstCache::AstCache(AstCache&& other) noexcept
+: data_(other.data_),
+  size_(other.size_)
+{
+  other.data_ = nullptr;
+  other.size_ = 0;
+}
+
+AstCache::~AstCache() {
+  if (data_) munmap(data_, size_);
+}
+
+uint64_t AstCache::Hash(string_view source) {
+  // the same scheme as Interner::Hash(), without folding to 32 bits
+  constexpr uint64_t kMul = 0x9E3779B97F4A7C15u;
+  uint64_t hash = 0xA0761D6478BD642Fu ^ source.size();
+  const char* data = source.data();
+  size_t size = source.size();
+
+  uint64_t word;
+  for (; size > 8; data += 8, size -= 8) {
+    ::std::memcpy(&word, data, 8);
+    hash = Mix(hash ^ word, kMul);
+  }
+
+  word = 0;
+  if (size > 0) ::std::memcpy(&word, data, size);
+  return Mix(Mix(hash ^ word, kMul), kMul);
+}
+
+bool AstCache::Save(const string& path, string_view source, const FlatAst& ast,
+                    const Interner& interner, const ConstantPool& constants) {
+  Header header{};
+  ::std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.byte_order = kByteOrder;
+  header.nodes = ast.Size();
+  header.roots = static_cast<uint32_t>(ast.roots_.size());
+  header.names = static_cast<uint32_t>(interner.Size());
+  header.constants = static_cast<uint32_t>(constants.Size());
+  header.source_hash = Hash(source);
+  header.source_size = source.size();
+  for (size_t i = 0; i < interner.Size(); i++) {
+    header.name_bytes += interner.LookUp(i)->size();
+  }
+
+  auto sections = Place(header);
+  header.size = sections.size;
+
+  vector<char> image(sections.size);
+  ::std::memcpy(image.data(), &header, sizeof(header));
+  Put(image, sections.kinds, ast.kinds_);
+  Put(image, sections.ops, ast.ops_);
+  Put(image, sections.offsets, ast.offsets_);
+  Put(image, sections.data, ast.data_);
+  Put(image, sections.aux, ast.aux_);
+  Put(image, sections.ends, ast.ends_);
+  Put(image, sections.types, ast.types_);
+  Put(image, sections.roots, ast.roots_);
+
+  uint64_t end = 0;
+  for (size_t i = 0; i < interner.Size(); i++) {
+    auto name = *interner.LookUp(i);
+    ::std::memcpy(image.data() + sections.names + end, name.data(), name.size());
+    end += name.size();
+    ::std::memcpy(image.data() + sections.name_ends + i * sizeof(end), &end, sizeof(end));
+  }
+
+  for (size_t i = 0; i < constants.Size(); i++) {
+    const auto& constant = constants.Get(static_cast<ConstantPool::Index>(i));
+    image[sections.constant_kinds + i] = static_cast<char>(constant.kind);
+    ::std::memcpy(image.data() + sections.constant_bits + i * sizeof(uint64_t),
+                  &constant.bits, sizeof(uint64_t));
+  }
+
+  // readers never see a partially written file
+  auto temp = path + ".tmp" + ::std::to_string(getpid());
+  int fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) return false;
+
+  bool ok = WriteAll(fd, image.data(), image.size());
+  ok = close(fd) == 0 && ok;
+  ok = ok && rename(temp.c_str(), path.c_str()) == 0;
+  if (!ok) unlink(temp.c_str());
+  return ok;
+}
+
+optional<AstCache> AstCache::Load(const string& path, string_view source, FlatAst& ast,
+                                  Interner& interner, ConstantPool& constants) {
+  if (interner.Size() != 0 || constants.Size() != 0) return nullopt;
+
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return nullopt;
+
+  struct stat info{};
+  if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) ||
+      static_cast<size_t>(info.st_size) < sizeof(Header)) {
+    close(fd);
+    return nullopt;
+  }
+
+  // writable copy-on-write pages, the checker sets types in place
+  auto size = static_cast<size_t>(info.st_size);
+  void* addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) return nullopt;
+
+  AstCache cache(static_cast<char*>(addr), size);
+  char* image = cache.data_;
+
+  Header header;
+  ::std::memcpy(&header, image, sizeof(header));
+  if (::std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.version != kVersion ||
+      header.byte_order != kByteOrder ||
+      header.size != size ||
+      header.name_bytes > size ||
+      header.source_size != source.size() ||
+      header.source_hash != Hash(source)) {
+    return nullopt;
+  }
+
+  auto sections = Place(header);
+  if (sections.size != size || !ValidNodes(image, header, sections)) return nullopt;
+
+  // names and constants are added to fresh tables so a corrupt file
+  // leaves the given ones untouched. Names are hashed again, a stored
+  // hash would have to be checked against the name anyway
+  Interner names;
+  uint64_t begin = 0;
+  for (size_t i = 0; i < header.names; i++) {
+    uint64_t end;
+    ::std::memcpy(&end, image + sections.name_ends + i * sizeof(end), sizeof(end));
+    if (end < begin || end > header.name_bytes) return nullopt;
+
+    string_view name(image + sections.names + begin, end - begin);
+    if (names.Intern(name) != i) return nullopt;
+    begin = end;
+  }
+
+  ConstantPool pool;
+  for (size_t i = 0; i < header.constants; i++) {
+    auto kind = static_cast<ConstantPool::Kind>(image[sections.constant_kinds + i]);
+    ConstantPool::Constant constant{kind, 0};
+    ::std::memcpy(&constant.bits, image + sections.constant_bits + i * sizeof(uint64_t),
+                  sizeof(uint64_t));
+
+    ConstantPool::Index index;
+    switch (kind) {
+      case ConstantPool::Kind::kInt: index = pool.AddInt(constant.Int()); break;
+      case ConstantPool::Kind::kReal: index = pool.AddReal(constant.Real()); break;
+      default: return nullopt;
+    }
+
+    if (index != i) return nullopt;
+  }
+
+  interner = ::std::move(names);
+  constants = ::std::move(pool);
+
+  const size_t nodes = header.nodes;
+  View(image, sections.kinds, nodes, ast.kinds_);
+  View(image, sections.ops, nodes, ast.ops_);
+  View(image, sections.offsets, nodes, ast.offsets_);
+  View(image, sections.data, nodes, ast.data_);
+  View(image, sections.aux, nodes, ast.aux_);
+  View(image, sections.ends, nodes, ast.ends_);
+  View(image, sections.types, nodes, ast.types_);
+  View(image, sections.roots, header.roots, ast.roots_);
+  return optional<AstCache>(::std::move(cache));
+}
+
+}
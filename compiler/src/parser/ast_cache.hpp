@@ -0,0 +1,58 @@
+#ifndef HELIUM_COMPILER_SRC_PARSER_AST_CACHE_HPP_
+#define HELIUM_COMPILER_SRC_PARSER_AST_CACHE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "constant_pool.hpp"
+#include "flat_ast.hpp"
+#include "interner.hpp"
+
+namespace helium {
+
+// A parsed program on disk: the columns of a flat ast, the interned
+// names and the constants, each section 8-byte aligned. The file is the
+// image, it is mapped privately and the columns of a loaded ast point into
+// the mapping (the type checker writes to copy-on-write pages), so loading
+// only re-interns the names and re-adds the constants. A file is only
+// loaded for the source it was made from. It's in the native byte order
+// and layout, other machines just don't find it valid
+class AstCache final {
+  char* data_; // the mapping
+  size_t size_;
+
+  AstCache(char* data, size_t size)
+  : data_(data),
+    size_(size)
+  {}
+
+ public:
+  AstCache(const AstCache&) = delete;
+  AstCache& operator =(const AstCache&) = delete;
+  AstCache(AstCache&& other) noexcept;
+  ~AstCache();
+
+  // the key of a source, well mixed in all bits
+  static uint64_t Hash(::absl::string_view source);
+
+  // writes the parsed (not yet checked) ast to path, replacing it
+  // atomically. False on I/O errors
+  static bool Save(const ::std::string& path, ::absl::string_view source,
+                   const FlatAst& ast, const Interner& interner,
+                   const ConstantPool& constants);
+
+  // nullopt if the file is missing, corrupt or made from another source.
+  // interner and constants must be empty, they and ast keep pointers into
+  // the returned object which must outlive them
+  static ::absl::optional<AstCache> Load(const ::std::string& path,
+                                         ::absl::string_view source, FlatAst& ast,
+                                         Interner& interner, ConstantPool& constants);
+
+  size_t Size() const { return size_; }
+};
+
+}
+
+#endif //HELIUM_COMPILER_SRC_PARSER_AST_CACHE_HPP_
@@ -2,6 +2,7 @@
 // Created by vasniktel on 30.08.2019.
 //
 
+#include <vector>
 #include "token.hpp"
 #include "ast_printer.hpp"
 
@@ -10,163 +11,257 @@ namespace helium {
 using ::std::endl;
 using TT = TokenType;
 
-void AstPrinter::Visit(VariableStmt& node) {
-  os_ << "(var ";
-  node.GetPattern()->Accept(*this);
-  if (node.GetExpr()) {
-    os_ << ' ';
-    node.GetExpr()->Accept(*this);
-  }
-  os_ << ')';
-}
+void AstPrinter::Visit(VariableStmt& node) { Walk(node); }
+void AstPrinter::Visit(BinaryExpr& node) { Walk(node); }
+void AstPrinter::Visit(UnaryExpr& node) { Walk(node); }
+void AstPrinter::Visit(LiteralExpr& node) { Walk(node); }
+void AstPrinter::Visit(IdentifierExpr& node) { Walk(node); }
+void AstPrinter::Visit(BlockExpr& node) { Walk(node); }
+void AstPrinter::Visit(IfExpr& node) { Walk(node); }
+void AstPrinter::Visit(WhileExpr& node) { Walk(node); }
+void AstPrinter::Visit(AssignExpr& node) { Walk(node); }
 
-void AstPrinter::Visit(BinaryExpr& node) {
-  os_ << '(' << node.Op().lexeme;
-  
-  if (typed_) {
-    os_ << ':';
-    node.GetType()->Accept(*this);
-  }
-  
-  os_ << ' ';
-  node.Left()->Accept(*this);
-  os_ << ' ';
-  node.Right()->Accept(*this);
-  os_ << ')';
-}
+// A node is opened, its children are printed after their separators
+// and it is closed, with an explicit stack like the flat ast is printed
+void AstPrinter::Walk(AstNode& root) {
+  struct Entry {
+    AstNode* node;
+    size_t next; // child to be printed next
+  };
 
-void AstPrinter::Visit(UnaryExpr& node) {
-  os_ << '(' << node.Op().lexeme;
+  ::std::vector<Entry> stack;
+  Open(root);
+  stack.push_back({&root, 0});
+  while (!stack.empty()) {
+    auto& top = stack.back();
+    if (auto* child = ChildAt(*top.node, top.next)) {
+      Separate(*top.node, top.next++);
+      Open(*child);
+      stack.push_back({child, 0});
+      continue;
+    }
 
-  if (typed_) {
-    os_ << ':';
-    node.GetType()->Accept(*this);
+    os_ << ')';
+    stack.pop_back();
   }
-
-  os_ << ' ';
-  node.Operand()->Accept(*this);
-  os_ << ')';
 }
 
-void AstPrinter::Visit(LiteralExpr& node) {
-  auto name = "";
-  
-  switch (node.Value().type) {
-    case TokenType::kInt:
-      name = "int";
-      break;
-    case TokenType::kReal:
-      name = "real";
+void AstPrinter::Open(AstNode& node) {
+  switch (node.GetKind()) {
+    case AstKind::kVariable:
+      os_ << "(var ";
+      static_cast<VariableStmt&>(node).GetPattern()->Accept(*this);
       break;
-    case TokenType::kString:
-      name = "string";
+    case AstKind::kBinary: {
+      auto& expr = static_cast<BinaryExpr&>(node);
+      os_ << '(' << Spelling(expr.Op());
+      PrintType(expr.GetType());
       break;
-    case TokenType::kChar:
-      name = "char";
+    }
+    case AstKind::kUnary: {
+      auto& expr = static_cast<UnaryExpr&>(node);
+      os_ << '(' << Spelling(expr.Op());
+      PrintType(expr.GetType());
       break;
-    default: name = "lit";
-  }
-  
-  os_ << "(" << name;
+    }
+    case AstKind::kLiteral: {
+      auto& expr = static_cast<LiteralExpr&>(node);
+      auto name = "";
+      switch (expr.Kind()) {
+        case TT::kInt: name = "int"; break;
+        case TT::kReal: name = "real"; break;
+        case TT::kString: name = "string"; break;
+        case TT::kChar: name = "char"; break;
+        default: name = "lit";
+      }
 
-  if (typed_) {
-    os_ << ':';
-    node.GetType()->Accept(*this);
+      os_ << '(' << name;
+      PrintType(expr.GetType());
+      os_ << ' ' << *interner_.LookUp(expr.Value());
+      break;
+    }
+    case AstKind::kIdentifier: {
+      auto& expr = static_cast<IdentifierExpr&>(node);
+      os_ << "(id";
+      PrintType(expr.GetType());
+      os_ << ' ';
+      PrintName(expr.Name(), expr.GetResolution());
+      break;
+    }
+    case AstKind::kBlock:
+      os_ << "(block";
+      PrintType(static_cast<BlockExpr&>(node).GetType());
+      break;
+    case AstKind::kIf:
+      os_ << "(if";
+      PrintType(static_cast<IfExpr&>(node).GetType());
+      break;
+    case AstKind::kWhile:
+      os_ << "(while";
+      PrintType(static_cast<WhileExpr&>(node).GetType());
+      break;
+    case AstKind::kAssign: {
+      auto& expr = static_cast<AssignExpr&>(node);
+      os_ << "(=";
+      PrintType(expr.GetType());
+      // TODO: fix when classes are introduced
+      os_ << " (id ";
+      PrintName(expr.Name(), expr.GetResolution());
+      os_ << ") ";
+      break;
+    }
   }
-
-  os_ << ' ' << node.Value().lexeme << ")";
 }
 
-void AstPrinter::Visit(IdentifierExpr& node) {
-  os_ << "(id";
-
-  if (typed_) {
-    os_ << ':';
-    node.GetType()->Accept(*this);
+// printed before the i-th child of a node
+void AstPrinter::Separate(const AstNode& node, size_t i) {
+  switch (node.GetKind()) {
+    case AstKind::kAssign:
+      break;
+    case AstKind::kIf:
+      os_ << (i == 0 ? " " : i == 1 ? " then " : " else ");
+      break;
+    case AstKind::kWhile:
+      os_ << (i == 0 ? " " : " loop ");
+      break;
+    default:
+      os_ << ' ';
   }
-
-  os_ << ' ' << node.Value().lexeme << ')';
 }
 
-void AstPrinter::Visit(IfExpr& node) {
-  os_ << "(if";
-
-  if (typed_) {
-    os_ << ':';
-    node.GetType()->Accept(*this);
-  }
+void AstPrinter::Visit(const SingleType& type) {
+  os_ << *interner_.LookUp(type.GetTypeData()); // optional should not be empty
+}
 
-  os_ << ' ';
-  node.Cond()->Accept(*this);
-  os_ << " then ";
-  node.Then()->Accept(*this);
-  if (node.Else()) {
-    os_ << " else ";
-    node.Else()->Accept(*this);
+void AstPrinter::Visit(TypedPattern& pattern) {
+  PrintName(pattern.GetName(), pattern.GetResolution());
+  if (pattern.GetType()) {
+    os_ << " : ";
+    pattern.GetType()->Accept(*this);
   }
+}
 
-  os_ << ")";
+void AstPrinter::Visit(const ErrorType&) {
+  os_ << "_error";
 }
 
-void AstPrinter::Visit(WhileExpr& node) {
-  os_ << "(while";
+void AstPrinter::PrintName(Interner::Data name, Resolution resolution) {
+  os_ << *interner_.LookUp(name);
+  if (!resolved_) return;
+  if (resolution.slot == kUnresolved.slot) os_ << "#?";
+  else os_ << '#' << resolution.symbol << '@' << resolution.slot;
+}
 
-  if (typed_) {
-    os_ << ':';
-    node.GetType()->Accept(*this);
-  }
+void AstPrinter::PrintType(const Type* type) {
+  if (!typed_) return;
+  os_ << ':';
+  type->Accept(*this);
+}
 
-  os_ << ' ';
-  node.Cond()->Accept(*this);
-  os_ << " loop ";
-  node.Body()->Accept(*this);
-  os_ << ')';
+void AstPrinter::PrintType(FlatAst::TypeId type) {
+  if (!typed_) return;
+  os_ << ':';
+  if (type == FlatAst::kErrorType) os_ << "_error";
+  else os_ << *interner_.LookUp(type);
 }
 
-void AstPrinter::Visit(BlockExpr& node) {
-  os_ << "(block";
+void AstPrinter::Print(const FlatAst& ast) {
+  using Kind = FlatAst::Kind;
 
-  if (typed_) {
-    os_ << ':';
-    node.GetType()->Accept(*this);
-  }
-  
-  for (const auto& stmt : node.Body()) {
-    os_ << ' ';
-    stmt->Accept(*this);
-  }
+  struct Frame {
+    FlatAst::Index node;
+    int child; // the number of children printed so far
+  };
 
-  os_ << ')';
-}
+  ::std::vector<Frame> open;
+  for (FlatAst::Index node = 0; node < ast.Size(); node++) {
+    while (!open.empty() && ast.End(open.back().node) <= node) {
+      os_ << ')';
+      open.pop_back();
+    }
 
-void AstPrinter::Visit(AssignExpr& node) {
-  os_ << "(=";
-  
-  if (typed_) {
-    os_ << ':';
-    node.GetType()->Accept(*this);
-  }
+    if (!open.empty()) {
+      auto& parent = open.back();
+      switch (ast.GetKind(parent.node)) {
+        case Kind::kVariable:
+        case Kind::kAssign:
+          if (parent.child > 0) os_ << ' ';
+          break;
+        case Kind::kIf:
+          os_ << (parent.child == 0 ? " " : parent.child == 1 ? " then " : " else ");
+          break;
+        case Kind::kWhile:
+          os_ << (parent.child == 0 ? " " : " loop ");
+          break;
+        default:
+          os_ << ' ';
+      }
 
-  // TODO: fix when classes are introduced
-  os_ << ' ' << node.Name().lexeme << ' ';
-  node.Expr()->Accept(*this);
-  os_ << ')';
-}
+      parent.child++;
+    }
 
-void AstPrinter::Visit(SingleType& type) {
-  os_ << *interner_.LookUp(type.GetTypeData()); // optional should not be empty
-}
+    const auto type = ast.GetType(node);
+    switch (ast.GetKind(node)) {
+      case Kind::kVariable:
+        os_ << "(var ";
+        break;
+      case Kind::kPattern:
+        os_ << *interner_.LookUp(ast.Data(node));
+        if (ast.Aux(node) != FlatAst::kNoType) {
+          os_ << " : " << *interner_.LookUp(ast.Aux(node));
+        }
+        break;
+      case Kind::kBinary:
+      case Kind::kUnary:
+        os_ << '(' << Spelling(ast.Op(node));
+        PrintType(type);
+        break;
+      case Kind::kLiteral: {
+        auto name = "";
+        switch (ast.Op(node)) {
+          case TT::kInt: name = "int"; break;
+          case TT::kReal: name = "real"; break;
+          case TT::kString: name = "string"; break;
+          case TT::kChar: name = "char"; break;
+          default: name = "lit";
+        }
 
-void AstPrinter::Visit(TypedPattern& pattern) {
-  os_ << pattern.GetName().lexeme;
-  if (pattern.GetType()) {
-    os_ << " : ";
-    pattern.GetType()->Accept(*this);
+        os_ << '(' << name;
+        PrintType(type);
+        os_ << ' ' << *interner_.LookUp(ast.Data(node));
+        break;
+      }
+      case Kind::kIdentifier:
+        os_ << "(id";
+        PrintType(type);
+        os_ << ' ' << *interner_.LookUp(ast.Data(node));
+        break;
+      case Kind::kBlock:
+        os_ << "(block";
+        PrintType(type);
+        break;
+      case Kind::kIf:
+        os_ << "(if";
+        PrintType(type);
+        break;
+      case Kind::kWhile:
+        os_ << "(while";
+        PrintType(type);
+        break;
+      case Kind::kAssign:
+        os_ << "(=";
+        PrintType(type);
+        os_ << " (id " << *interner_.LookUp(ast.Data(node)) << ") ";
+        break;
+    }
+
+    if (!ast.IsLeaf(node)) open.push_back({node, 0});
+    else if (ast.GetKind(node) != Kind::kPattern) os_ << ')';
   }
-}
 
-void AstPrinter::Visit(ErrorType&) {
-  os_ << "_error";
+  for (size_t i = 0; i < open.size(); i++) {
+    os_ << ')';
+  }
 }
 
 }
@@ -7,19 +7,28 @@
 
 #include <ostream>
 #include "ast.hpp"
+#include "flat_ast.hpp"
 #include "sema/type.hpp"
 #include "sema/type_check.hpp"
 
 namespace helium {
 
-class AstPrinter : public AstVisitor, public PatternVisitor, public TypeVisitor {
+// Trees are printed without recursion, so the depth
+// of the input doesn't matter
+class AstPrinter final : public AstVisitor, public PatternVisitor, public TypeVisitor {
   bool typed_;
+  bool resolved_; // names are followed by #symbol@slot
   std::ostream& os_;
   const Interner& interner_;
 
  public:
   explicit AstPrinter(bool typed, std::ostream& os, const Interner& interner)
+  : AstPrinter(typed, false, os, interner)
+  {}
+
+  AstPrinter(bool typed, bool resolved, std::ostream& os, const Interner& interner)
   : typed_(typed),
+    resolved_(resolved),
     os_(os),
     interner_(interner)
   {}
@@ -34,8 +43,20 @@ class AstPrinter : public AstVisitor, public PatternVisitor, public TypeVisitor
   void Visit(WhileExpr& node) override;
   void Visit(AssignExpr& node) override;
   void Visit(TypedPattern& pattern) override;
-  void Visit(SingleType& type) override;
-  void Visit(ErrorType& type) override;
+  void Visit(const SingleType& type) override;
+  void Visit(const ErrorType& type) override;
+
+  // same output as visiting the tree the ast was made from
+  void Print(const FlatAst& ast);
+
+ private:
+  void Walk(AstNode& root);
+  void Open(AstNode& node);
+  void Separate(const AstNode& node, size_t i);
+
+  void PrintType(const Type* type);
+  void PrintType(FlatAst::TypeId type);
+  void PrintName(Interner::Data name, Resolution resolution);
 };
 
 }
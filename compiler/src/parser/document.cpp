@@ -0,0 +1,287 @@
+#include <algorithm>
+#include <cassert>
+#include <utility>
+#include "document.hpp"
+#include "error_reporter.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+
+namespace helium {
+namespace {
+
+using ::std::move;
+using ::std::string;
+using ::std::unique_ptr;
+using ::std::vector;
+using ::absl::string_view;
+using TT = TokenType;
+
+// the whole source is parsed again once this much was reparsed
+// and the arena holds more replaced nodes than live ones
+constexpr size_t kMinGarbage = 1 << 20;
+
+uint32_t Lines(string_view text) {
+  return static_cast<uint32_t>(::std::count(text.begin(), text.end(), '\n'));
+}
+
+size_t LowBit(size_t i) {
+  return i & (0 - i);
+}
+
+// turns sizes into a Fenwick tree of them and back, in place
+void ToTree(vector<uint32_t>& tree) {
+  for (size_t i = 1; i < tree.size(); i++) {
+    auto parent = i + LowBit(i);
+    if (parent < tree.size()) tree[parent] += tree[i];
+  }
+}
+
+void FromTree(vector<uint32_t>& tree) {
+  for (auto i = tree.size() - 1; i > 0; i--) {
+    auto parent = i + LowBit(i);
+    if (parent < tree.size()) tree[parent] -= tree[i];
+  }
+}
+
+}
+
+Document::Document(string_view source)
+: size_(0),
+  garbage_(0),
+  reparsed_(0),
+  next_id_(0),
+  generation_(0) {
+  Rebuild(string(source));
+}
+
+void Document::Apply(const Edit& edit) {
+  assert(edit.offset + edit.length <= size_);
+  reparsed_ = 0;
+
+  // the statement before the edit might end differently now
+  auto first = UnitAt(edit.offset);
+  auto last = UnitAt(edit.length ? edit.offset + edit.length - 1 : edit.offset);
+  if (first > 0) first--;
+
+  const auto start = StartOf(first);
+  size_t grow = 1;
+  while (true) {
+    string text;
+    for (auto i = first; i <= last; i++) {
+      text += units_[i]->text;
+    }
+    text.replace(edit.offset - start, edit.length, edit.text.data(), edit.text.size());
+
+    // the next unit is parsed along to see where the last statement ends
+    const auto end = text.size();
+    if (last + 1 < units_.size()) text += units_[last + 1]->text;
+
+    vector<unique_ptr<Unit>> units;
+    bool ok = ParseUnits(text, end, units);
+    reparsed_ += text.size();
+    garbage_ += text.size();
+    if (ok) {
+      Replace(first, last, move(units));
+      break;
+    }
+
+    // a statement runs over, e.g. a block was opened
+    last = ::std::min(last + grow, units_.size() - 1);
+    grow *= 2;
+  }
+
+  if (garbage_ > size_ && garbage_ > kMinGarbage) {
+    Rebuild(Text());
+  }
+}
+
+string Document::Text() const {
+  string text;
+  text.reserve(size_);
+  for (const auto& unit : units_) {
+    text += unit->text;
+  }
+
+  return text;
+}
+
+string Document::Errors(string_view file_name) const {
+  string errors;
+  int line = 1;
+  for (const auto& unit : units_) {
+    if (unit->errors) {
+      ErrorReporter reporter(file_name);
+      reporter.SetFirstLine(line);
+      Interner interner;
+      ConstantPool constants;
+      Parser::Parse(unit->text, reporter, interner, constants);
+      errors += reporter.GetErrors();
+    }
+
+    line += static_cast<int>(unit->lines);
+  }
+
+  return errors;
+}
+
+bool Document::HadErrors() const {
+  return ::std::any_of(units_.begin(), units_.end(), [](const unique_ptr<Unit>& unit) {
+    return unit->errors;
+  });
+}
+
+bool Document::ParseUnits(string_view text, size_t end, vector<unique_ptr<Unit>>& units) {
+  const auto names = interner_.Size();
+  auto tokens = Lexer::Lex(text);
+
+  vector<uint32_t> starts; // of the units in text
+  size_t begin = 0;
+  while (true) {
+    while (tokens.Type(begin) == TT::kEol) begin++;
+    if (tokens.Type(begin) == TT::kEof) break;
+
+    // a statement on a line of its own starts a unit, one that follows
+    // another on the same line (an error) is added to its unit
+    if (begin == 0 || tokens.Type(begin - 1) == TT::kEol) {
+      uint32_t start = 0;
+      if (begin > 0) {
+        auto eol = tokens.Lexeme(begin - 1);
+        start = static_cast<uint32_t>(eol.data() - text.data()) + 1;
+      }
+
+      // blank lines before the first statement are a unit of their own
+      if (units.empty() && start > 0) {
+        units.push_back(NewUnit());
+        starts.push_back(0);
+      }
+
+      units.push_back(NewUnit());
+      starts.push_back(start);
+      tokens.SetBase(0u - start);
+    }
+
+    // no nodes are made after an error, so every statement gets a
+    // reporter of its own, which only tells whether it has errors
+    ErrorReporter reporter("");
+    Parser parser(tokens, nullptr, reporter, interner_, constants_, arena_);
+    size_t stop;
+    auto nodes = parser.Slice(begin, begin + 1, &stop);
+    stop = ::std::max(stop, begin + 1);
+
+    bool errors = reporter.HadErrors();
+    for (auto i = begin; i < stop && !errors; i++) {
+      errors = tokens.Type(i) == TT::kError;
+    }
+
+    auto& unit = *units.back();
+    unit.nodes.insert(unit.nodes.end(), nodes.begin(), nodes.end());
+    unit.errors = unit.errors || errors;
+    begin = stop;
+  }
+
+  if (units.empty() && !text.empty()) {
+    units.push_back(NewUnit());
+    starts.push_back(0);
+  }
+
+  // names point into text, which goes away
+  interner_.Own(names);
+
+  // the units after end were only parsed to see that one starts there
+  if (end < text.size()) {
+    auto it = ::std::find(starts.begin(), starts.end(), end);
+    if (it == starts.end()) return false;
+    units.resize(static_cast<size_t>(it - starts.begin()));
+  }
+
+  for (size_t i = 0; i < units.size(); i++) {
+    auto next = i + 1 < units.size() ? starts[i + 1] : end;
+    units[i]->text = string(text.substr(starts[i], next - starts[i]));
+    units[i]->lines = Lines(units[i]->text);
+  }
+
+  return true;
+}
+
+unique_ptr<Document::Unit> Document::NewUnit() {
+  return unique_ptr<Unit>(new Unit{string(), {}, 0, false, next_id_++});
+}
+
+void Document::Rebuild(const string& source) {
+  generation_++;
+  units_.clear();
+  arena_.Clear();
+  interner_ = Interner();
+  constants_ = ConstantPool();
+  garbage_ = 0;
+
+  vector<unique_ptr<Unit>> units;
+  ParseUnits(source, source.size(), units);
+  reparsed_ = source.size();
+  sizes_.assign(1, 0);
+  Replace(0, 0, move(units));
+}
+
+void Document::Replace(size_t first, size_t last, vector<unique_ptr<Unit>> units) {
+  // usually one unit is replaced by one and only the sizes on the
+  // path up the tree change
+  auto old = units_.empty() ? 0 : last - first + 1;
+  if (units.size() == old && old > 0) {
+    for (size_t i = 0; i < old; i++) {
+      auto& unit = units_[first + i];
+      auto delta = static_cast<uint32_t>(units[i]->text.size() - unit->text.size());
+      for (auto node = first + i + 1; node < sizes_.size(); node += LowBit(node)) {
+        sizes_[node] += delta; // wraps for shorter units
+      }
+
+      unit = move(units[i]);
+    }
+  } else {
+    // a document always has a unit, an empty one if need be
+    if (units.empty() && units_.size() == old) {
+      units.push_back(NewUnit());
+    }
+
+    vector<uint32_t> sizes;
+    for (const auto& unit : units) {
+      sizes.push_back(static_cast<uint32_t>(unit->text.size()));
+    }
+
+    units_.erase(units_.begin() + first, units_.begin() + first + old);
+    units_.insert(units_.begin() + first, ::std::make_move_iterator(units.begin()),
+                  ::std::make_move_iterator(units.end()));
+
+    FromTree(sizes_);
+    sizes_.erase(sizes_.begin() + first + 1, sizes_.begin() + first + old + 1);
+    sizes_.insert(sizes_.begin() + first + 1, sizes.begin(), sizes.end());
+    ToTree(sizes_);
+  }
+
+  size_ = StartOf(units_.size());
+}
+
+size_t Document::UnitAt(uint32_t offset) const {
+  // the number of units that end at or before offset
+  size_t unit = 0;
+  size_t step = 1;
+  while (step * 2 < sizes_.size()) step *= 2;
+  for (; step > 0; step /= 2) {
+    if (unit + step < sizes_.size() && sizes_[unit + step] <= offset) {
+      unit += step;
+      offset -= sizes_[unit];
+    }
+  }
+
+  return ::std::min(unit, units_.size() - 1);
+}
+
+uint32_t Document::StartOf(size_t unit) const {
+  uint32_t start = 0;
+  for (; unit > 0; unit -= LowBit(unit)) {
+    start += sizes_[unit];
+  }
+
+  return start;
+}
+
+}
@@ -0,0 +1,117 @@
+#ifndef HELIUM_COMPILER_SRC_PARSER_DOCUMENT_HPP_
+#define HELIUM_COMPILER_SRC_PARSER_DOCUMENT_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "absl/strings/string_view.h"
+#include "ast.hpp"
+#include "ast_arena.hpp"
+#include "constant_pool.hpp"
+#include "interner.hpp"
+
+namespace helium {
+
+// A source that is edited in place and kept parsed. It is split into
+// units, one per top level statement: the text of a unit runs from the
+// start of the line of its statement to the start of the next one (blank
+// lines at the start of the source are a unit of their own), so the
+// units put together give back the source byte for byte. Spans of the
+// nodes of a unit are relative to its text, so an edit only re-lexes and
+// reparses the units it touches and leaves every other subtree as it is.
+//
+// How a statement ends depends on the tokens after it, so an edit reparses
+// the unit before it too, and the unit after it is parsed along: while no
+// unit starts where it does, the edit is widened (geometrically, so an
+// unclosed block costs about as much as parsing the rest of the source).
+//
+// Nodes of replaced units are garbage in the arena until the whole
+// source is parsed again, which happens once they outweigh the source.
+// Names are owned by the interner, they outlive the units they come from
+class Document final {
+ public:
+  struct Edit {
+    uint32_t offset;
+    uint32_t length; // of the replaced text
+    absl::string_view text;
+  };
+
+ private:
+  struct Unit {
+    std::string text;
+    std::vector<AstNode*> nodes;
+    uint32_t lines; // line breaks in text
+    bool errors;
+    uint64_t id;
+  };
+
+  std::vector<std::unique_ptr<Unit>> units_;
+  std::vector<uint32_t> sizes_; // of the units as a Fenwick tree, from 1
+  uint32_t size_;
+  Interner interner_;
+  ConstantPool constants_;
+  AstArena arena_;
+  size_t garbage_; // bytes parsed since the source was parsed as a whole
+  size_t reparsed_; // bytes parsed by the last Apply()
+  uint64_t next_id_; // of a unit
+  uint64_t generation_; // times the source was parsed as a whole
+
+ public:
+  explicit Document(absl::string_view source);
+
+  Document(const Document&) = delete;
+  Document& operator =(const Document&) = delete;
+
+  // offset + length must be at most Size()
+  void Apply(const Edit& edit);
+
+  std::string Text() const;
+  uint32_t Size() const { return size_; }
+  size_t Units() const { return units_.size(); }
+  size_t Reparsed() const { return reparsed_; }
+
+  // ids are never reused, a unit that is parsed again gets a new one
+  uint64_t UnitId(size_t unit) const { return units_[unit]->id; }
+  // the names are numbered anew in every generation
+  uint64_t Generation() const { return generation_; }
+
+  // calls f(nodes, text, offset, line) for each unit in order: the
+  // statement (nodes has one element unless there are errors), the text
+  // the spans refer to, its offset and its first line in the source
+  template <typename F>
+  void ForEachUnit(F f) const {
+    uint32_t line = 1, offset = 0;
+    for (const auto& unit : units_) {
+      f(static_cast<const std::vector<AstNode*>&>(unit->nodes),
+        absl::string_view(unit->text), offset, static_cast<int>(line));
+      line += unit->lines;
+      offset += static_cast<uint32_t>(unit->text.size());
+    }
+  }
+
+  // the errors of each unit parsed alone, with positions in the source
+  std::string Errors(absl::string_view file_name) const;
+  bool HadErrors() const;
+
+  // names and constants are numbered anew when the source is parsed again
+  const Interner& GetInterner() const { return interner_; }
+  // the type checker interns the names of the builtin types
+  Interner& GetInterner() { return interner_; }
+  const ConstantPool& GetConstants() const { return constants_; }
+
+ private:
+  // parses text into units up to end, false if no unit starts there
+  bool ParseUnits(absl::string_view text, size_t end,
+                  std::vector<std::unique_ptr<Unit>>& units);
+  std::unique_ptr<Unit> NewUnit();
+  void Rebuild(const std::string& source);
+  void Replace(size_t first, size_t last, std::vector<std::unique_ptr<Unit>> units);
+  // the unit holding the byte at offset, the last one for Size()
+  size_t UnitAt(uint32_t offset) const;
+  uint32_t StartOf(size_t unit) const;
+};
+
+}
+
+#endif //HELIUM_COMPILER_SRC_PARSER_DOCUMENT_HPP_
@@ -0,0 +1,165 @@
+#include <cassert>
+#include "flat_ast.hpp"
+
+namespace helium {
+
+constexpr FlatAst::Index FlatAst::kNone;
+constexpr FlatAst::TypeId FlatAst::kNoType;
+constexpr FlatAst::TypeId FlatAst::kErrorType;
+
+namespace {
+
+using Kind = FlatAst::Kind;
+
+}
+
+// appends the nodes of a tree in pre-order, the tree is walked
+// with a stack so it can be arbitrarily deep
+class FlatAstBuilder final : public PatternVisitor {
+  FlatAst& ast_;
+
+ public:
+  explicit FlatAstBuilder(FlatAst& ast)
+  : ast_(ast)
+  {}
+
+  void Build(AstNode& root) {
+    struct Entry {
+      AstNode* node;
+      FlatAst::Index index;
+      size_t next; // child to be added next
+    };
+
+    ::std::vector<Entry> stack = {{&root, Enter(root), 0}};
+    while (!stack.empty()) {
+      auto& top = stack.back();
+      if (auto* child = ChildAt(*top.node, top.next++)) {
+        auto index = Enter(*child);
+        stack.push_back({child, index, 0});
+      } else {
+        Close(top.index);
+        stack.pop_back();
+      }
+    }
+  }
+
+  void Visit(TypedPattern& pattern) override {
+    auto decl = FlatAst::IdOf(pattern.GetType());
+    auto index = Add(Kind::kPattern, TokenType::kIdentifier, pattern.GetSpan(),
+                     pattern.GetName(), decl, nullptr);
+    Close(index);
+  }
+
+ private:
+  // adds the node, its children follow
+  FlatAst::Index Enter(AstNode& node) {
+    switch (node.GetKind()) {
+      case AstKind::kVariable: {
+        auto index = Add(Kind::kVariable, TokenType::kVar, {0, 0}, 0, 0, nullptr);
+        static_cast<VariableStmt&>(node).GetPattern()->Accept(*this);
+        return index;
+      }
+
+      case AstKind::kBinary: {
+        auto& expr = static_cast<BinaryExpr&>(node);
+        return Add(Kind::kBinary, expr.Op(), expr.GetSpan(), 0,
+                   static_cast<uint32_t>(expr.GetIntrinsic()), &expr);
+      }
+
+      case AstKind::kUnary: {
+        auto& expr = static_cast<UnaryExpr&>(node);
+        return Add(Kind::kUnary, expr.Op(), expr.GetSpan(), 0,
+                   static_cast<uint32_t>(expr.GetIntrinsic()), &expr);
+      }
+
+      case AstKind::kLiteral: {
+        auto& expr = static_cast<LiteralExpr&>(node);
+        return Add(Kind::kLiteral, expr.Kind(), expr.GetSpan(),
+                   expr.Value(), expr.Constant(), &expr);
+      }
+
+      case AstKind::kIdentifier: {
+        auto& expr = static_cast<IdentifierExpr&>(node);
+        return Add(Kind::kIdentifier, TokenType::kIdentifier, expr.GetSpan(),
+                   expr.Name(), expr.GetResolution().slot, &expr);
+      }
+
+      case AstKind::kBlock:
+        return Add(Kind::kBlock, TokenType::kLeftBrace, {0, 0}, 0, 0,
+                   &static_cast<BlockExpr&>(node));
+
+      case AstKind::kIf:
+        return Add(Kind::kIf, TokenType::kIf, {0, 0}, 0, 0, &static_cast<IfExpr&>(node));
+
+      case AstKind::kWhile:
+        return Add(Kind::kWhile, TokenType::kWhile, {0, 0}, 0, 0,
+                   &static_cast<WhileExpr&>(node));
+
+      case AstKind::kAssign: {
+        auto& expr = static_cast<AssignExpr&>(node);
+        assert(!expr.Receiver() && "Unimplemented");
+        return Add(Kind::kAssign, TokenType::kEqual, expr.GetSpan(), expr.Name(), 0, &expr);
+      }
+    }
+
+    assert(false && "Invalid node kind");
+    return FlatAst::kNone;
+  }
+
+  FlatAst::Index Add(Kind kind, TokenType op, Span span, size_t data,
+                     uint32_t aux, const Expr* expr) {
+    auto type = expr ? FlatAst::IdOf(expr->GetType()) : FlatAst::kNoType;
+    return ast_.Add(kind, op, span, static_cast<uint32_t>(data), aux, type);
+  }
+
+  void Close(FlatAst::Index node) {
+    ast_.ends_[node] = ast_.Size();
+  }
+};
+
+FlatAst FlatAst::From(const AstTree& tree) {
+  FlatAst ast;
+  FlatAstBuilder builder(ast);
+  for (auto* node : tree) {
+    ast.roots_.push_back(ast.Size());
+    builder.Build(*node);
+  }
+
+  ast.kinds_.Shrink();
+  ast.ops_.Shrink();
+  ast.offsets_.Shrink();
+  ast.data_.Shrink();
+  ast.aux_.Shrink();
+  ast.ends_.Shrink();
+  ast.types_.Shrink();
+  return ast;
+}
+
+FlatAst::TypeId FlatAst::IdOf(const Type* type) {
+  if (const auto* single = Cast<SingleType>(type)) {
+    return static_cast<TypeId>(single->GetTypeData());
+  }
+
+  return Is<ErrorType>(type) ? kErrorType : kNoType;
+}
+
+FlatAst::Index FlatAst::Add(Kind kind, TokenType op, Span span,
+                            uint32_t data, uint32_t aux, TypeId type) {
+  auto index = Size();
+  kinds_.push_back(kind);
+  ops_.push_back(op);
+  offsets_.push_back(span.offset);
+  data_.push_back(data);
+  aux_.push_back(aux);
+  ends_.push_back(index + 1);
+  types_.push_back(type);
+  return index;
+}
+
+size_t FlatAst::Memory() const {
+  return kinds_.Memory() + ops_.Memory() + offsets_.Memory() +
+         data_.Memory() + aux_.Memory() +
+         ends_.Memory() + types_.Memory() + roots_.Memory();
+}
+
+}
@@ -0,0 +1,159 @@
+#ifndef HELIUM_COMPILER_SRC_PARSER_FLAT_AST_HPP_
+#define HELIUM_COMPILER_SRC_PARSER_FLAT_AST_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ast.hpp"
+#include "token.hpp"
+
+namespace helium {
+
+// A column of a flat ast: either owns its elements or views ones that
+// live elsewhere (a mapped cache file, which then must outlive it)
+template <typename T>
+class FlatColumn final {
+  ::std::vector<T> own_;
+  T* data_;
+  size_t size_;
+
+ public:
+  FlatColumn()
+  : data_(nullptr),
+    size_(0)
+  {}
+
+  FlatColumn(const FlatColumn&) = delete;
+  FlatColumn& operator =(const FlatColumn&) = delete;
+
+  // moving a vector keeps its buffer, so data_ stays valid
+  FlatColumn(FlatColumn&&) noexcept = default;
+  FlatColumn& operator =(FlatColumn&&) noexcept = default;
+
+  void push_back(const T& value) {
+    own_.push_back(value);
+    data_ = own_.data();
+    size_ = own_.size();
+  }
+
+  // shrink_to_fit() does nothing without exceptions
+  void Shrink() {
+    ::std::vector<T>(own_.begin(), own_.end()).swap(own_);
+    data_ = own_.data();
+  }
+
+  void View(T* data, size_t size) {
+    ::std::vector<T>().swap(own_);
+    data_ = data;
+    size_ = size;
+  }
+
+  bool IsView() const { return data_ != own_.data(); }
+
+  T& operator [](size_t i) { return data_[i]; }
+  const T& operator [](size_t i) const { return data_[i]; }
+
+  size_t size() const { return size_; }
+  const T* data() const { return data_; }
+  const T* begin() const { return data_; }
+  const T* end() const { return data_ + size_; }
+
+  // bytes taken, a view only counts its elements
+  size_t Memory() const {
+    return (IsView() ? size_ : own_.capacity()) * sizeof(T);
+  }
+};
+
+// The ast in contiguous columns indexed by node. Nodes are stored
+// in pre-order: the children of a node follow it, each subtree is
+// the range [node, End(node)), and the top level statements split
+// the whole array into consecutive ranges that can be processed
+// independently.
+//
+// kVariable: pattern, expr
+// kPattern: Data() is the name, Aux() is the declared type or kNoType
+// kBinary: left, right, Aux() is the intrinsic once checked
+// kUnary: operand, Aux() is the intrinsic once checked
+// kLiteral: Op() is the kind, Data() is the lexeme, Aux() is the constant
+// kIdentifier: Data() is the name, Aux() is the frame slot (UINT32_MAX if unresolved)
+// kBlock: statements
+// kIf: cond, then [, else]
+// kWhile: cond, body
+// kAssign: expr, Data() is the name
+//
+// Only where a node starts is kept of its span, errors are reported
+// at the start
+class FlatAst final {
+ public:
+  using Index = uint32_t;
+  using TypeId = uint32_t; // interned name of a SingleType
+
+  static constexpr Index kNone = UINT32_MAX;
+  static constexpr TypeId kNoType = UINT32_MAX;
+  static constexpr TypeId kErrorType = UINT32_MAX - 1;
+
+  enum class Kind : uint8_t {
+    kVariable,
+    kPattern,
+    kBinary,
+    kUnary,
+    kLiteral,
+    kIdentifier,
+    kBlock,
+    kIf,
+    kWhile,
+    kAssign
+  };
+
+ private:
+  FlatColumn<Kind> kinds_;
+  FlatColumn<TokenType> ops_;
+  FlatColumn<uint32_t> offsets_;
+  FlatColumn<uint32_t> data_;
+  FlatColumn<uint32_t> aux_;
+  FlatColumn<Index> ends_;
+  FlatColumn<TypeId> types_;
+  FlatColumn<Index> roots_;
+
+ public:
+  // types and intrinsics of a checked tree are kept
+  static FlatAst From(const AstTree& tree);
+
+  // kNoType for null
+  static TypeId IdOf(const Type* type);
+
+  Index Size() const { return static_cast<Index>(kinds_.size()); }
+  const FlatColumn<Index>& Roots() const { return roots_; }
+
+  Kind GetKind(Index node) const { return kinds_[node]; }
+  TokenType Op(Index node) const { return ops_[node]; }
+  Span GetSpan(Index node) const { return {offsets_[node], 0}; }
+  uint32_t Data(Index node) const { return data_[node]; }
+  uint32_t Aux(Index node) const { return aux_[node]; }
+  Index End(Index node) const { return ends_[node]; }
+
+  // of a binary or unary node
+  IntrinsicOp GetIntrinsic(Index node) const { return static_cast<IntrinsicOp>(aux_[node]); }
+  void SetIntrinsic(Index node, IntrinsicOp op) { aux_[node] = static_cast<uint32_t>(op); }
+
+  TypeId GetType(Index node) const { return types_[node]; }
+  void SetType(Index node, TypeId type) { types_[node] = type; }
+
+  // children are consecutive subtrees
+  Index FirstChild(Index node) const { return node + 1; }
+  Index NextSibling(Index node) const { return ends_[node]; }
+  bool IsLeaf(Index node) const { return ends_[node] == node + 1; }
+
+  // bytes taken by the columns
+  size_t Memory() const;
+
+ private:
+  friend class FlatAstBuilder;
+  friend class AstCache;
+
+  Index Add(Kind kind, TokenType op, Span span, uint32_t data, uint32_t aux, TypeId type);
+};
+
+}
+
+#endif //HELIUM_COMPILER_SRC_PARSER_FLAT_AST_HPP_
@@ -0,0 +1,551 @@
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <limits>
+#include <thread>
+#include "lexer.hpp"
+#include "unicode.hpp"
+
+namespace helium {
+namespace {
+
+using ::absl::string_view;
+using ::helium::scan::IsAlpha;
+using ::helium::scan::IsDigit;
+using TT = TokenType;
+
+}
+
+void TokenBuffer::Reserve(size_t size) {
+  types_.reserve(size);
+  starts_.reserve(size);
+  lengths_.reserve(size);
+  hashes_.reserve(size);
+}
+
+void TokenBuffer::Reset(string_view source, uint32_t base) {
+  source_ = source;
+  base_ = base;
+  types_.clear();
+  starts_.clear();
+  lengths_.clear();
+  hashes_.clear();
+  errors_.clear();
+}
+
+void TokenBuffer::PopBack() {
+  if (!errors_.empty() && errors_.back().token == types_.size() - 1) {
+    errors_.pop_back();
+  }
+
+  types_.pop_back();
+  starts_.pop_back();
+  lengths_.pop_back();
+  hashes_.pop_back();
+}
+
+void TokenBuffer::Add(TokenType type, uint32_t start, uint32_t length, uint32_t hash) {
+  types_.push_back(type);
+  starts_.push_back(start);
+  lengths_.push_back(length);
+  hashes_.push_back(hash);
+}
+
+void TokenBuffer::Append(const TokenBuffer& other, size_t from) {
+  assert(source_.data() == other.source_.data() && base_ == other.base_);
+  const auto offset = static_cast<uint32_t>(types_.size() - from);
+  types_.insert(types_.end(), other.types_.begin() + from, other.types_.end());
+  starts_.insert(starts_.end(), other.starts_.begin() + from, other.starts_.end());
+  lengths_.insert(lengths_.end(), other.lengths_.begin() + from, other.lengths_.end());
+  hashes_.insert(hashes_.end(), other.hashes_.begin() + from, other.hashes_.end());
+
+  for (const auto& error : other.errors_) {
+    if (error.token >= from) {
+      errors_.push_back({offset + error.token, error.msg});
+    }
+  }
+}
+
+constexpr size_t Lexer::kParallelSize;
+constexpr size_t Lexer::kMinChunk;
+
+TokenBuffer Lexer::Lex(string_view source) {
+  assert(source.size() < ::std::numeric_limits<uint32_t>::max());
+
+  const size_t threads = ::std::thread::hardware_concurrency();
+  if (source.size() >= kParallelSize && threads > 1) {
+    // a few chunks per thread even out the chunks that are re-lexed
+    const size_t chunks = ::std::min(threads * 4, source.size() / kMinChunk);
+    return LexParallel(source, chunks, threads);
+  }
+
+  TokenBuffer tokens(source);
+  Lexer lexer(tokens);
+  lexer.valid_until_ = lexer.ValidUtf8(0, source.size());
+  lexer.Run();
+  return tokens;
+}
+
+TokenBuffer Lexer::LexParallel(string_view source,
+                               size_t chunks, size_t threads) {
+  assert(source.size() < ::std::numeric_limits<uint32_t>::max());
+  assert(chunks > 0 && threads > 0);
+
+  // every chunk but the first starts after a newline
+  ::std::vector<size_t> bounds = {0};
+  for (size_t i = 1; i < chunks; i++) {
+    size_t pos = ::std::max(source.size() / chunks * i, bounds.back());
+    pos = source.find('\n', pos);
+    if (pos == string_view::npos || pos + 1 >= source.size()) break;
+    if (pos + 1 > bounds.back()) bounds.push_back(pos + 1);
+  }
+
+  bounds.push_back(source.size());
+  chunks = bounds.size() - 1;
+
+  // each chunk is lexed as if a token starts right after the newline
+  ::std::vector<TokenBuffer> parts(chunks, TokenBuffer(source));
+  ::std::vector<size_t> ends(chunks);
+
+  auto end = [&](size_t i) {
+    return i + 1 < chunks ? bounds[i + 1] : source.size();
+  };
+
+  ::std::atomic<size_t> next(0);
+  auto work = [&]() {
+    for (size_t i; (i = next++) < chunks;) {
+      Lexer lexer(parts[i]);
+      lexer.valid_until_ = lexer.ValidUtf8(bounds[i], end(i));
+      ends[i] = lexer.RunRange(bounds[i], end(i));
+    }
+  };
+
+  ::std::vector<::std::thread> pool;
+  for (size_t i = 1; i < ::std::min(threads, chunks); i++) {
+    pool.emplace_back(work);
+  }
+
+  work();
+  for (auto& thread : pool) {
+    thread.join();
+  }
+
+  // the guess is wrong if the previous chunk ends with a token that
+  // continues past the newline, i.e. the chunk started inside a string.
+  // Such a chunk is lexed again from where the token really ends, but
+  // only until the tokens meet the guessed ones
+  size_t total = 0;
+  for (const auto& part : parts) {
+    total += part.Size();
+  }
+
+  TokenBuffer tokens(source);
+  tokens.Reserve(total);
+  TokenBuffer fixed(source);
+  for (size_t i = 0; i < chunks; i++) {
+    if (i == 0 || ends[i - 1] == bounds[i]) {
+      tokens.Append(parts[i], 0);
+      continue;
+    }
+
+    fixed.Reset(source, 0);
+    Lexer lexer(fixed);
+    size_t from = lexer.Resync(ends[i - 1], end(i), parts[i]);
+    tokens.Append(fixed, 0);
+
+    if (from < parts[i].Size()) {
+      tokens.Append(parts[i], from);
+    } else {
+      ends[i] = static_cast<size_t>(lexer.curr_char_);
+    }
+  }
+
+  return tokens;
+}
+
+Lexer::Lexer(TokenBuffer& tokens)
+: source_(tokens.source_),
+  size_(static_cast<int>(tokens.source_.size())),
+  curr_char_(0),
+  start_(0),
+  valid_until_(0),
+  tokens_(tokens),
+  scan_(scan::Active())
+{}
+
+void Lexer::Run() {
+  // a rough guess to avoid most of the reallocations
+  tokens_.Reserve(static_cast<size_t>(size_ - curr_char_) / 4 + 1);
+
+  // '\0' in the middle of the source is a kEof token too,
+  // only the one at the end stops lexing
+  do {
+    NextToken();
+  } while (!IsAtEnd() || tokens_.types_.back() != TT::kEof);
+}
+
+size_t Lexer::RunRange(size_t begin, size_t end) {
+  curr_char_ = static_cast<int>(begin);
+  if (end == static_cast<size_t>(size_)) {
+    Run();
+    return end;
+  }
+
+  tokens_.Reserve((end - ::std::min(begin, end)) / 4 + 1);
+  while (true) {
+    const int mark = curr_char_;
+    SkipSpace();
+    if (static_cast<size_t>(curr_char_) >= end) {
+      curr_char_ = mark;
+      return static_cast<size_t>(mark);
+    }
+
+    NextToken();
+  }
+}
+
+size_t Lexer::Resync(size_t begin, size_t end, const TokenBuffer& guess) {
+  curr_char_ = static_cast<int>(begin);
+  const bool last = end == static_cast<size_t>(size_);
+  size_t i = 0;
+
+  while (true) {
+    const int mark = curr_char_;
+    SkipSpace();
+    if (!last && static_cast<size_t>(curr_char_) >= end) {
+      curr_char_ = mark;
+      return guess.Size();
+    }
+
+    // the lexer has no state besides the position, so the rest
+    // of the tokens would be the same as the guessed ones
+    const auto start = static_cast<uint32_t>(curr_char_);
+    while (i < guess.Size() && guess.starts_[i] < start) i++;
+    if (i < guess.Size() && guess.starts_[i] == start) return i;
+
+    NextToken();
+  }
+}
+
+size_t Lexer::RunWindow(bool last) {
+  if (!last) {
+    // a character cut by the end of the window is lexed with the next one
+    size_ = static_cast<int>(unicode::CompletePrefix(source_.data(), source_.size()));
+  }
+
+  valid_until_ = ValidUtf8(0, static_cast<size_t>(size_));
+  if (last) {
+    Run();
+    return static_cast<size_t>(size_);
+  }
+
+  while (true) {
+    // blanks don't need to be seen again, a comment does
+    SkipRun(scan_.blanks(source_.data(), curr_char_, size_));
+    const int mark = curr_char_;
+
+    NextToken();
+    if (IsAtEnd()) {
+      // the token or the comment before it may continue in the next window
+      tokens_.PopBack();
+      curr_char_ = mark;
+      return static_cast<size_t>(mark);
+    }
+  }
+}
+
+constexpr size_t StreamLexer::kBlockSize;
+
+StreamLexer::StreamLexer(SourceStream& input, size_t window)
+: input_(input),
+  window_size_(window),
+  window_(),
+  consumed_(0),
+  base_(0),
+  tokens_(absl::string_view()),
+  lines_(),
+  eof_(false),
+  blocks_(),
+  block_used_(kBlockSize),
+  kept_()
+{
+  assert(window_size_ > 0);
+}
+
+void StreamLexer::Fill() {
+  size_t size = window_.size();
+  window_.resize(size + window_size_);
+
+  while (size < window_.size()) {
+    size_t n = input_.Read(&window_[size], window_.size() - size);
+    if (n == 0) {
+      eof_ = true;
+      break;
+    }
+
+    size += n;
+  }
+
+  window_.resize(size);
+}
+
+const TokenBuffer& StreamLexer::Next() {
+  assert(!Done());
+
+  do {
+    // tokens of the previous window are not referenced anymore
+    base_ += static_cast<uint32_t>(consumed_);
+    window_.erase(0, consumed_);
+    // if nothing was consumed the window only grows,
+    // so a token always fits in eventually
+    Fill();
+    assert(window_.size() < ::std::numeric_limits<uint32_t>::max() - base_);
+
+    tokens_.Reset(window_, base_);
+    Lexer lexer(tokens_);
+    consumed_ = lexer.RunWindow(eof_);
+    lines_.Append(string_view(window_).substr(0, consumed_), base_);
+  } while (tokens_.Size() == 0);
+
+  return tokens_;
+}
+
+string_view StreamLexer::Keep(string_view lexeme) {
+  if (lexeme.empty()) return {};
+
+  auto it = kept_.find(lexeme);
+  if (it != kept_.end()) return *it;
+
+  char* data;
+  if (lexeme.size() > kBlockSize / 4) {
+    // big lexemes get their own block
+    blocks_.emplace_back(new char[lexeme.size()]);
+    data = blocks_.back().get();
+  } else {
+    if (block_used_ + lexeme.size() > kBlockSize) {
+      blocks_.emplace_back(new char[kBlockSize]);
+      block_used_ = 0;
+    }
+
+    data = blocks_.back().get() + block_used_;
+    block_used_ += lexeme.size();
+  }
+
+  ::std::copy(lexeme.begin(), lexeme.end(), data);
+  string_view kept(data, lexeme.size());
+  kept_.insert(kept);
+  return kept;
+}
+
+char Lexer::AdvanceChar() {
+  return IsAtEnd() ? '\0' : source_[curr_char_++];
+}
+
+void Lexer::ParseComment() {
+  SkipRun(scan_.line(source_.data(), curr_char_, size_));
+}
+
+void Lexer::SkipSpace() {
+  SkipRun(scan_.blanks(source_.data(), curr_char_, size_));
+  if (PeekChar() == '/' && PeekNextChar() == '/') {
+    ParseComment();
+  }
+}
+
+void Lexer::MakeToken(TT type, uint32_t hash) {
+  tokens_.Add(type, static_cast<uint32_t>(start_),
+      static_cast<uint32_t>(curr_char_ - start_), hash);
+}
+
+void Lexer::LexError(string_view msg) {
+  auto token = static_cast<uint32_t>(tokens_.Size());
+  MakeToken(TT::kError);
+  tokens_.errors_.push_back({token, msg});
+}
+
+// consumes characters
+bool Lexer::IsValidSymbol() {
+  const char c = AdvanceChar();
+  switch (c) {
+    case '\n':
+    case '\t':
+    case '\r':
+    case '\'':
+    case '\"': return false;
+    case '\\': return IsEscape();
+    default: {
+      if (static_cast<unsigned char>(c) < 0x80) return true;
+
+      // the rest of a multibyte character
+      curr_char_--;
+      uint32_t code_point;
+      int length = DecodeChar(&code_point);
+      SkipRun(curr_char_ + ::std::max(length, 1));
+      return length > 0;
+    }
+  }
+}
+
+bool Lexer::IsEscape() {
+  // '\\' has already been consumed
+  switch (PeekChar()) {
+    case '\'':
+    case '\"':
+    case '\\':
+      AdvanceChar();
+      return true;
+    default: return IsValidSymbol();
+  }
+}
+
+// TODO: define and handle escape sequences
+void Lexer::ParseChar() {
+  bool valid;
+
+  if (PeekChar() == '"') {
+    AdvanceChar();
+    valid = true;
+  } else {
+    valid = IsValidSymbol();
+  }
+
+  valid = valid && AdvanceChar() == '\'';
+
+  if (!valid) {
+    LexError("Invalid character literal");
+    return;
+  }
+
+  MakeToken(TT::kChar);
+}
+
+// TODO: define and handle escape sequences
+void Lexer::ParseString() {
+  // everything except '"' and '\\' is valid inside of a string,
+  // escapes are checked one at a time
+  bool valid = true;
+  while (true) {
+    SkipRun(scan_.string(source_.data(), curr_char_, size_));
+    if (IsAtEnd() || PeekChar() == '"') break;
+    valid = IsValidSymbol() && valid;
+  }
+
+  // the rest of the string is checked for UTF-8 only if
+  // the source is not known to be valid there
+  if (valid && curr_char_ > valid_until_) {
+    valid = ValidUtf8(start_, curr_char_) == curr_char_;
+  }
+
+  if (!valid) {
+    LexError("Invalid string literal");
+    return;
+  }
+
+  if (AdvanceChar() != '"') {
+    LexError("Missing closing \"");
+    return;
+  }
+
+  MakeToken(TT::kString);
+}
+
+void Lexer::ParseNumber() {
+  SkipRun(scan_.digits(source_.data(), curr_char_, size_));
+
+  bool real = PeekChar() == '.';
+  if (real) {
+    AdvanceChar();
+    SkipRun(scan_.digits(source_.data(), curr_char_, size_));
+  }
+
+  if (source_[start_] == '0' && curr_char_ - start_ > 1) {
+    LexError("Invalid number literal");
+    return;
+  }
+
+  MakeToken(real ? TT::kReal : TT::kInt);
+}
+
+void Lexer::ParseIdentifier() {
+  while (true) {
+    SkipRun(scan_.identifier(source_.data(), curr_char_, size_));
+    if (static_cast<unsigned char>(PeekChar()) < 0x80) break;
+
+    uint32_t code_point;
+    int length = DecodeChar(&code_point);
+    if (length == 0 || !unicode::IsXidContinue(code_point)) break;
+    SkipRun(curr_char_ + length);
+  }
+
+  // the lexeme is still in cache, hash it for the interner
+  auto id = source_.substr(start_, curr_char_ - start_);
+  auto type = IdentifierType(id);
+  MakeToken(type, type == TT::kIdentifier ? Interner::Hash(id) : 0);
+}
+
+void Lexer::NextToken() {
+  SkipSpace();
+  start_ = curr_char_;
+
+  char c = AdvanceChar();
+  switch (c) {
+    case '\0': MakeToken(TT::kEof);
+      break;
+    case '\n': MakeToken(TT::kEol);
+      break;
+    case '{': MakeToken(TT::kLeftBrace);
+      break;
+    case '}': MakeToken(TT::kRightBrace);
+      break;
+    case '(': MakeToken(TT::kLeftParen);
+      break;
+    case ')': MakeToken(TT::kRightParen);
+      break;
+    case '+': MakeToken(TT::kPlus);
+      break;
+    case '-': MakeToken(TT::kMinus);
+      break;
+    case '*': MakeToken(TT::kStar);
+      break;
+    case '/': MakeToken(TT::kSlash);
+      break;
+    case '=': MakeToken(TT::kEqual);
+      break;
+    case ':': MakeToken(TT::kColon);
+      break;
+    case '"': ParseString();
+      break;
+    case '\'': ParseChar();
+      break;
+    default:
+      if (IsAlpha(c)) ParseIdentifier();
+      else if (IsDigit(c)) ParseNumber();
+      else if (static_cast<unsigned char>(c) >= 0x80) ParseUnicode();
+      else LexError("Unexpected symbol");
+  }
+}
+
+// a token that starts with a multibyte character,
+// it can only be an identifier
+void Lexer::ParseUnicode() {
+  curr_char_ = start_;
+  uint32_t code_point;
+  int length = DecodeChar(&code_point);
+  SkipRun(curr_char_ + ::std::max(length, 1));
+
+  if (length == 0) {
+    LexError("Invalid UTF-8 sequence");
+  } else if (unicode::IsXidStart(code_point)) {
+    ParseIdentifier();
+  } else {
+    LexError("Unexpected symbol");
+  }
+}
+
+int Lexer::DecodeChar(uint32_t* code_point) {
+  int length = unicode::Decode(source_.data(), static_cast<size_t>(curr_char_),
+                               static_cast<size_t>(size_), code_point);
+  return length == unicode::kTruncated ? unicode::kInvalid : length;
+}
+
+}
@@ -0,0 +1,192 @@
+#ifndef HELIUM_COMPILER_SRC_PARSER_LEXER_HPP_
+#define HELIUM_COMPILER_SRC_PARSER_LEXER_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/string_view.h"
+#include "interner.hpp"
+#include "line_table.hpp"
+#include "source_file.hpp"
+#include "token.hpp"
+#include "scan.hpp"
+
+namespace helium {
+
+// error found while lexing, reported by whoever consumes the tokens
+// at the start of the kError token
+struct LexError final {
+  uint32_t token; // index of the kError token
+  absl::string_view msg;
+};
+
+// tokens of the source stored column by column, ends with kEof
+// unless it holds a window of a StreamLexer. Lexemes point into
+// the source which must outlive the buffer
+class TokenBuffer final {
+  friend class Lexer;
+  friend class StreamLexer;
+
+  absl::string_view source_;
+  uint32_t base_; // offset of source_ in the whole source
+  std::vector<TokenType> types_;
+  std::vector<uint32_t> starts_; // relative to source_
+  std::vector<uint32_t> lengths_;
+  std::vector<uint32_t> hashes_; // see Token::hash
+  std::vector<LexError> errors_; // ordered by token
+
+ public:
+  explicit TokenBuffer(absl::string_view source)
+  : source_(source),
+    base_(0),
+    types_(),
+    starts_(),
+    lengths_(),
+    hashes_(),
+    errors_()
+  {}
+
+  size_t Size() const { return types_.size(); }
+  absl::string_view Source() const { return source_; }
+
+  TokenType Type(size_t i) const { return types_[i]; }
+  absl::string_view Lexeme(size_t i) const {
+    return source_.substr(starts_[i], lengths_[i]);
+  }
+
+  Span GetSpan(size_t i) const { return {base_ + starts_[i], lengths_[i]}; }
+  uint32_t Hash(size_t i) const { return hashes_[i]; }
+
+  Token At(size_t i) const {
+    return {types_[i], GetSpan(i), Lexeme(i), hashes_[i]};
+  }
+
+  const std::vector<LexError>& Errors() const { return errors_; }
+
+  // spans start at base, which wraps around: -offset makes them
+  // relative to the given offset
+  void SetBase(uint32_t base) { base_ = base; }
+
+ private:
+  void Reserve(size_t size);
+  void Reset(absl::string_view source, uint32_t base);
+  void PopBack();
+  void Add(TokenType type, uint32_t start, uint32_t length, uint32_t hash);
+  // appends tokens of the same source starting with the given one
+  void Append(const TokenBuffer& other, size_t from);
+};
+
+class Lexer final {
+ private:
+  friend class StreamLexer;
+
+  // sources at least this large are lexed by several threads
+  static constexpr size_t kParallelSize = 1 << 20;
+  static constexpr size_t kMinChunk = 1 << 16;
+
+  absl::string_view source_;
+  int size_;
+  int curr_char_;
+  int start_;
+  int valid_until_; // source_ up to here is known to be valid UTF-8
+  TokenBuffer& tokens_;
+  const scan::Table& scan_;
+
+ public:
+  Lexer() = delete;
+  static TokenBuffer Lex(absl::string_view source);
+
+  // splits the source into chunks at newlines and lexes them on
+  // the given number of threads. The result is the same as Lex() gives
+  static TokenBuffer LexParallel(absl::string_view source,
+                                 size_t chunks, size_t threads);
+
+ private:
+  explicit Lexer(TokenBuffer& tokens);
+
+  void Run();
+  // lexes tokens that start in [begin, end), returns where the last
+  // one ends. A token may continue past the end
+  size_t RunRange(size_t begin, size_t end);
+  // like RunRange() but stops at the first token that starts where
+  // one of the guessed tokens does and returns its index in guess.
+  // Returns guess.Size() if there is no such token
+  size_t Resync(size_t begin, size_t end, const TokenBuffer& guess);
+  // lexes tokens that can't continue past the end of the source,
+  // returns where lexing of the next window must start
+  size_t RunWindow(bool last);
+  void NextToken();
+
+  void SkipSpace();
+  void MakeToken(TokenType type, uint32_t hash = 0);
+  char AdvanceChar();
+  void SkipRun(size_t end) { curr_char_ = static_cast<int>(end); }
+  void ParseComment();
+  void ParseString();
+  void ParseChar();
+  bool IsValidSymbol();
+  bool IsEscape();
+  void ParseNumber();
+  void ParseIdentifier();
+  void ParseUnicode();
+  // size of the character at the current position, 0 if it's invalid
+  int DecodeChar(uint32_t* code_point);
+  // end of the valid UTF-8 prefix of source_[begin, end)
+  int ValidUtf8(size_t begin, size_t end) {
+    return static_cast<int>(scan_.utf8(source_.data(), begin, end));
+  }
+
+  bool IsAtEnd() { return curr_char_ == size_; }
+  char PeekChar() { return IsAtEnd() ? '\0' : source_[curr_char_]; }
+  char PeekNextChar() { return curr_char_ + 1 >= size_ ? '\0' : source_[curr_char_ + 1]; }
+
+  void LexError(absl::string_view msg);
+};
+
+// lexes a source that is read window by window, so only a window
+// (and the longest token) is kept in memory. Lexemes of the tokens
+// are valid until the next window is lexed, unless they are kept
+class StreamLexer final {
+  static constexpr size_t kBlockSize = 1 << 16;
+
+  SourceStream& input_;
+  size_t window_size_;
+  std::string window_;
+  size_t consumed_; // prefix of window_ that has been lexed
+  uint32_t base_; // offset of window_ in the whole source
+  TokenBuffer tokens_;
+  LineTable lines_;
+  bool eof_;
+
+  // storage of the kept lexemes
+  std::vector<std::unique_ptr<char[]>> blocks_;
+  size_t block_used_;
+  absl::flat_hash_set<absl::string_view> kept_;
+
+ public:
+  StreamLexer() = delete;
+  StreamLexer(const StreamLexer&) = delete;
+  StreamLexer& operator =(const StreamLexer&) = delete;
+  StreamLexer(SourceStream& input, size_t window);
+
+  // true after the window with the final kEof has been lexed
+  bool Done() const { return eof_ && consumed_ == window_.size(); }
+
+  // lexes the next window, never returns an empty buffer
+  const TokenBuffer& Next();
+
+  // copy of the lexeme that lives as long as the lexer
+  absl::string_view Keep(absl::string_view lexeme);
+
+  // lines of the windows lexed so far
+  const LineTable& Lines() const { return lines_; }
+
+ private:
+  void Fill();
+};
+
+}
+
+#endif //HELIUM_COMPILER_SRC_PARSER_LEXER_HPP_
@@ -0,0 +1,20 @@
+#ifndef HELIUM_COMPILER_SRC_PARSER_NUMBER_HPP_
+#define HELIUM_COMPILER_SRC_PARSER_NUMBER_HPP_
+
+#include <cstdint>
+#include "absl/strings/string_view.h"
+
+namespace helium {
+namespace number {
+
+// lexeme of a kInt token, false if it doesn't fit into int64_t
+bool ParseInt(absl::string_view lexeme, int64_t* value);
+
+// lexeme of a kReal token rounded to the nearest double,
+// false if it's too large to be finite
+bool ParseReal(absl::string_view lexeme, double* value);
+
+}
+}
+
+#endif //HELIUM_COMPILER_SRC_PARSER_NUMBER_HPP_
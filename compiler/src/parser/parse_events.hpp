@@ -0,0 +1,44 @@
+#ifndef HELIUM_COMPILER_SRC_PARSER_PARSE_EVENTS_HPP_
+#define HELIUM_COMPILER_SRC_PARSER_PARSE_EVENTS_HPP_
+
+#include "constant_pool.hpp"
+#include "interner.hpp"
+#include "token.hpp"
+
+namespace helium {
+
+// Receives the constructs of a program instead of nodes, see Parser::Parse().
+// An expression is reported once its operands are, so the events come in
+// the order a checked tree is walked in: operands before operators,
+// conditions before branches. Events that come after a syntax error
+// may have operands missing
+class ParseEvents {
+ public:
+  virtual ~ParseEvents() = default;
+
+  // a statement starts, the one before it in the same block is complete
+  virtual void Statement() = 0;
+  // var name: type = initializer, the type is reported if it is declared
+  virtual void Pattern(Interner::Data name, Span span) = 0;
+  virtual void PatternType(Interner::Data type) = 0;
+  virtual void Variable() = 0; // the initializer is complete
+
+  virtual void Literal(TokenType kind, Interner::Data value, ConstantPool::Index constant) = 0;
+  virtual void Identifier(Interner::Data name, Span span) = 0;
+  virtual void Unary(TokenType op, Span span) = 0;
+  virtual void Binary(TokenType op, Span span) = 0;
+  virtual void Assign(Interner::Data name, Span span) = 0;
+
+  virtual void BlockBegin() = 0;
+  virtual void BlockEnd() = 0;
+  virtual void IfCondition() = 0;
+  virtual void IfElse() = 0; // the then branch is complete
+  virtual void IfEnd() = 0;
+  virtual void WhileBegin() = 0; // the condition follows
+  virtual void WhileCondition() = 0;
+  virtual void WhileEnd() = 0;
+};
+
+}
+
+#endif //HELIUM_COMPILER_SRC_PARSER_PARSE_EVENTS_HPP_
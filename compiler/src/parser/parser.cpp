@@ -2,262 +2,242 @@
 // Created by vasniktel on 27.08.2019.
 //
 
+#include <algorithm>
+#include <cassert>
+#include <thread>
 #include <vector>
 #include <utility>
 #include "parser.hpp"
+#include "number.hpp"
+#include "parallel.hpp"
 
 namespace helium {
 namespace {
 
 using ::std::move;
-using ::std::unique_ptr;
 using ::std::vector;
 using ::absl::string_view;
-using ::absl::make_unique;
-using ::absl::flat_hash_map;
 using TT = TokenType;
 
-bool IsAlpha(char c) {
-  return (c >= 'a' && c <= 'z') ||
-      (c >= 'A' && c <= 'Z') ||
-      c == '_';
-}
-
-bool IsDigit(char c) {
-  return c >= '0' && c <= '9';
-}
-
-bool IsAlNum(char c) {
-  return IsDigit(c) || IsAlpha(c);
-}
-
-}
-
-Parser::Parser(string_view source, ErrorReporter& reporter, Interner& interner)
-: source_(source),
-  size_(static_cast<int>(source.size())),
-  curr_char_(0),
-  start_(0),
-  line_(1),
-  col_(1),
-  curr_token_(Token::ParsedAs(*this, TT::kEof)),
-  prev_token_(Token::ParsedAs(*this, TT::kEof)),
-  panic_mode_(false),
-  reporter_(reporter),
-  interner_(interner)
-{}
-
-char Parser::AdvanceChar() {
-  if (IsAtEnd()) return '\0';
+// a slice of the tokens parsed on its own, names and constants
+// are numbered locally until the slices are merged
+struct ParsedSlice {
+  ErrorReporter reporter;
+  Interner interner;
+  ConstantPool constants;
+  AstArena arena;
+  vector<AstNode*> nodes;
+  size_t stop;
+
+  vector<Interner::Data> names;       // local name -> merged one
+  vector<ConstantPool::Index> values; // local constant -> merged one
+
+  ParsedSlice()
+  : reporter(""),
+    stop(0)
+  {}
+};
 
-  char c = source_[curr_char_++];
-  if (c == '\n') {
-    line_++;
-    col_ = 0; // new line is considered the first token
+// replaces local names and constants with the merged ones
+class Remapper final : public PatternVisitor {
+  ParsedSlice& slice_;
+
+ public:
+  explicit Remapper(ParsedSlice& slice)
+  : slice_(slice)
+  {}
+
+  // any order will do, the nodes are walked with a stack
+  void Remap(AstNode& root) {
+    vector<AstNode*> stack = {&root};
+    while (!stack.empty()) {
+      auto* node = stack.back();
+      stack.pop_back();
+      Fields(*node);
+
+      for (size_t i = 0; auto* child = ChildAt(*node, i); i++) {
+        stack.push_back(child);
+      }
+    }
   }
 
-  col_++;
-  return c;
-}
-
-void Parser::ParseComment() {
-  while (!IsAtEnd() && PeekChar() != '\n') {
-    AdvanceChar();
+  void Visit(TypedPattern& pattern) override {
+    pattern.SetName(slice_.names[pattern.GetName()]);
+    if (const auto* type = Cast<SingleType>(pattern.GetType())) {
+      pattern.SetType(slice_.arena.New<SingleType>(slice_.names[type->GetTypeData()]));
+    }
   }
-}
 
-void Parser::SkipSpace() {
-  for (; !IsAtEnd(); AdvanceChar()) {
-    switch (PeekChar()) {
-      case '\t':
-      case '\r':
-      case ' ': break;
-      case '/':
-        if (PeekNextChar() == '/') {
-          ParseComment();
-        }
+ private:
+  void Fields(AstNode& node) {
+    switch (node.GetKind()) {
+      case AstKind::kVariable:
+        static_cast<VariableStmt&>(node).GetPattern()->Accept(*this);
+        break;
+      case AstKind::kLiteral: {
+        auto& literal = static_cast<LiteralExpr&>(node);
+        auto constant = literal.Constant() == ConstantPool::kNone
+            ? ConstantPool::kNone
+            : slice_.values[literal.Constant()];
+        literal.SetValue(slice_.names[literal.Value()], constant);
+        break;
+      }
+      case AstKind::kIdentifier: {
+        auto& identifier = static_cast<IdentifierExpr&>(node);
+        identifier.SetName(slice_.names[identifier.Name()]);
+        break;
+      }
+      case AstKind::kAssign: {
+        auto& assign = static_cast<AssignExpr&>(node);
+        assert(!assign.Receiver() && "Unimplemented");
+        assign.SetName(slice_.names[assign.Name()]);
+        break;
+      }
       default:
-        return;
+        break;
     }
   }
-}
-
-void Parser::MakeToken(TT type) {
-  prev_token_ = curr_token_;
-  curr_token_ = Token::ParsedAs(*this, type);
-}
-
-void Parser::ParserError(string_view msg, const Token& token) {
-  if (panic_mode_) return;
-  panic_mode_ = true;
-  if (token.type == TT::kError) return;
-  reporter_.ErrorAt(msg, token);
-}
+};
 
-void Parser::LexError(absl::string_view msg, int line, int col) {
-  MakeToken(TT::kError);
-  reporter_.ErrorAt(msg, line, col);
-}
+// a slice starts with the first token after newlines outside of any
+// parentheses or braces, unless the token continues the statement
+// before it. A wrong guess is caught when the slices are parsed
+vector<size_t> SliceBounds(const TokenBuffer& tokens, size_t slices) {
+  vector<size_t> bounds = {0};
+  const size_t size = tokens.Size();
+  const size_t step = size / slices;
+
+  size_t depth = 0;
+  for (size_t i = 0; i < size && bounds.size() < slices; i++) {
+    switch (tokens.Type(i)) {
+      case TT::kLeftParen:
+      case TT::kLeftBrace:
+        depth++;
+        break;
+      case TT::kRightParen:
+      case TT::kRightBrace:
+        if (depth > 0) depth--;
+        break;
+      case TT::kEol: {
+        if (depth > 0 || i < bounds.back() + step) break;
+
+        size_t next = i;
+        while (tokens.Type(next) == TT::kEol) next++;
+        auto type = tokens.Type(next);
+        if (type != TT::kEof && type != TT::kElse && type != TT::kEqual &&
+            type != TT::kColon && (i == 0 || tokens.Type(i - 1) != TT::kColon)) {
+          bounds.push_back(next);
+        }
 
-// consumes characters
-bool Parser::IsValidSymbol() {
-  switch (AdvanceChar()) {
-    case '\n':
-    case '\t':
-    case '\r':
-    case '\'':
-    case '\"': return false;
-    case '\\': return IsEscape();
-    default: return true;
+        i = next - 1;
+        break;
+      }
+      default:
+        break;
+    }
   }
-}
 
-bool Parser::IsEscape() {
-  // '\\' has already been consumed
-  switch (PeekChar()) {
-    case '\'':
-    case '\"':
-    case '\\':
-      AdvanceChar();
-      return true;
-    default: return IsValidSymbol();
-  }
+  return bounds;
 }
 
-// TODO: define and handle escape sequences
-void Parser::ParseChar() {
-  const int line = line_, col = col_ - 1;
-  bool valid;
-
-  if (PeekChar() == '"') {
-    AdvanceChar();
-    valid = true;
-  } else {
-    valid = IsValidSymbol();
-  }
-
-  valid = valid && AdvanceChar() == '\'';
-
-  if (!valid) {
-    LexError("Invalid character literal", line, col);
-    return;
-  }
-
-  MakeToken(TT::kChar);
 }
 
-// TODO: define and handle escape sequences
-void Parser::ParseString() {
-  const int line = line_, col = col_ - 1;
-
-  bool valid = true;
-  while (!IsAtEnd() && PeekChar() != '"') {
-    switch (PeekChar()) {
-      case '\'':
-      case '\n':
-      case '\t':
-      case '\r':
-        AdvanceChar();
-        break;
-      default:
-        valid = valid && IsValidSymbol();
-    }
-  }
+constexpr size_t Parser::kParallelTokens;
+constexpr size_t Parser::kMinSlice;
 
-  if (!valid) {
-    LexError("Invalid string literal", line, col);
-    return;
-  }
+Parser::Parser(const TokenBuffer& tokens, StreamLexer* stream,
+    ErrorReporter& reporter, Interner& interner, ConstantPool& constants,
+    AstArena& arena)
+: tokens_(&tokens),
+  stream_(stream),
+  next_token_(0),
+  next_error_(0),
+  curr_token_({TT::kEof, {0, 0}, tokens.Source().substr(0, 0), 0}),
+  prev_token_(curr_token_),
+  panic_mode_(false),
+  reporter_(reporter),
+  interner_(interner),
+  constants_(constants),
+  arena_(arena),
+  lazy_(nullptr),
+  events_(nullptr),
+  value_(nullptr)
+{}
 
-  if (AdvanceChar() != '"') {
-    LexError("Missing closing \"", line, col);
-    return;
+class Parser::Lazy final : public BlockSource {
+  const TokenBuffer& tokens_;
+  ErrorReporter& reporter_;
+  Interner& interner_;
+  ConstantPool& constants_;
+  AstArena arena_; // of the bodies parsed so far
+
+ public:
+  Lazy(const TokenBuffer& tokens, ErrorReporter& reporter,
+       Interner& interner, ConstantPool& constants)
+  : tokens_(tokens),
+    reporter_(reporter),
+    interner_(interner),
+    constants_(constants)
+  {}
+
+  vector<AstNode*> ParseBody(uint32_t begin, uint32_t end) override {
+    // nodes are dropped after an error, only the ones in this body count
+    ErrorReporter reporter(reporter_.FileName());
+    reporter.SetSource(tokens_.Source());
+
+    Parser parser(tokens_, nullptr, reporter, interner_, constants_, arena_);
+    parser.lazy_ = this;
+    parser.next_token_ = begin;
+    parser.NextToken();
+    auto body = parser.Sequence<AstNode>(TT::kEol, TT::kRightBrace, [&parser] {
+      return parser.Statement();
+    });
+
+    assert(reporter.HadErrors() || parser.CurrIndex() == end + 1);
+    static_cast<void>(end);
+    reporter_.Append(reporter);
+    return body;
   }
+};
 
-  MakeToken(TT::kString);
-}
-
-void Parser::ParseNumber() {
-  const int line = line_, col = col_ - 1;
-  while (!IsAtEnd() && IsDigit(PeekChar())) {
-    AdvanceChar();
+// lexer errors are reported when the parser gets to them
+Token& Parser::NextToken() {
+  prev_token_ = curr_token_;
+  curr_token_ = tokens_->At(next_token_);
+  if (stream_) {
+    // the window is going to be replaced
+    curr_token_.lexeme = stream_->Keep(curr_token_.lexeme);
   }
 
-  bool real = PeekChar() == '.';
-  if (real) {
-    do {
-      AdvanceChar();
-    } while (!IsAtEnd() && IsDigit(PeekChar()));
+  const auto& errors = tokens_->Errors();
+  if (next_error_ < errors.size() && errors[next_error_].token == next_token_) {
+    reporter_.ErrorAt(errors[next_error_++].msg, curr_token_.span);
   }
 
-  if (source_[start_] == '0' && curr_char_ - start_ > 1) {
-    LexError("Invalid number literal", line, col);
-    return;
+  if (next_token_ + 1 < tokens_->Size()) {
+    next_token_++;
+  } else if (stream_ && !stream_->Done()) {
+    tokens_ = &stream_->Next();
+    next_token_ = 0;
+    next_error_ = 0;
   }
 
-  MakeToken(real ? TT::kReal : TT::kInt);
+  // otherwise the last token is kEof, stay there
+  return prev_token_;
 }
 
-void Parser::ParseIdentifier() {
-  static const flat_hash_map<string_view, TT> keywords = {
-      {"var",   TT::kVar},
-      {"while", TT::kWhile},
-      {"if",    TT::kIf},
-      {"else",  TT::kElse},
-      {"true",  TT::kTrue},
-      {"false", TT::kFalse},
-      {"unit",  TT::kUnit}
-  };
-
-  while (!IsAtEnd() && IsAlNum(PeekChar())) {
-    AdvanceChar();
-  }
-
-  auto id = source_.substr(start_, curr_char_ - start_);
-  MakeToken(keywords.contains(id) ? keywords.at(id) : TT::kIdentifier);
+// identifiers come with the hash computed by the lexer
+Interner::Data Parser::InternName(const Token& token) {
+  return token.type == TT::kIdentifier
+      ? interner_.Intern(token.lexeme, token.hash)
+      : interner_.Intern(token.lexeme);
 }
 
-Token& Parser::NextToken() {
-  SkipSpace();
-  start_ = curr_char_;
-
-  char c = AdvanceChar();
-  switch (c) {
-    case '\0': MakeToken(TT::kEof);
-      break;
-    case '\n': MakeToken(TT::kEol);
-      break;
-    case '{': MakeToken(TT::kLeftBrace);
-      break;
-    case '}': MakeToken(TT::kRightBrace);
-      break;
-    case '(': MakeToken(TT::kLeftParen);
-      break;
-    case ')': MakeToken(TT::kRightParen);
-      break;
-    case '+': MakeToken(TT::kPlus);
-      break;
-    case '-': MakeToken(TT::kMinus);
-      break;
-    case '*': MakeToken(TT::kStar);
-      break;
-    case '/': MakeToken(TT::kSlash);
-      break;
-    case '=': MakeToken(TT::kEqual);
-      break;
-    case ':': MakeToken(TT::kColon);
-      break;
-    case '"': ParseString();
-      break;
-    case '\'': ParseChar();
-      break;
-    default:
-      if (IsAlpha(c)) ParseIdentifier();
-      else if (IsDigit(c)) ParseNumber();
-      else LexError("Unexpected symbol", line_, col_ - 1);
-  }
-
-  return prev_token_;
+void Parser::ParserError(string_view msg, const Token& token) {
+  if (panic_mode_) return;
+  panic_mode_ = true;
+  if (token.type == TT::kError) return;
+  reporter_.ErrorAt(msg, token);
 }
 
 void Parser::SkipEolTokens() {
@@ -279,7 +259,7 @@ bool Parser::ConsumeToken(TT type, bool ignore_eol, string_view msg) {
   return false;
 }
 
-enum class Parser::Precedence {
+enum class Parser::Precedence : uint8_t {
   kNone,
   kAssign,
   kAdd,
@@ -288,8 +268,9 @@ enum class Parser::Precedence {
 };
 
 struct Parser::Rule {
-  using PrefixFn = unique_ptr<Expr>(Parser::*)(bool can_assign);
-  using InfixFn  = unique_ptr<Expr>(Parser::*)(unique_ptr<Expr> left);
+  // either set value_ or push the frames that do
+  using PrefixFn = void (Parser::*)(bool can_assign);
+  using InfixFn  = void (Parser::*)(Expr* left);
 
   PrefixFn prefix;
   InfixFn infix;
@@ -330,13 +311,13 @@ const Parser::Rule Parser::rules_[] = {
 };
 
 template <typename T, typename F>
-vector<unique_ptr<T>> Parser::Sequence(TT separator, TT closing, F parser) {
+vector<T*> Parser::Sequence(TT separator, TT closing, F parser) {
   if (MatchToken(closing, true)) return {};
 
-  vector<unique_ptr<T>> result;
+  vector<T*> result;
   while (true) {
     auto node = parser();
-    if (node) result.emplace_back(move(node));
+    if (node) result.push_back(node);
 
     bool has_separator = MatchToken(separator, separator != TT::kEol);
     auto maybe_sep = prev_token_;
@@ -354,209 +335,642 @@ vector<unique_ptr<T>> Parser::Sequence(TT separator, TT closing, F parser) {
   return result;
 }
 
-vector<unique_ptr<AstNode>> Parser::Parse(
-    string_view source, ErrorReporter& reporter, Interner& interner) {
-  Parser parser(source, reporter, interner);
-  parser.NextToken();
-  return parser.Sequence<AstNode>(TT::kEol, TT::kEof, [&parser] {
-    return parser.Statement();
+AstTree Parser::Parse(
+    string_view source, ErrorReporter& reporter,
+    Interner& interner, ConstantPool& constants) {
+  return Parse(Lexer::Lex(source), reporter, interner, constants);
+}
+
+AstTree Parser::Parse(
+    const TokenBuffer& tokens, ErrorReporter& reporter,
+    Interner& interner, ConstantPool& constants) {
+  const size_t threads = ::std::thread::hardware_concurrency();
+  if (tokens.Size() >= kParallelTokens && threads > 1) {
+    const size_t slices = ::std::min(threads * 4, tokens.Size() / kMinSlice);
+    return ParseParallel(tokens, reporter, interner, constants, slices, threads);
+  }
+
+  return ParseSequential(tokens, reporter, interner, constants);
+}
+
+AstTree Parser::ParseParallel(
+    const TokenBuffer& tokens, ErrorReporter& reporter,
+    Interner& interner, ConstantPool& constants,
+    size_t slices, size_t threads) {
+  assert(slices > 0 && threads > 0);
+
+  // nodes after an error depend on the errors before them
+  if (!tokens.Errors().empty() || reporter.HadErrors()) {
+    return ParseSequential(tokens, reporter, interner, constants);
+  }
+
+  auto bounds = SliceBounds(tokens, slices);
+  bounds.push_back(tokens.Size() - 1); // kEof
+  slices = bounds.size() - 1;
+  if (slices < 2) {
+    return ParseSequential(tokens, reporter, interner, constants);
+  }
+
+  vector<ParsedSlice> parsed(slices);
+  RunParallel(slices, threads, [&](size_t i) {
+    auto& slice = parsed[i];
+    slice.reporter.SetSource(tokens.Source());
+    Parser parser(tokens, nullptr, slice.reporter,
+                  slice.interner, slice.constants, slice.arena);
+    slice.nodes = parser.Slice(bounds[i], bounds[i + 1], &slice.stop);
   });
+
+  // a statement crossed the bound or there is an error to be reported
+  // in the order the sequential parser finds it
+  for (size_t i = 0; i < slices; i++) {
+    if (parsed[i].reporter.HadErrors() || parsed[i].stop != bounds[i + 1]) {
+      return ParseSequential(tokens, reporter, interner, constants);
+    }
+  }
+
+  // slices are merged in order, so names and constants get the same
+  // numbers as they do when the tokens are parsed sequentially
+  reporter.SetSource(tokens.Source());
+  size_t total = 0;
+  for (auto& slice : parsed) {
+    slice.names.reserve(slice.interner.Size());
+    for (size_t name = 0; name < slice.interner.Size(); name++) {
+      slice.names.push_back(interner.Intern(*slice.interner.LookUp(name)));
+    }
+
+    slice.values.reserve(slice.constants.Size());
+    for (ConstantPool::Index index = 0; index < slice.constants.Size(); index++) {
+      const auto& constant = slice.constants.Get(index);
+      slice.values.push_back(constant.kind == ConstantPool::Kind::kInt
+                             ? constants.AddInt(constant.Int())
+                             : constants.AddReal(constant.Real()));
+    }
+
+    total += slice.nodes.size();
+  }
+
+  RunParallel(slices, threads, [&](size_t i) {
+    Remapper remapper(parsed[i]);
+    for (auto* node : parsed[i].nodes) {
+      remapper.Remap(*node);
+    }
+  });
+
+  AstArena arena;
+  vector<AstNode*> nodes;
+  nodes.reserve(total);
+  for (auto& slice : parsed) {
+    arena.Merge(move(slice.arena));
+    nodes.insert(nodes.end(), slice.nodes.begin(), slice.nodes.end());
+  }
+
+  return AstTree(move(arena), move(nodes));
 }
 
-#define PARSE_EXPRESSION(var, precedence, skip_eol) \
-    do { \
-      panic_mode_ = false; \
-      if ((skip_eol)) SkipEolTokens(); \
-      var = Expression(precedence); \
-      assert(reporter_.HadErrors() || var); \
-    } while (false)
+AstTree Parser::ParseLazy(
+    const TokenBuffer& tokens, ErrorReporter& reporter,
+    Interner& interner, ConstantPool& constants) {
+  // lexer errors are reported in order as the parser gets to them
+  if (!tokens.Errors().empty()) {
+    return ParseSequential(tokens, reporter, interner, constants);
+  }
+
+  reporter.SetSource(tokens.Source());
+  auto lazy = ::absl::make_unique<Lazy>(tokens, reporter, interner, constants);
+  AstArena arena;
+  Parser parser(tokens, nullptr, reporter, interner, constants, arena);
+  parser.lazy_ = lazy.get();
+  auto nodes = parser.Program();
+  return AstTree(move(arena), move(nodes), move(lazy));
+}
+
+AstTree Parser::ParseSequential(
+    const TokenBuffer& tokens, ErrorReporter& reporter,
+    Interner& interner, ConstantPool& constants) {
+  reporter.SetSource(tokens.Source());
+  AstArena arena;
+  Parser parser(tokens, nullptr, reporter, interner, constants, arena);
+  auto nodes = parser.Program();
+  return AstTree(move(arena), move(nodes));
+}
+
+AstTree Parser::Parse(
+    StreamLexer& stream, ErrorReporter& reporter,
+    Interner& interner, ConstantPool& constants) {
+  reporter.SetLines(stream.Lines());
+  AstArena arena;
+  Parser parser(stream.Next(), &stream, reporter, interner, constants, arena);
+  auto nodes = parser.Program();
+  return AstTree(move(arena), move(nodes));
+}
+
+void Parser::Parse(
+    const TokenBuffer& tokens, ErrorReporter& reporter,
+    Interner& interner, ConstantPool& constants, ParseEvents& events) {
+  reporter.SetSource(tokens.Source());
+  AstArena arena; // stays empty
+  Parser parser(tokens, nullptr, reporter, interner, constants, arena);
+  parser.events_ = &events;
+  parser.Program();
+}
+
+vector<AstNode*> Parser::Program() {
+  NextToken();
+  return Sequence<AstNode>(TT::kEol, TT::kEof, [this] {
+    return Statement();
+  });
+}
+
+// the same as Sequence() with a kEol separator, but stops at the
+// first statement starting at or after the end
+vector<AstNode*> Parser::Slice(size_t begin, size_t end, size_t* stop) {
+  next_token_ = begin;
+  NextToken();
+
+  vector<AstNode*> result;
+  SkipEolTokens();
+  while (curr_token_.type != TT::kEof && CurrIndex() < end) {
+    auto node = Statement();
+    if (node) result.push_back(node);
+
+    bool has_separator = MatchToken(TT::kEol, false);
+    auto maybe_sep = prev_token_;
+    SkipEolTokens();
+
+    if (curr_token_.type == TT::kEof) break;
+    if (!has_separator) {
+      ParserError("Missing separator in a sequence", maybe_sep);
+      break;
+    }
+  }
+
+  *stop = CurrIndex();
+  return result;
+}
+
+size_t Parser::CurrIndex() const {
+  assert(!stream_);
+  // NextToken() stays at the last token
+  return curr_token_.type == TT::kEof ? tokens_->Size() - 1 : next_token_ - 1;
+}
+
+size_t Parser::MatchBrace(size_t begin) const {
+  size_t depth = 1;
+  for (size_t i = begin; i < tokens_->Size(); i++) {
+    auto type = tokens_->Type(i);
+    if (type == TT::kLeftBrace) {
+      depth++;
+    } else if (type == TT::kRightBrace && --depth == 0) {
+      return i;
+    }
+  }
+
+  return tokens_->Size();
+}
 
 #define CONSTRUCT_NODE(node) \
-      reporter_.HadErrors() ? nullptr : (node)
+      reporter_.HadErrors() || events_ ? nullptr : (node)
+
+// leaves are built even after errors
+#define CONSTRUCT_LEAF(node) \
+      events_ ? nullptr : (node)
 
 #define IGNORE(expr) \
       static_cast<void>((expr))
 
-unique_ptr<Expr> Parser::Expression(Precedence precedence) {
-  const auto& token = NextToken();
-  auto prefix = rules_[static_cast<int>(token.type)].prefix;
-  if (prefix == nullptr) {
-    ParserError("Unexpected token", token);
-    return nullptr;
+// Constructs nest without recursion, so the depth of the input is
+// only limited by memory. A construct that needs an operand pushes its
+// frame and the frame of the operand, the operand leaves its node in
+// value_ and the construct is resumed
+AstNode* Parser::Run(Frame frame) {
+  const auto base = frames_.size();
+  frames_.push_back(frame);
+  while (frames_.size() > base) {
+    Resume(frames_.size() - 1);
   }
 
-  bool can_assign = precedence <= Precedence::kAssign;
-  auto left = (this->*prefix)(can_assign);
-  if (panic_mode_) return nullptr;
+  return value_;
+}
+
+void Parser::Push(Frame::Kind kind, uint8_t state) {
+  Frame frame{};
+  frame.kind = kind;
+  frame.state = state;
+  frames_.push_back(frame);
+}
+
+void Parser::PushExpression(Precedence precedence) {
+  Push(Frame::Kind::kExpression, 0);
+  frames_.back().precedence = precedence;
+}
+
+void Parser::PushOperand(Precedence precedence, bool skip_eol) {
+  panic_mode_ = false;
+  if (skip_eol) SkipEolTokens();
+  PushExpression(precedence);
+}
+
+void Parser::Finish(AstNode* node) {
+  value_ = node;
+  frames_.pop_back();
+}
+
+AstNode* Parser::Statement() {
+  Frame frame{};
+  frame.kind = Frame::Kind::kStatement;
+  return Run(frame);
+}
+
+// frames_ might grow, so the frame is accessed by its index
+void Parser::Resume(size_t top) {
+  auto* value = static_cast<Expr*>(value_);
+  switch (frames_[top].kind) {
+    case Frame::Kind::kStatement:
+      if (frames_[top].state == 0) {
+        // we synchronize at statement level and higher
+        panic_mode_ = false;
+        if (events_) events_->Statement();
+        if (MatchToken(TT::kVar, true)) {
+          Variable(top);
+        } else {
+          frames_[top].state = 1;
+          PushExpression(Precedence::kAssign);
+        }
+      } else if (frames_[top].state == 1) {
+        Finish(value_);
+      } else {
+        assert(reporter_.HadErrors() || events_ || value);
+        if (events_) events_->Variable();
+        Finish(CONSTRUCT_NODE(arena_.New<VariableStmt>(frames_[top].pattern, value)));
+      }
+      break;
+
+    case Frame::Kind::kExpression:
+      if (frames_[top].state == 0) {
+        const auto& token = NextToken();
+        auto prefix = rules_[static_cast<int>(token.type)].prefix;
+        if (prefix == nullptr) {
+          ParserError("Unexpected token", token);
+          Finish(nullptr);
+          break;
+        }
+
+        frames_[top].can_assign = frames_[top].precedence <= Precedence::kAssign;
+        frames_[top].state = 1;
+        (this->*prefix)(frames_[top].can_assign);
+
+        // a leaf is followed by its operators right away
+        if (frames_.size() != top + 1) break;
+        value = static_cast<Expr*>(value_);
+      }
+
+      // value is the left operand of the next operator
+      while (true) {
+        if (panic_mode_) {
+          Finish(nullptr);
+        } else if (rules_[static_cast<int>(curr_token_.type)].precedence
+                   >= frames_[top].precedence) {
+          const auto& op = NextToken();
+          auto infix = rules_[static_cast<int>(op.type)].infix;
+          (this->*infix)(value);
+          if (frames_.size() == top + 1) {
+            value = static_cast<Expr*>(value_);
+            continue;
+          }
+        } else if (frames_[top].can_assign && MatchToken(TT::kEqual, false)) {
+          ParserError("Invalid assignment target", prev_token_);
+          Finish(nullptr);
+        } else {
+          Finish(value);
+        }
+
+        break;
+      }
+      break;
+
+    case Frame::Kind::kBinary:
+      // we either had errors previously (in which case operand can be anything)
+      // or we had no errors and operand must be a valid node
+      assert(reporter_.HadErrors() || events_ || value);
+      if (events_) events_->Binary(frames_[top].op, frames_[top].span);
+      Finish(CONSTRUCT_NODE(arena_.New<BinaryExpr>(
+          frames_[top].first, frames_[top].op, frames_[top].span, value)));
+      break;
 
-  while (rules_[static_cast<int>(curr_token_.type)].precedence >= precedence) {
-    const auto& op = NextToken();
-    auto infix = rules_[static_cast<int>(op.type)].infix;
-    left = (this->*infix)(move(left));
-    if (panic_mode_) return nullptr;
+    case Frame::Kind::kUnary:
+      assert(reporter_.HadErrors() || events_ || value);
+      if (events_) events_->Unary(frames_[top].op, frames_[top].span);
+      Finish(CONSTRUCT_NODE(arena_.New<UnaryExpr>(
+          frames_[top].op, frames_[top].span, value)));
+      break;
+
+    case Frame::Kind::kAssign:
+      assert(reporter_.HadErrors() || events_ || value);
+      if (events_) events_->Assign(frames_[top].name, frames_[top].span);
+      Finish(CONSTRUCT_NODE(arena_.New<AssignExpr>(
+          nullptr, frames_[top].name, frames_[top].span, value)));
+      break;
+
+    case Frame::Kind::kGrouping:
+      assert(reporter_.HadErrors() || events_ || value);
+      ConsumeToken(TT::kRightParen, true,
+          "Missing closing )");
+      Finish(CONSTRUCT_NODE(value));
+      break;
+
+    case Frame::Kind::kBlock:
+      BlockStatement();
+      break;
+
+    case Frame::Kind::kIf:
+      IfBranch(top);
+      break;
+
+    case Frame::Kind::kWhile:
+      WhileBody(top);
+      break;
   }
+}
 
-  if (can_assign && MatchToken(TT::kEqual, false)) {
-    ParserError("Invalid assignment target", prev_token_);
-    return nullptr;
+Parser::Leaf Parser::ParseLeaf(Precedence precedence) {
+  assert(precedence > Precedence::kAssign);
+  auto prefix = rules_[static_cast<int>(curr_token_.type)].prefix;
+  if (prefix != &Parser::Literal && prefix != &Parser::Identifier) {
+    return Leaf::kNone;
   }
 
-  return left;
+  NextToken();
+  (this->*prefix)(false);
+  return rules_[static_cast<int>(curr_token_.type)].precedence < precedence
+      ? Leaf::kWhole
+      : Leaf::kPartial;
 }
 
-unique_ptr<AstNode> Parser::Statement() {
-  // we synchronize at statement level and higher
-  panic_mode_ = false;
-  if (MatchToken(TT::kVar, true)) return Variable();
-  return Expression(Precedence::kAssign);
+void Parser::PushOperand(Precedence precedence, Leaf leaf) {
+  PushExpression(precedence);
+  if (leaf == Leaf::kPartial) {
+    // value_ is the left operand of the next operator
+    frames_.back().state = 1;
+  }
 }
 
-unique_ptr<Expr> Parser::Binary(unique_ptr<Expr> left) {
+void Parser::Binary(Expr* left) {
   assert(!panic_mode_);
 
-  auto op = prev_token_;
+  const auto op = prev_token_;
   const auto& rule = rules_[static_cast<int>(op.type)];
   auto precedence = static_cast<Precedence>(static_cast<int>(rule.precedence) + 1);
-  auto right = Expression(precedence);
 
-  // we either had errors previously (in which case operand can be anything)
-  // or we had no errors and operand must be a valid node
-  assert(reporter_.HadErrors() || right);
+  auto leaf = ParseLeaf(precedence);
+  if (leaf == Leaf::kWhole) {
+    if (events_) events_->Binary(op.type, op.span);
+    value_ = CONSTRUCT_NODE(arena_.New<BinaryExpr>(
+        left, op.type, op.span, static_cast<Expr*>(value_)));
+    return;
+  }
 
-  return CONSTRUCT_NODE(make_unique<BinaryExpr>(move(left), op, move(right)));
+  Push(Frame::Kind::kBinary, 0);
+  frames_.back().op = op.type;
+  frames_.back().span = op.span;
+  frames_.back().first = left;
+  PushOperand(precedence, leaf);
 }
 
-unique_ptr<Expr> Parser::Unary(bool can_assign) {
+void Parser::Unary(bool can_assign) {
   IGNORE(can_assign);
   assert(!panic_mode_);
 
-  auto op = prev_token_;
-  auto operand = Expression(Precedence::kUnary);
-
-  // we either had errors previously (in which case operand can be anything)
-  // or we had no errors and operand must be a valid node
-  assert(reporter_.HadErrors() || operand);
+  const auto op = prev_token_;
+  auto leaf = ParseLeaf(Precedence::kUnary);
+  if (leaf == Leaf::kWhole) {
+    if (events_) events_->Unary(op.type, op.span);
+    value_ = CONSTRUCT_NODE(arena_.New<UnaryExpr>(
+        op.type, op.span, static_cast<Expr*>(value_)));
+    return;
+  }
 
-  return CONSTRUCT_NODE(make_unique<UnaryExpr>(op, move(operand)));
+  Push(Frame::Kind::kUnary, 0);
+  frames_.back().op = op.type;
+  frames_.back().span = op.span;
+  PushOperand(Precedence::kUnary, leaf);
 }
 
-unique_ptr<Expr> Parser::Identifier(bool can_assign) {
-  auto node = make_unique<IdentifierExpr>(prev_token_);
+void Parser::Identifier(bool can_assign) {
+  auto name = InternName(prev_token_);
+  auto span = prev_token_.span;
 
   if (can_assign && MatchToken(TT::kEqual, false)) {
-    unique_ptr<Expr> expr;
-    PARSE_EXPRESSION(expr, Precedence::kAssign, false);
-    return CONSTRUCT_NODE(make_unique<AssignExpr>(nullptr, move(node), move(expr)));
+    Push(Frame::Kind::kAssign, 0);
+    frames_.back().name = name;
+    frames_.back().span = span;
+    PushOperand(Precedence::kAssign, false);
+    return;
   }
 
-  return move(node);
+  if (events_) events_->Identifier(name, span);
+  value_ = CONSTRUCT_LEAF(arena_.New<IdentifierExpr>(name, span));
 }
 
-unique_ptr<Expr> Parser::Literal(bool can_assign) {
+void Parser::Literal(bool can_assign) {
   IGNORE(can_assign);
-  return make_unique<LiteralExpr>(prev_token_);
+  const auto& token = prev_token_;
+  auto constant = ConstantPool::kNone;
+
+  // a literal that is out of range is not a syntax error,
+  // parsing goes on
+  if (token.type == TT::kInt) {
+    int64_t value;
+    if (number::ParseInt(token.lexeme, &value)) {
+      constant = constants_.AddInt(value);
+    } else {
+      reporter_.ErrorAt("Integer literal is too large", token);
+    }
+  } else if (token.type == TT::kReal) {
+    double value;
+    if (number::ParseReal(token.lexeme, &value)) {
+      constant = constants_.AddReal(value);
+    } else {
+      reporter_.ErrorAt("Real literal is too large", token);
+    }
+  }
+
+  auto value = interner_.Intern(token.lexeme);
+  if (events_) events_->Literal(token.type, value, constant);
+  value_ = CONSTRUCT_LEAF(arena_.New<LiteralExpr>(token.type, value, token.span, constant));
 }
 
-unique_ptr<Expr> Parser::Grouping(bool can_assign) {
+void Parser::Grouping(bool can_assign) {
   IGNORE(can_assign);
   assert(!panic_mode_);
 
-  unique_ptr<Expr> expr;
-  PARSE_EXPRESSION(expr, Precedence::kAssign, true);
-
-  ConsumeToken(TT::kRightParen, true,
-      "Missing closing )");
-
-  return CONSTRUCT_NODE(move(expr));
+  Push(Frame::Kind::kGrouping, 0);
+  PushOperand(Precedence::kAssign, true);
 }
 
 // TODO
-unique_ptr<Type> Parser::ParseType(bool ignore_eol) {
+Type* Parser::ParseType(bool ignore_eol) {
   ConsumeToken(TT::kIdentifier, ignore_eol, "Invalid type syntax");
-  return make_unique<SingleType>(interner_.Intern(prev_token_.lexeme));
+  auto type = InternName(prev_token_);
+  if (events_) events_->PatternType(type);
+  return CONSTRUCT_LEAF(arena_.New<SingleType>(type));
 }
 
-unique_ptr<Pattern> Parser::ParsePattern(bool ignore_eol) {
+Pattern* Parser::ParsePattern(bool ignore_eol) {
   if (MatchToken(TT::kIdentifier, ignore_eol)) {
-    auto name = prev_token_;
-    unique_ptr<Type> type;
+    auto name = InternName(prev_token_);
+    auto span = prev_token_.span;
+    if (events_) events_->Pattern(name, span);
+    Type* type = nullptr;
     if (MatchToken(TT::kColon, true)) {
       type = ParseType(true);
     }
 
-    return make_unique<TypedPattern>(name, move(type));
+    return CONSTRUCT_LEAF(arena_.New<TypedPattern>(name, span, type));
   }
 
   ParserError("Unexpected token: invalid pattern", prev_token_);
   return nullptr;
 }
 
-unique_ptr<AstNode> Parser::Variable() {
+void Parser::Variable(size_t top) {
   // panic mode must have been cleared up by the caller
   assert(!panic_mode_);
 
-  auto pattern = ParsePattern(false);
+  frames_[top].pattern = ParsePattern(false);
 
   ConsumeToken(TT::kEqual, true, "Initializer expected");
 
-  unique_ptr<Expr> expr;
-  PARSE_EXPRESSION(expr, Precedence::kAssign, false);
-int
-  return CONSTRUCT_NODE(make_unique<VariableStmt>(move(pattern), move(expr)));
+  frames_[top].state = 2;
+  PushOperand(Precedence::kAssign, false);
 }
 
-unique_ptr<Expr> Parser::Block(bool can_assign) {
+void Parser::Block(bool can_assign) {
   IGNORE(can_assign);
   assert(!panic_mode_);
-  auto body = Sequence<AstNode>(TT::kEol, TT::kRightBrace, [this] {
-    return Statement();
-  });
-  return CONSTRUCT_NODE(make_unique<BlockExpr>(move(body)));
+
+  // the body is only matched for braces, an unclosed block
+  // is parsed right away to report the error
+  if (lazy_) {
+    auto begin = CurrIndex();
+    auto end = MatchBrace(begin);
+    if (end < tokens_->Size()) {
+      next_token_ = end;
+      NextToken();
+      NextToken(); // prev_token_ is the }
+      value_ = CONSTRUCT_NODE(arena_.New<BlockExpr>(
+          *lazy_, static_cast<uint32_t>(begin), static_cast<uint32_t>(end)));
+      return;
+    }
+  }
+
+  // the same as Sequence() with a kEol separator
+  if (events_) events_->BlockBegin();
+  if (MatchToken(TT::kRightBrace, true)) {
+    if (events_) events_->BlockEnd();
+    value_ = CONSTRUCT_NODE(arena_.New<BlockExpr>(vector<AstNode*>()));
+    return;
+  }
+
+  bodies_.emplace_back();
+  Push(Frame::Kind::kBlock, 0);
+  Push(Frame::Kind::kStatement, 0);
+}
+
+void Parser::BlockStatement() {
+  if (value_) bodies_.back().push_back(value_);
+
+  bool has_separator = MatchToken(TT::kEol, false);
+  auto maybe_sep = prev_token_;
+
+  if (MatchToken(TT::kRightBrace, true)) {
+    // the block is complete
+  } else if (MatchToken(TT::kEof, false)) {
+    ParserError("Missing closing token", maybe_sep);
+  } else if (!has_separator) {
+    ParserError("Missing separator in a sequence", maybe_sep);
+  } else {
+    Push(Frame::Kind::kStatement, 0);
+    return;
+  }
+
+  auto body = move(bodies_.back());
+  bodies_.pop_back();
+  if (events_) events_->BlockEnd();
+  Finish(CONSTRUCT_NODE(arena_.New<BlockExpr>(move(body))));
 }
 
-unique_ptr<Expr> Parser::If(bool can_assign) {
+void Parser::If(bool can_assign) {
   IGNORE(can_assign);
   assert(!panic_mode_);
 
   ConsumeToken(TT::kLeftParen, false,
       "Missing ( before condition in 'if' expression");
 
-  unique_ptr<Expr> condition, then_branch, else_branch;
-  PARSE_EXPRESSION(condition, Precedence::kAssign, true);
-
-  ConsumeToken(TT::kRightParen, true,
-      "Missing ) after condition in 'if' expression");
+  Push(Frame::Kind::kIf, 0);
+  PushOperand(Precedence::kAssign, true);
+}
 
-  PARSE_EXPRESSION(then_branch, Precedence::kAssign, false);
+void Parser::IfBranch(size_t top) {
+  auto* value = static_cast<Expr*>(value_);
+  assert(reporter_.HadErrors() || events_ || value);
 
-  if (MatchToken(TT::kElse, true)) {
-    PARSE_EXPRESSION(else_branch, Precedence::kAssign, false);
+  switch (frames_[top].state++) {
+    case 0:
+      if (events_) events_->IfCondition();
+      frames_[top].first = value;
+      ConsumeToken(TT::kRightParen, true,
+          "Missing ) after condition in 'if' expression");
+      PushOperand(Precedence::kAssign, false);
+      break;
+    case 1:
+      frames_[top].second = value;
+      if (MatchToken(TT::kElse, true)) {
+        if (events_) events_->IfElse();
+        PushOperand(Precedence::kAssign, false);
+      } else {
+        if (events_) events_->IfEnd();
+        Finish(CONSTRUCT_NODE(arena_.New<IfExpr>(
+            frames_[top].first, frames_[top].second, nullptr)));
+      }
+      break;
+    default:
+      if (events_) events_->IfEnd();
+      Finish(CONSTRUCT_NODE(arena_.New<IfExpr>(
+          frames_[top].first, frames_[top].second, value)));
+      break;
   }
-
-  return CONSTRUCT_NODE(make_unique<IfExpr>(
-      move(condition), move(then_branch), move(else_branch)));
 }
 
-unique_ptr<Expr> Parser::While(bool can_assign) {
+void Parser::While(bool can_assign) {
   IGNORE(can_assign);
   assert(!panic_mode_);
 
   ConsumeToken(TT::kLeftParen, false,
       "Missing ( before condition in 'if' expression");
 
-  unique_ptr<Expr> condition, body;
-  PARSE_EXPRESSION(condition, Precedence::kAssign, true);
-
-  ConsumeToken(TT::kRightParen, true,
-      "Missing ) after condition in 'if' expression");
+  if (events_) events_->WhileBegin();
+  Push(Frame::Kind::kWhile, 0);
+  PushOperand(Precedence::kAssign, true);
+}
 
-  PARSE_EXPRESSION(body, Precedence::kAssign, false);
+void Parser::WhileBody(size_t top) {
+  auto* value = static_cast<Expr*>(value_);
+  assert(reporter_.HadErrors() || events_ || value);
 
-  return CONSTRUCT_NODE(make_unique<WhileExpr>(move(condition), move(body)));
+  if (frames_[top].state++ == 0) {
+    if (events_) events_->WhileCondition();
+    frames_[top].first = value;
+    ConsumeToken(TT::kRightParen, true,
+        "Missing ) after condition in 'if' expression");
+    PushOperand(Precedence::kAssign, false);
+  } else {
+    if (events_) events_->WhileEnd();
+    Finish(CONSTRUCT_NODE(arena_.New<WhileExpr>(frames_[top].first, value)));
+  }
 }
 
 #undef IGNORE
+#undef CONSTRUCT_LEAF
 #undef CONSTRUCT_NODE
-#undef PARSE_EXPRESSION
 
 }
@@ -12,79 +12,171 @@
 #include "absl/memory/memory.h"
 #include "token.hpp"
 #include "ast.hpp"
+#include "lexer.hpp"
 #include "error_reporter.hpp"
+#include "constant_pool.hpp"
+#include "parse_events.hpp"
 
 namespace helium {
 
 class Parser final {
  private:
-  friend struct Token;
-
-  absl::string_view source_;
-  int size_;
-  int curr_char_;
-  int start_;
-  int line_;
-  int col_;
+  friend class Document;
+
+  // token buffers at least this large are parsed by several threads
+  static constexpr size_t kParallelTokens = 1 << 18;
+  static constexpr size_t kMinSlice = 1 << 14;
+
+  const TokenBuffer* tokens_;
+  StreamLexer* stream_; // refills tokens_, might be null
+  size_t next_token_;
+  size_t next_error_; // next error in tokens_.Errors() to be reported
   Token curr_token_;
   Token prev_token_;
   bool panic_mode_;
   ErrorReporter& reporter_;
   Interner& interner_;
+  ConstantPool& constants_;
+  AstArena& arena_; // of the tree being built
+  class Lazy;
+  Lazy* lazy_; // block bodies are skipped if set
+  ParseEvents* events_; // gets the constructs instead of nodes if set
+
+  enum class Precedence : uint8_t;
+
+  // a construct waiting for its operand to be parsed, see Run()
+  struct Frame {
+    enum class Kind : uint8_t {
+      kStatement,
+      kExpression,
+      kBinary,
+      kUnary,
+      kAssign,
+      kGrouping,
+      kBlock,
+      kIf,
+      kWhile,
+    };
+
+    Kind kind;
+    uint8_t state;
+    Precedence precedence; // of kExpression
+    bool can_assign;
+    TokenType op;
+    Span span;
+    Interner::Data name;
+    Expr* first;
+    Expr* second;
+    Pattern* pattern;
+  };
+
+  ::std::vector<Frame> frames_;
+  ::std::vector<::std::vector<AstNode*>> bodies_; // of the open blocks
+  AstNode* value_; // the last node parsed by a frame
 
  public:
   Parser() = delete;
-  static std::vector<std::unique_ptr<AstNode>> Parse(
-      absl::string_view source, ErrorReporter& reporter, Interner& interner);
+  static AstTree Parse(
+      absl::string_view source, ErrorReporter& reporter,
+      Interner& interner, ConstantPool& constants);
+  // tokens must have been produced by Lexer::Lex
+  static AstTree Parse(
+      const TokenBuffer& tokens, ErrorReporter& reporter,
+      Interner& interner, ConstantPool& constants);
+  // splits the tokens into slices of top level statements and parses them
+  // on the given number of threads. The result is the same as Parse() gives:
+  // if a slice has an error, the tokens are parsed again by one thread
+  static AstTree ParseParallel(
+      const TokenBuffer& tokens, ErrorReporter& reporter,
+      Interner& interner, ConstantPool& constants,
+      size_t slices, size_t threads);
+  // the bodies of blocks are skipped and parsed when they are first
+  // accessed, errors in them are reported then. The tokens, reporter,
+  // interner and constants must outlive the tree
+  static AstTree ParseLazy(
+      const TokenBuffer& tokens, ErrorReporter& reporter,
+      Interner& interner, ConstantPool& constants);
+  // lexemes in the ast are kept by the stream which must outlive it
+  static AstTree Parse(
+      StreamLexer& stream, ErrorReporter& reporter,
+      Interner& interner, ConstantPool& constants);
+  // no nodes are built, the constructs are reported to events as their
+  // parsing completes. Syntax errors are reported as Parse() does
+  static void Parse(
+      const TokenBuffer& tokens, ErrorReporter& reporter,
+      Interner& interner, ConstantPool& constants, ParseEvents& events);
 
  private:
-  enum class Precedence;
   struct Rule;
   static const Rule rules_[];
 
-  explicit Parser(absl::string_view source, ErrorReporter& reporter, Interner& interner);
+  Parser(const TokenBuffer& tokens, StreamLexer* stream,
+      ErrorReporter& reporter, Interner& interner, ConstantPool& constants,
+      AstArena& arena);
 
-  void SkipSpace();
-  void MakeToken(TokenType type);
-  char AdvanceChar();
-  void ParseComment();
-  void ParseString();
-  void ParseChar();
-  bool IsValidSymbol();
-  bool IsEscape();
-  void ParseNumber();
-  void ParseIdentifier();
+  static AstTree ParseSequential(
+      const TokenBuffer& tokens, ErrorReporter& reporter,
+      Interner& interner, ConstantPool& constants);
 
-  bool IsAtEnd() { return curr_char_ == size_; }
-  char PeekChar() { return source_[curr_char_]; }
-  char PeekNextChar() { return IsAtEnd() ? '\0' : source_[curr_char_ + 1]; }
+  std::vector<AstNode*> Program();
+  // parses statements starting in [begin, end), stop is set to where
+  // the first statement that isn't parsed starts
+  std::vector<AstNode*> Slice(size_t begin, size_t end, size_t* stop);
+  // index of curr_token_ in tokens_, only without a stream
+  size_t CurrIndex() const;
+  // index of the } closing the block whose body starts at begin,
+  // the number of tokens if there is none
+  size_t MatchBrace(size_t begin) const;
 
   Token& NextToken();
   bool MatchToken(TokenType type, bool ignore_eol);
   bool ConsumeToken(TokenType type, bool ignore_eol, absl::string_view msg);
   void SkipEolTokens();
 
-  std::unique_ptr<AstNode> Statement();
-  std::unique_ptr<AstNode> Variable();
-
-  std::unique_ptr<Expr> Expression(Precedence precedence);
-  std::unique_ptr<Expr> Binary(std::unique_ptr<Expr> left);
-  std::unique_ptr<Expr> Unary(bool can_assign);
-  std::unique_ptr<Expr> Literal(bool can_assign);
-  std::unique_ptr<Expr> Identifier(bool can_assign);
-  std::unique_ptr<Expr> While(bool can_assign);
-  std::unique_ptr<Expr> If(bool can_assign);
-  std::unique_ptr<Expr> Grouping(bool can_assign);
-  std::unique_ptr<Expr> Block(bool can_assign);
+  AstNode* Statement();
+
+  AstNode* Run(Frame frame);
+  void Resume(size_t top);
+  void Push(Frame::Kind kind, uint8_t state);
+  void PushExpression(Precedence precedence);
+  // clears the panic mode first
+  void PushOperand(Precedence precedence, bool skip_eol);
+  void Finish(AstNode* node);
+
+  // The operand of an operator is usually a literal or an identifier.
+  // It's parsed right away and is kWhole if nothing binds tighter to it,
+  // otherwise the operand is continued by a frame
+  enum class Leaf : uint8_t {
+    kNone,
+    kPartial,
+    kWhole,
+  };
+
+  Leaf ParseLeaf(Precedence precedence);
+  void PushOperand(Precedence precedence, Leaf leaf);
+
+  void Variable(size_t top);
+  void Binary(Expr* left);
+  void Unary(bool can_assign);
+  void Literal(bool can_assign);
+  void Identifier(bool can_assign);
+  void While(bool can_assign);
+  void WhileBody(size_t top);
+  void If(bool can_assign);
+  void IfBranch(size_t top);
+  void Grouping(bool can_assign);
+  void Block(bool can_assign);
+  void BlockStatement();
 
   template <typename T, typename F>
-  std::vector<std::unique_ptr<T>> Sequence(TokenType separator, TokenType closing, F parser);
+  std::vector<T*> Sequence(TokenType separator, TokenType closing, F parser);
+
+  Pattern* ParsePattern(bool ignore_eol);
+  Type* ParseType(bool ignore_eol);
 
-  std::unique_ptr<Pattern> ParsePattern(bool ignore_eol);
-  std::unique_ptr<Type> ParseType(bool ignore_eol);
+  Interner::Data InternName(const Token& token);
 
   // TODO: make better error reporting
-  void LexError(absl::string_view msg, int line, int col);
   void ParserError(absl::string_view msg, const Token& token);
 };
 
@@ -0,0 +1,455 @@
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include "scan.hpp"
+#include "unicode.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HELIUM_SCAN_X86
+#include <immintrin.h>
+#endif
+
+namespace helium {
+namespace scan {
+namespace {
+
+size_t ScalarBlanks(const char* data, size_t pos, size_t size) {
+  while (pos < size && IsBlank(data[pos])) pos++;
+  return pos;
+}
+
+size_t ScalarIdentifier(const char* data, size_t pos, size_t size) {
+  while (pos < size && IsAlNum(data[pos])) pos++;
+  return pos;
+}
+
+size_t ScalarDigits(const char* data, size_t pos, size_t size) {
+  while (pos < size && IsDigit(data[pos])) pos++;
+  return pos;
+}
+
+size_t ScalarLine(const char* data, size_t pos, size_t size) {
+  while (pos < size && data[pos] != '\n') pos++;
+  return pos;
+}
+
+size_t ScalarString(const char* data, size_t pos, size_t size) {
+  while (pos < size && data[pos] != '"' && data[pos] != '\\') pos++;
+  return pos;
+}
+
+size_t ScalarUtf8(const char* data, size_t pos, size_t size) {
+  while (pos < size) {
+    // eight ascii bytes at a time
+    uint64_t word;
+    if (pos + 8 <= size) {
+      ::std::memcpy(&word, data + pos, 8);
+      if ((word & 0x8080808080808080u) == 0) {
+        pos += 8;
+        continue;
+      }
+    }
+
+    uint32_t code_point;
+    int length = unicode::Decode(data, pos, size, &code_point);
+    if (length <= 0) break;
+    pos += static_cast<size_t>(length);
+  }
+
+  return pos;
+}
+
+// start of the last character that begins before pos, given that
+// data[begin, pos) has no errors besides a character cut at pos
+size_t LastBoundary(const char* data, size_t begin, size_t pos) {
+  for (size_t back = 1; back <= 3 && pos - begin >= back; back++) {
+    auto c = static_cast<unsigned char>(data[pos - back]);
+    if (c < 0x80) break;
+    if (!unicode::IsContinuation(c)) return pos - back;
+  }
+
+  return pos;
+}
+
+#ifdef HELIUM_SCAN_X86
+
+// SSE2 is part of x86-64, no runtime check needed for it
+
+inline __m128i Load16(const char* data) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+}
+
+inline uint32_t Mask16(__m128i v) {
+  return static_cast<uint32_t>(_mm_movemask_epi8(v));
+}
+
+inline __m128i Eq16(__m128i v, char c) {
+  return _mm_cmpeq_epi8(v, _mm_set1_epi8(c));
+}
+
+// bytes >= 0x80 are negative and never fall in an ascii range
+inline __m128i InRange16(__m128i v, char lo, char hi) {
+  return _mm_and_si128(
+      _mm_cmpgt_epi8(v, _mm_set1_epi8(static_cast<char>(lo - 1))),
+      _mm_cmplt_epi8(v, _mm_set1_epi8(static_cast<char>(hi + 1))));
+}
+
+size_t Sse2Blanks(const char* data, size_t pos, size_t size) {
+  for (; pos + 16 <= size; pos += 16) {
+    __m128i v = Load16(data + pos);
+    __m128i blank = _mm_or_si128(
+        _mm_or_si128(Eq16(v, ' '), Eq16(v, '\t')), Eq16(v, '\r'));
+    uint32_t stop = ~Mask16(blank) & 0xFFFFu;
+    if (stop) return pos + __builtin_ctz(stop);
+  }
+
+  return ScalarBlanks(data, pos, size);
+}
+
+size_t Sse2Identifier(const char* data, size_t pos, size_t size) {
+  for (; pos + 16 <= size; pos += 16) {
+    __m128i v = Load16(data + pos);
+    __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    __m128i alnum = _mm_or_si128(
+        _mm_or_si128(InRange16(lower, 'a', 'z'), InRange16(v, '0', '9')),
+        Eq16(v, '_'));
+    uint32_t stop = ~Mask16(alnum) & 0xFFFFu;
+    if (stop) return pos + __builtin_ctz(stop);
+  }
+
+  return ScalarIdentifier(data, pos, size);
+}
+
+size_t Sse2Digits(const char* data, size_t pos, size_t size) {
+  for (; pos + 16 <= size; pos += 16) {
+    uint32_t stop = ~Mask16(InRange16(Load16(data + pos), '0', '9')) & 0xFFFFu;
+    if (stop) return pos + __builtin_ctz(stop);
+  }
+
+  return ScalarDigits(data, pos, size);
+}
+
+size_t Sse2Line(const char* data, size_t pos, size_t size) {
+  for (; pos + 16 <= size; pos += 16) {
+    uint32_t stop = Mask16(Eq16(Load16(data + pos), '\n'));
+    if (stop) return pos + __builtin_ctz(stop);
+  }
+
+  return ScalarLine(data, pos, size);
+}
+
+size_t Sse2String(const char* data, size_t pos, size_t size) {
+  for (; pos + 16 <= size; pos += 16) {
+    __m128i v = Load16(data + pos);
+    uint32_t stop = Mask16(_mm_or_si128(Eq16(v, '"'), Eq16(v, '\\')));
+    if (stop) return pos + __builtin_ctz(stop);
+  }
+
+  return ScalarString(data, pos, size);
+}
+
+size_t Sse2Utf8(const char* data, size_t pos, size_t size) {
+  while (pos + 16 <= size) {
+    if (Mask16(Load16(data + pos)) == 0) {
+      pos += 16;
+      continue;
+    }
+
+    // characters that start in the block, the last one may end past it
+    const size_t end = pos + 16;
+    while (pos < end) {
+      uint32_t code_point;
+      int length = unicode::Decode(data, pos, size, &code_point);
+      if (length <= 0) return pos;
+      pos += static_cast<size_t>(length);
+    }
+  }
+
+  return ScalarUtf8(data, pos, size);
+}
+
+#define HELIUM_AVX2 __attribute__((target("avx2")))
+
+HELIUM_AVX2 inline __m256i Load32(const char* data) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+}
+
+HELIUM_AVX2 inline uint32_t Mask32(__m256i v) {
+  return static_cast<uint32_t>(_mm256_movemask_epi8(v));
+}
+
+HELIUM_AVX2 inline __m256i Eq32(__m256i v, char c) {
+  return _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c));
+}
+
+HELIUM_AVX2 inline __m256i InRange32(__m256i v, char lo, char hi) {
+  return _mm256_and_si256(
+      _mm256_cmpgt_epi8(v, _mm256_set1_epi8(static_cast<char>(lo - 1))),
+      _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(hi + 1)), v));
+}
+
+HELIUM_AVX2 size_t Avx2Blanks(const char* data, size_t pos, size_t size) {
+  for (; pos + 32 <= size; pos += 32) {
+    __m256i v = Load32(data + pos);
+    __m256i blank = _mm256_or_si256(
+        _mm256_or_si256(Eq32(v, ' '), Eq32(v, '\t')), Eq32(v, '\r'));
+    uint32_t stop = ~Mask32(blank);
+    if (stop) return pos + __builtin_ctz(stop);
+  }
+
+  return Sse2Blanks(data, pos, size);
+}
+
+HELIUM_AVX2 size_t Avx2Identifier(const char* data, size_t pos, size_t size) {
+  for (; pos + 32 <= size; pos += 32) {
+    __m256i v = Load32(data + pos);
+    __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    __m256i alnum = _mm256_or_si256(
+        _mm256_or_si256(InRange32(lower, 'a', 'z'), InRange32(v, '0', '9')),
+        Eq32(v, '_'));
+    uint32_t stop = ~Mask32(alnum);
+    if (stop) return pos + __builtin_ctz(stop);
+  }
+
+  return Sse2Identifier(data, pos, size);
+}
+
+HELIUM_AVX2 size_t Avx2Digits(const char* data, size_t pos, size_t size) {
+  for (; pos + 32 <= size; pos += 32) {
+    uint32_t stop = ~Mask32(InRange32(Load32(data + pos), '0', '9'));
+    if (stop) return pos + __builtin_ctz(stop);
+  }
+
+  return Sse2Digits(data, pos, size);
+}
+
+HELIUM_AVX2 size_t Avx2Line(const char* data, size_t pos, size_t size) {
+  for (; pos + 32 <= size; pos += 32) {
+    uint32_t stop = Mask32(Eq32(Load32(data + pos), '\n'));
+    if (stop) return pos + __builtin_ctz(stop);
+  }
+
+  return Sse2Line(data, pos, size);
+}
+
+HELIUM_AVX2 size_t Avx2String(const char* data, size_t pos, size_t size) {
+  for (; pos + 32 <= size; pos += 32) {
+    __m256i v = Load32(data + pos);
+    uint32_t stop = Mask32(_mm256_or_si256(Eq32(v, '"'), Eq32(v, '\\')));
+    if (stop) return pos + __builtin_ctz(stop);
+  }
+
+  return Sse2String(data, pos, size);
+}
+
+// Validation of 32 bytes at a time with byte lookups, as described in
+// "Validating UTF-8 in less than one instruction per byte" by
+// Keiser and Lemire. The error bits of a byte pair come from its first
+// byte's nibbles and the second byte's high nibble
+enum Utf8Error : uint8_t {
+  kTooShort = 1 << 0,     // lead followed by a lead or ascii
+  kTooLong = 1 << 1,      // ascii followed by a continuation
+  kOverlong3 = 1 << 2,    // 11100000 100_____
+  kTooLarge = 1 << 3,     // 11110100 1001____ and above
+  kSurrogate = 1 << 4,    // 11101101 101_____
+  kOverlong2 = 1 << 5,    // 1100000_ 10______
+  kTooLarge1000 = 1 << 6, // 11110101 1000____ and above
+  kOverlong4 = 1 << 6,    // 11110000 1000____
+  kTwoConts = 1 << 7,     // continuation after a continuation
+  kCarry = kTooShort | kTooLong | kTwoConts
+};
+
+HELIUM_AVX2 inline __m256i Lookup32(__m256i nibbles, const uint8_t (&table)[16]) {
+  __m128i lane = _mm_loadu_si128(reinterpret_cast<const __m128i*>(table));
+  return _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(lane), nibbles);
+}
+
+HELIUM_AVX2 inline __m256i HighNibbles32(__m256i v) {
+  return _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0F));
+}
+
+// v shifted by n bytes with the last bytes of prev shifted in
+template <int N>
+HELIUM_AVX2 inline __m256i Prev32(__m256i v, __m256i prev) {
+  return _mm256_alignr_epi8(v, _mm256_permute2x128_si256(prev, v, 0x21), 16 - N);
+}
+
+HELIUM_AVX2 inline __m256i Utf8Errors32(__m256i v, __m256i prev) {
+  static const uint8_t kByte1High[16] = {
+      // 0_______ ascii
+      kTooLong, kTooLong, kTooLong, kTooLong,
+      kTooLong, kTooLong, kTooLong, kTooLong,
+      // 10______ continuation
+      kTwoConts, kTwoConts, kTwoConts, kTwoConts,
+      // 1100____, 1101____ two byte lead
+      kTooShort | kOverlong2,
+      kTooShort,
+      // 1110____ three byte lead
+      kTooShort | kOverlong3 | kSurrogate,
+      // 1111____ four byte lead
+      kTooShort | kTooLarge | kTooLarge1000 | kOverlong4
+  };
+  static const uint8_t kByte1Low[16] = {
+      kCarry | kOverlong3 | kOverlong2 | kOverlong4, // ____0000
+      kCarry | kOverlong2,                           // ____0001
+      kCarry,
+      kCarry,
+      kCarry | kTooLarge,                            // ____0100
+      kCarry | kTooLarge | kTooLarge1000,
+      kCarry | kTooLarge | kTooLarge1000,
+      kCarry | kTooLarge | kTooLarge1000,
+      kCarry | kTooLarge | kTooLarge1000,
+      kCarry | kTooLarge | kTooLarge1000,
+      kCarry | kTooLarge | kTooLarge1000,
+      kCarry | kTooLarge | kTooLarge1000,
+      kCarry | kTooLarge | kTooLarge1000,
+      kCarry | kTooLarge | kTooLarge1000 | kSurrogate, // ____1101
+      kCarry | kTooLarge | kTooLarge1000,
+      kCarry | kTooLarge | kTooLarge1000
+  };
+  static const uint8_t kByte2High[16] = {
+      // ________ 0_______ ascii
+      kTooShort, kTooShort, kTooShort, kTooShort,
+      kTooShort, kTooShort, kTooShort, kTooShort,
+      // ________ 1000____
+      kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge1000 | kOverlong4,
+      // ________ 1001____
+      kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge,
+      // ________ 101_____
+      kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+      kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+      // ________ 11______ lead
+      kTooShort, kTooShort, kTooShort, kTooShort
+  };
+
+  __m256i prev1 = Prev32<1>(v, prev);
+  __m256i special = _mm256_and_si256(
+      _mm256_and_si256(
+          Lookup32(HighNibbles32(prev1), kByte1High),
+          Lookup32(_mm256_and_si256(prev1, _mm256_set1_epi8(0x0F)), kByte1Low)),
+      Lookup32(HighNibbles32(v), kByte2High));
+
+  // the third and the fourth bytes must be continuations too
+  __m256i third = _mm256_subs_epu8(Prev32<2>(v, prev), _mm256_set1_epi8(0xE0 - 0x80));
+  __m256i fourth = _mm256_subs_epu8(Prev32<3>(v, prev), _mm256_set1_epi8(0xF0 - 0x80));
+  __m256i must_be_cont = _mm256_and_si256(
+      _mm256_or_si256(third, fourth), _mm256_set1_epi8(static_cast<char>(0x80)));
+
+  return _mm256_xor_si256(must_be_cont, special);
+}
+
+// leads in the last bytes whose characters continue in the next block
+HELIUM_AVX2 inline __m256i Utf8Incomplete32(__m256i v) {
+  const char m = static_cast<char>(0xFF);
+  const __m256i max = _mm256_setr_epi8(
+      m, m, m, m, m, m, m, m, m, m, m, m, m, m, m, m,
+      m, m, m, m, m, m, m, m, m, m, m, m, m,
+      static_cast<char>(0xF0 - 1),
+      static_cast<char>(0xE0 - 1),
+      static_cast<char>(0xC0 - 1));
+  return _mm256_subs_epu8(v, max);
+}
+
+// the blocks are only checked, the position of an error
+// is found by decoding from the last character boundary before it
+HELIUM_AVX2 size_t Avx2Utf8(const char* data, size_t pos, size_t size) {
+  const size_t begin = pos;
+  __m256i prev = _mm256_setzero_si256();
+  __m256i incomplete = _mm256_setzero_si256();
+
+  for (; pos + 32 <= size; pos += 32) {
+    __m256i v = Load32(data + pos);
+    __m256i errors;
+    if (Mask32(v) == 0) {
+      errors = incomplete;
+    } else {
+      // a character cut by the previous block shows up as kTooShort
+      errors = Utf8Errors32(v, prev);
+      incomplete = Utf8Incomplete32(v);
+    }
+
+    if (!_mm256_testz_si256(errors, errors)) break;
+    prev = v;
+  }
+
+  return ScalarUtf8(data, LastBoundary(data, begin, pos), size);
+}
+
+#undef HELIUM_AVX2
+
+#endif // HELIUM_SCAN_X86
+
+const Table kScalar = {
+    ScalarBlanks,
+    ScalarIdentifier,
+    ScalarDigits,
+    ScalarLine,
+    ScalarString,
+    ScalarUtf8
+};
+
+#ifdef HELIUM_SCAN_X86
+const Table kSse2 = {
+    Sse2Blanks,
+    Sse2Identifier,
+    Sse2Digits,
+    Sse2Line,
+    Sse2String,
+    Sse2Utf8
+};
+
+const Table kAvx2 = {
+    Avx2Blanks,
+    Avx2Identifier,
+    Avx2Digits,
+    Avx2Line,
+    Avx2String,
+    Avx2Utf8
+};
+#endif
+
+const Table* selected = nullptr;
+
+}
+
+bool IsSupported(Level level) {
+  switch (level) {
+    case Level::kScalar: return true;
+#ifdef HELIUM_SCAN_X86
+    case Level::kSse2: return true;
+    case Level::kAvx2:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2");
+#endif
+    default: return false;
+  }
+}
+
+Level BestLevel() {
+  static const Level best =
+      IsSupported(Level::kAvx2) ? Level::kAvx2 :
+      IsSupported(Level::kSse2) ? Level::kSse2 : Level::kScalar;
+  return best;
+}
+
+const Table& Get(Level level) {
+  assert(IsSupported(level));
+  switch (level) {
+#ifdef HELIUM_SCAN_X86
+    case Level::kSse2: return kSse2;
+    case Level::kAvx2: return kAvx2;
+#endif
+    default: return kScalar;
+  }
+}
+
+const Table& Active() {
+  return selected ? *selected : Get(BestLevel());
+}
+
+void Select(Level level) {
+  selected = &Get(level);
+}
+
+}
+}
@@ -0,0 +1,62 @@
+#ifndef HELIUM_COMPILER_SRC_PARSER_SCAN_HPP_
+#define HELIUM_COMPILER_SRC_PARSER_SCAN_HPP_
+
+#include <cstddef>
+
+namespace helium {
+namespace scan {
+
+inline bool IsAlpha(char c) {
+  return (c >= 'a' && c <= 'z') ||
+      (c >= 'A' && c <= 'Z') ||
+      c == '_';
+}
+
+inline bool IsDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+inline bool IsAlNum(char c) {
+  return IsDigit(c) || IsAlpha(c);
+}
+
+inline bool IsBlank(char c) {
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+enum class Level {
+  kScalar,
+  kSse2,
+  kAvx2
+};
+
+// Every function scans data[pos, size) and returns the position
+// of the first byte that doesn't belong to the run (size if the run
+// reaches the end of input). All levels produce the same results.
+struct Table {
+  size_t (*blanks)(const char* data, size_t pos, size_t size);     // ' ', \t, \r
+  size_t (*identifier)(const char* data, size_t pos, size_t size); // [_a-zA-Z0-9]
+  size_t (*digits)(const char* data, size_t pos, size_t size);     // [0-9]
+  size_t (*line)(const char* data, size_t pos, size_t size);       // up to \n
+  size_t (*string)(const char* data, size_t pos, size_t size);     // up to " or '\'
+  size_t (*utf8)(const char* data, size_t pos, size_t size);       // valid UTF-8
+};
+
+bool IsSupported(Level level);
+
+// best level the cpu supports, detected once
+Level BestLevel();
+
+// level must be supported
+const Table& Get(Level level);
+
+// table used by newly created parsers, BestLevel() by default
+const Table& Active();
+
+// not thread safe, meant for tests and benchmarks
+void Select(Level level);
+
+}
+}
+
+#endif //HELIUM_COMPILER_SRC_PARSER_SCAN_HPP_
@@ -3,17 +3,69 @@
 //
 
 #include "token.hpp"
-#include "parser.hpp"
 
 namespace helium {
 
-Token Token::ParsedAs(const Parser& parser, TokenType type) {
-  int start = parser.start_;
-  int length = parser.curr_char_ - start;
-  auto lexeme = parser.source_.substr(start, length);
-  int line = parser.line_;
-  int col = parser.col_;
-  return {type, line, col, lexeme};
+// dispatches on length and first char, so at most one comparison
+// is done per identifier. New keywords go to the matching case
+TokenType IdentifierType(absl::string_view lexeme) {
+#define KEYWORD(first, word, type) \
+    case (first): \
+      return lexeme == (word) ? TokenType::type : TokenType::kIdentifier
+
+  switch (lexeme.size()) {
+    case 2:
+      switch (lexeme[0]) {
+        KEYWORD('i', "if", kIf);
+      }
+      break;
+    case 3:
+      switch (lexeme[0]) {
+        KEYWORD('v', "var", kVar);
+      }
+      break;
+    case 4:
+      switch (lexeme[0]) {
+        KEYWORD('e', "else", kElse);
+        KEYWORD('t', "true", kTrue);
+        KEYWORD('u', "unit", kUnit);
+      }
+      break;
+    case 5:
+      switch (lexeme[0]) {
+        KEYWORD('f', "false", kFalse);
+        KEYWORD('w', "while", kWhile);
+      }
+      break;
+  }
+
+#undef KEYWORD
+
+  return TokenType::kIdentifier;
+}
+
+absl::string_view Spelling(TokenType type) {
+  switch (type) {
+    case TokenType::kEol:        return "\n";
+    case TokenType::kTrue:       return "true";
+    case TokenType::kFalse:      return "false";
+    case TokenType::kUnit:       return "unit";
+    case TokenType::kVar:        return "var";
+    case TokenType::kWhile:      return "while";
+    case TokenType::kIf:         return "if";
+    case TokenType::kElse:       return "else";
+    case TokenType::kPlus:       return "+";
+    case TokenType::kMinus:      return "-";
+    case TokenType::kStar:       return "*";
+    case TokenType::kSlash:      return "/";
+    case TokenType::kLeftParen:  return "(";
+    case TokenType::kRightParen: return ")";
+    case TokenType::kLeftBrace:  return "{";
+    case TokenType::kRightBrace: return "}";
+    case TokenType::kEqual:      return "=";
+    case TokenType::kColon:      return ":";
+    default:                     return {};
+  }
 }
 
 }
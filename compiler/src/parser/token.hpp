@@ -5,11 +5,12 @@
 #ifndef HELIUM_COMPILER_SRC_TOKEN_HPP_
 #define HELIUM_COMPILER_SRC_TOKEN_HPP_
 
+#include <cstdint>
 #include "absl/strings/string_view.h"
 
 namespace helium {
 
-enum class TokenType {
+enum class TokenType : uint8_t {
   kEof,
   kEol,
   kError,
@@ -40,18 +41,29 @@ enum class TokenType {
   kColon
 };
 
-class Parser;
+// position of a lexeme in the source, line and column are
+// computed only when needed (see LineTable)
+struct Span final {
+  uint32_t offset;
+  uint32_t length;
+};
 
 struct Token final {
   TokenType type;
-  int line;
-  int col;
+  Span span;
   absl::string_view lexeme;
+  uint32_t hash; // Interner::Hash() of kIdentifier lexemes, 0 otherwise
 
   Token() = delete;
-  static Token ParsedAs(const Parser& parser, TokenType type);
 };
 
+// keyword type of the lexeme or kIdentifier if it isn't a keyword
+TokenType IdentifierType(absl::string_view lexeme);
+
+// lexeme of a keyword, an operator or a punctuation token,
+// empty for the tokens that don't have a fixed one
+absl::string_view Spelling(TokenType type);
+
 }
 
 #endif //HELIUM_COMPILER_SRC_TOKEN_HPP_
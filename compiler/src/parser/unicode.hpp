@@ -0,0 +1,80 @@
+#ifndef HELIUM_COMPILER_SRC_PARSER_UNICODE_HPP_
+#define HELIUM_COMPILER_SRC_PARSER_UNICODE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace helium {
+namespace unicode {
+
+// results of Decode() besides the size of a character
+constexpr int kInvalid = 0;
+constexpr int kTruncated = -1; // valid so far but cut by the end of data
+
+inline bool IsContinuation(unsigned char c) {
+  return (c & 0xC0) == 0x80;
+}
+
+// decodes the UTF-8 character at data[pos], pos < size.
+// Overlong forms, surrogates and code points past U+10FFFF are invalid
+inline int Decode(const char* data, size_t pos, size_t size,
+                  uint32_t* code_point) {
+  const auto* s = reinterpret_cast<const unsigned char*>(data) + pos;
+  const size_t left = size - pos;
+  const unsigned char c = s[0];
+
+  int length;
+  unsigned char lo = 0x80, hi = 0xBF; // range of the second byte
+  if (c < 0x80) {
+    *code_point = c;
+    return 1;
+  } else if (c >= 0xC2 && c <= 0xDF) {
+    length = 2;
+    *code_point = c & 0x1Fu;
+  } else if (c >= 0xE0 && c <= 0xEF) {
+    length = 3;
+    *code_point = c & 0x0Fu;
+    if (c == 0xE0) lo = 0xA0;
+    else if (c == 0xED) hi = 0x9F;
+  } else if (c >= 0xF0 && c <= 0xF4) {
+    length = 4;
+    *code_point = c & 0x07u;
+    if (c == 0xF0) lo = 0x90;
+    else if (c == 0xF4) hi = 0x8F;
+  } else {
+    return kInvalid;
+  }
+
+  for (int i = 1; i < length; i++) {
+    if (static_cast<size_t>(i) >= left) return kTruncated;
+    if (i == 1 ? s[i] < lo || s[i] > hi : !IsContinuation(s[i])) {
+      return kInvalid;
+    }
+
+    *code_point = (*code_point << 6) | (s[i] & 0x3Fu);
+  }
+
+  return length;
+}
+
+// size of data without a character cut by its end
+inline size_t CompletePrefix(const char* data, size_t size) {
+  for (size_t back = 1; back <= 3 && back <= size; back++) {
+    const auto c = static_cast<unsigned char>(data[size - back]);
+    if (c < 0x80) break;
+    if (IsContinuation(c)) continue;
+
+    const size_t length = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : 2;
+    return length > back ? size - back : size;
+  }
+
+  return size;
+}
+
+bool IsXidStart(uint32_t code_point);
+bool IsXidContinue(uint32_t code_point);
+
+}
+}
+
+#endif //HELIUM_COMPILER_SRC_PARSER_UNICODE_HPP_
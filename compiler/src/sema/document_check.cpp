@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <cassert>
+#include <utility>
+#include "absl/memory/memory.h"
+#include "document_check.hpp"
+#include "error_reporter.hpp"
+#include "type_check.hpp"
+
+namespace helium {
+namespace {
+
+using ::absl::string_view;
+
+// The names a unit might read from the global scope: all the names in
+// it, the ones bound by its blocks too. A local that shadows a global
+// only makes the unit checked again when the global changes
+class NameScan final : public PatternVisitor {
+  std::vector<Interner::Data>& names_;
+  Interner::Data last_; // of the last visited pattern
+
+ public:
+  explicit NameScan(std::vector<Interner::Data>& names)
+  : names_(names),
+    last_(0)
+  {}
+
+  // the pattern of a root variable is visited last, so its name
+  // is the one the unit declares
+  Interner::Data Scan(AstNode& root) {
+    struct Entry {
+      AstNode* node;
+      size_t next; // child to be scanned next
+    };
+
+    std::vector<Entry> stack;
+    stack.push_back({&root, 0});
+    while (!stack.empty()) {
+      auto& top = stack.back();
+      if (auto* child = ChildAt(*top.node, top.next++)) {
+        stack.push_back({child, 0});
+        continue;
+      }
+
+      auto* node = top.node;
+      stack.pop_back();
+      switch (node->GetKind()) {
+        case AstKind::kVariable:
+          static_cast<VariableStmt*>(node)->GetPattern()->Accept(*this);
+          break;
+        case AstKind::kIdentifier:
+          names_.push_back(static_cast<IdentifierExpr*>(node)->Name());
+          break;
+        case AstKind::kAssign:
+          names_.push_back(static_cast<AssignExpr*>(node)->Name());
+          break;
+        default:
+          break;
+      }
+    }
+
+    return last_;
+  }
+
+  void Visit(TypedPattern& pattern) override {
+    last_ = pattern.GetName();
+    names_.push_back(last_);
+  }
+};
+
+}
+
+void DocumentCheck::Check(Document& document) {
+  assert(!document.HadErrors() && "The document has parse errors");
+
+  // the builtin types are interned with the names of the generation
+  if (!types_ || generation_ != document.Generation()) {
+    checked_.clear();
+    types_ = ::absl::make_unique<TypeContext>(document.GetInterner());
+    generation_ = document.Generation();
+  }
+
+  ErrorReporter reporter(file_name_);
+  TypeCheck check(reporter, *types_);
+  auto& globals = check.symbols_;
+  errors_.clear();
+  rechecked_ = 0;
+
+  size_t unit = 0;
+  document.ForEachUnit([&](const std::vector<AstNode*>& nodes, string_view text,
+                           uint32_t, int line) {
+    const auto inserted = checked_.emplace(document.UnitId(unit++), Checked());
+    auto& checked = inserted.first->second;
+    bool same = !inserted.second;
+    if (!checked.errors.empty() && checked.line != line) same = false;
+    for (size_t i = 0; same && i < checked.reads.size(); i++) {
+      same = globals.Lookup(checked.reads[i].name) == checked.reads[i].binding;
+    }
+
+    if (same) {
+      if (checked.binds) globals.Declare(checked.name, checked.type);
+      errors_ += checked.errors;
+      return;
+    }
+
+    std::vector<Interner::Data> names;
+    Interner::Data declared = 0;
+    for (auto* node : nodes) {
+      declared = NameScan(names).Scan(*node);
+    }
+
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+    checked.reads.clear();
+    for (auto name : names) {
+      checked.reads.push_back({name, globals.Lookup(name)});
+    }
+
+    // a name that is bound already is a redefinition
+    checked.binds = nodes.size() == 1 && nodes[0]->GetKind() == AstKind::kVariable &&
+                    !globals.Lookup(declared);
+    checked.name = declared;
+
+    reporter.SetSource(text);
+    reporter.SetFirstLine(line);
+    const auto begin = reporter.GetErrors().size();
+    for (auto* node : nodes) {
+      node->Accept(check);
+    }
+
+    checked.errors = reporter.GetErrors().substr(begin);
+    checked.line = line;
+    checked.type = checked.binds ? *globals.Lookup(declared) : nullptr;
+    errors_ += checked.errors;
+    rechecked_++;
+  });
+
+  if (checked_.size() > 2 * document.Units()) {
+    Prune(document);
+  }
+}
+
+void DocumentCheck::Prune(const Document& document) {
+  ::absl::flat_hash_map<uint64_t, Checked> live;
+  live.reserve(document.Units());
+  for (size_t unit = 0; unit < document.Units(); unit++) {
+    auto it = checked_.find(document.UnitId(unit));
+    if (it != checked_.end()) live.emplace(it->first, std::move(it->second));
+  }
+
+  checked_.swap(live);
+}
+
+}
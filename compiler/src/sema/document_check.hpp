@@ -0,0 +1,81 @@
+#ifndef HELIUM_COMPILER_SRC_SEMA_DOCUMENT_CHECK_HPP_
+#define HELIUM_COMPILER_SRC_SEMA_DOCUMENT_CHECK_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "parser/document.hpp"
+#include "type_context.hpp"
+
+namespace helium {
+
+// Keeps a Document type checked as it is edited. The check of a unit is
+// memoized: it is a function of the nodes of the unit and of the global
+// bindings it reads, every other binding is out of its reach. A unit
+// records the names it reads with the bindings it saw, which are
+// fingerprinted by the canonical types, and the binding it makes.
+// Checking the document again walks the units in order with the global
+// bindings made so far: a unit whose nodes and reads are the same only
+// makes its binding again, the others are checked. So after an edit
+// only the reparsed units and the ones whose reads changed are walked,
+// and a unit that is checked again to the same type stops it there.
+//
+// Errors are kept formatted. A unit with errors that moved to
+// another line is checked again to get its positions right
+class DocumentCheck final {
+  struct Read {
+    Interner::Data name;
+    ::absl::optional<const Type*> binding; // nullopt if it was unbound
+  };
+
+  struct Checked {
+    std::vector<Read> reads; // of the global scope, before the unit
+    bool binds;              // the global it declares, if any
+    Interner::Data name;
+    const Type* type;
+    std::string errors;
+    int line;                // the errors were reported at
+  };
+
+  ::absl::string_view file_name_;
+  std::unique_ptr<TypeContext> types_; // of the generation of the document
+  uint64_t generation_;
+  ::absl::flat_hash_map<uint64_t, Checked> checked_; // by the id of the unit
+  std::string errors_;
+  size_t rechecked_; // units walked by the last Check()
+
+ public:
+  explicit DocumentCheck(::absl::string_view file_name)
+  : file_name_(file_name),
+    types_(),
+    generation_(0),
+    checked_(),
+    errors_(),
+    rechecked_(0)
+  {}
+
+  DocumentCheck(const DocumentCheck&) = delete;
+  DocumentCheck& operator =(const DocumentCheck&) = delete;
+
+  // The document must have no parse errors. The types of its expressions
+  // are the ones checking its text from scratch gives, they point to the
+  // context of the checker
+  void Check(Document& document);
+
+  bool HadErrors() const { return !errors_.empty(); }
+  const std::string& GetErrors() const { return errors_; }
+  size_t Rechecked() const { return rechecked_; }
+
+ private:
+  // drops the units that are no longer in the document
+  void Prune(const Document& document);
+};
+
+}
+
+#endif //HELIUM_COMPILER_SRC_SEMA_DOCUMENT_CHECK_HPP_
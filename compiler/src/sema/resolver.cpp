@@ -0,0 +1,69 @@
+#include "resolver.hpp"
+
+namespace helium {
+
+void Resolver::Resolve(AstNode& root) {
+  struct Entry {
+    AstNode* node;
+    size_t next; // child to be resolved next
+  };
+
+  std::vector<Entry> stack;
+  auto enter = [&](AstNode* node) {
+    if (node->GetKind() == AstKind::kBlock) names_.Enter();
+    stack.push_back({node, 0});
+  };
+
+  enter(&root);
+  while (!stack.empty()) {
+    auto& top = stack.back();
+    if (auto* child = ChildAt(*top.node, top.next++)) {
+      enter(child);
+      continue;
+    }
+
+    auto* node = top.node;
+    stack.pop_back();
+    Complete(*node);
+  }
+}
+
+// the initializer is resolved, it doesn't see the name
+void Resolver::Visit(TypedPattern& pattern) {
+  if (!names_.Declare(pattern.GetName(), nullptr)) return;
+
+  const auto symbol = next_symbol_++;
+  symbols_.push_back(symbol);
+  pattern.Resolve({symbol, names_.Size() - 1});
+}
+
+Resolution Resolver::Lookup(Interner::Data name) const {
+  const auto slot = names_.SlotOf(name);
+  return slot == SymbolTable::kNone ? kUnresolved : Resolution{symbols_[slot], slot};
+}
+
+void Resolver::Complete(AstNode& node) {
+  switch (node.GetKind()) {
+    case AstKind::kVariable:
+      static_cast<VariableStmt&>(node).GetPattern()->Accept(*this);
+      break;
+    case AstKind::kIdentifier: {
+      auto& expr = static_cast<IdentifierExpr&>(node);
+      expr.Resolve(Lookup(expr.Name()));
+      break;
+    }
+    case AstKind::kAssign: {
+      auto& expr = static_cast<AssignExpr&>(node);
+      expr.Resolve(Lookup(expr.Name()));
+      break;
+    }
+    case AstKind::kBlock:
+      names_.Exit();
+      symbols_.resize(names_.Size());
+      break;
+    default:
+      break;
+  }
+}
+
+}
@@ -0,0 +1,39 @@
+#ifndef HELIUM_COMPILER_SRC_SEMA_RESOLVER_HPP_
+#define HELIUM_COMPILER_SRC_SEMA_RESOLVER_HPP_
+
+#include <cstdint>
+#include <vector>
+#include "parser/ast.hpp"
+#include "symbol_table.hpp"
+
+namespace helium {
+
+// Binds the names of a program to their declarations. A declaration
+// gets the next symbol id and the first free slot of the frame, a block
+// frees the slots of its declarations when it ends. Identifiers and
+// assignments get the resolution of the declaration they refer to,
+// so the code can address locals by slot. Names that aren't declared
+// stay unresolved, the type check reports them.
+//
+// Statements of a program are resolved one after another in the same
+// global scope. The tree is walked with a stack
+class Resolver final : public PatternVisitor {
+  SymbolTable names_;
+  std::vector<uint32_t> symbols_; // of the bound names by slot
+  uint32_t next_symbol_;
+
+ public:
+  Resolver() : names_(), symbols_(), next_symbol_(0) {}
+
+  void Resolve(AstNode& root);
+
+  void Visit(TypedPattern& pattern) override;
+
+ private:
+  Resolution Lookup(Interner::Data name) const;
+  void Complete(AstNode& node);
+};
+
+}
+
+#endif //HELIUM_COMPILER_SRC_SEMA_RESOLVER_HPP_
@@ -0,0 +1,46 @@
+#include <cassert>
+#include "symbol_table.hpp"
+
+namespace helium {
+
+using ::absl::optional;
+using ::absl::make_optional;
+using ::absl::nullopt;
+
+constexpr SymbolTable::Index SymbolTable::kNone;
+
+void SymbolTable::Exit() {
+  assert(!scopes_.empty() && "No scope to exit");
+  const auto mark = scopes_.back();
+  scopes_.pop_back();
+
+  while (bindings_.size() > mark) {
+    const auto& binding = bindings_.back();
+    innermost_[binding.name] = binding.shadowed;
+    bindings_.pop_back();
+  }
+}
+
+bool SymbolTable::Declare(Interner::Data name, const Type* type) {
+  auto& innermost = innermost_.emplace(name, kNone).first->second;
+  if (innermost != kNone && bindings_[innermost].scope == Depth()) {
+    return false;
+  }
+
+  bindings_.push_back({name, type, innermost, Depth()});
+  innermost = static_cast<Index>(bindings_.size() - 1);
+  return true;
+}
+
+optional<const Type*> SymbolTable::Lookup(Interner::Data name) const {
+  const auto slot = SlotOf(name);
+  if (slot == kNone) return nullopt;
+  return make_optional(bindings_[slot].type);
+}
+
+SymbolTable::Index SymbolTable::SlotOf(Interner::Data name) const {
+  auto it = innermost_.find(name);
+  return it == innermost_.end() ? kNone : it->second;
+}
+
+}
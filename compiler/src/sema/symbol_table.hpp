@@ -0,0 +1,63 @@
+#ifndef HELIUM_COMPILER_SRC_SEMA_SYMBOL_TABLE_HPP_
+#define HELIUM_COMPILER_SRC_SEMA_SYMBOL_TABLE_HPP_
+
+#include <cstdint>
+#include <vector>
+#include "absl/container/flat_hash_map.h"
+#include "absl/types/optional.h"
+#include "interner.hpp"
+#include "type.hpp"
+
+namespace helium {
+
+// The names of all the open scopes in one table. A name maps to its
+// innermost binding, which links to the one it shadows. The bindings
+// are kept in the order they were made, so they are the undo log of
+// the scopes: leaving a scope pops its bindings and restores what they
+// shadowed. Lookups hash the name once whatever the nesting is, and
+// entering or leaving a scope allocates nothing once the vectors grew
+class SymbolTable final {
+ public:
+  using Index = uint32_t;
+  static constexpr Index kNone = UINT32_MAX;
+
+ private:
+  struct Binding {
+    Interner::Data name;
+    const Type* type;
+    Index shadowed; // binding of the name in an outer scope, or kNone
+    Index scope;
+  };
+
+  // names that were ever bound keep an entry, kNone if unbound now
+  ::absl::flat_hash_map<Interner::Data, Index> innermost_;
+  std::vector<Binding> bindings_;
+  std::vector<Index> scopes_; // size of bindings_ when they were entered
+
+ public:
+  SymbolTable() = default;
+
+  void Enter() { scopes_.push_back(static_cast<Index>(bindings_.size())); }
+  // the global scope is never left
+  void Exit();
+
+  // false if the name is bound in the current scope already
+  bool Declare(Interner::Data name, const Type* type);
+
+  // the type might be null if the declaration was erroneous
+  ::absl::optional<const Type*> Lookup(Interner::Data name) const;
+
+  // The bindings are numbered from the global scope on, so a number is
+  // the slot of a local in a frame that reuses the slots of left scopes.
+  // Returns the number of the binding of the name or kNone
+  Index SlotOf(Interner::Data name) const;
+  // the number the next binding gets
+  Index Size() const { return static_cast<Index>(bindings_.size()); }
+
+ private:
+  Index Depth() const { return static_cast<Index>(scopes_.size()); }
+};
+
+}
+
+#endif //HELIUM_COMPILER_SRC_SEMA_SYMBOL_TABLE_HPP_
@@ -16,8 +16,8 @@ class ErrorType;
 class TypeVisitor {
  public:
   virtual ~TypeVisitor() = default;
-  virtual void Visit(SingleType&) = 0;
-  virtual void Visit(ErrorType&) = 0;
+  virtual void Visit(const SingleType&) = 0;
+  virtual void Visit(const ErrorType&) = 0;
 };
 
 enum class TypeKind {
@@ -27,17 +27,27 @@ enum class TypeKind {
 
 // TODO: make representation more efficient
 class Type {
+  const TypeKind kind_;
+
+ protected:
+  explicit Type(TypeKind kind)
+  : kind_(kind)
+  {}
+
  public:
-  virtual TypeKind GetKind() const = 0;
   virtual ~Type() = default;
-  virtual bool Match(const Type* other) const = 0;
 
-  virtual bool Match(const ::std::unique_ptr<Type>& other) const final {
+  TypeKind GetKind() const { return kind_; }
+
+  // switch on the kind, not virtual. Types of a TypeContext
+  // are compared by their pointers instead
+  bool Match(const Type* other) const;
+
+  bool Match(const ::std::unique_ptr<Type>& other) const {
     return Match(other.get());
   }
 
-  virtual ::std::unique_ptr<Type> Copy() const = 0;
-  virtual void Accept(TypeVisitor& visitor) = 0;
+  virtual void Accept(TypeVisitor& visitor) const = 0;
 };
 
 template <typename T>
@@ -57,53 +67,32 @@ class SingleType final : public Type {
  public:
   SingleType() = delete;
   explicit SingleType(Interner::Data type_data)
-  : type_data_(type_data)
+  : Type(TypeKind::kSingle),
+    type_data_(type_data)
   {}
 
   Interner::Data GetTypeData() const { return type_data_; }
 
-  TypeKind GetKind() const override { return TypeKind::kSingle; }
-
   static bool ClassOf(const Type* type) {
     return type->GetKind() == TypeKind::kSingle;
   }
 
-  bool Match(const Type* other) const override {
-    if (const auto* type = Cast<SingleType>(other)) {
-      return type->GetTypeData() == this->GetTypeData();
-    }
-
-    return false;
-  }
-
-  ::std::unique_ptr<Type> Copy() const override {
-    return ::absl::make_unique<SingleType>(type_data_);
-  }
-
-  void Accept(TypeVisitor& visitor) override {
+  void Accept(TypeVisitor& visitor) const override {
     visitor.Visit(*this);
   }
 };
 
 class ErrorType final : public Type {
  public:
+  ErrorType()
+  : Type(TypeKind::kError)
+  {}
+
   static bool ClassOf(const Type* type) {
     return type->GetKind() == TypeKind::kError;
   }
 
-  TypeKind GetKind() const override {
-    return TypeKind::kError;
-  }
-
-  bool Match(const Type* other) const override {
-    return Is<ErrorType>(other);
-  }
-
-  ::std::unique_ptr<Type> Copy() const override {
-    return ::absl::make_unique<ErrorType>();
-  }
-
-  void Accept(TypeVisitor& visitor) override {
+  void Accept(TypeVisitor& visitor) const override {
     visitor.Visit(*this);
   }
 };
@@ -128,6 +117,19 @@ inline const T* Cast(const Type* type) {
   return Is<T>(type) ? static_cast<const T*>(type) : nullptr;
 }
 
+inline bool Type::Match(const Type* other) const {
+  switch (kind_) {
+    case TypeKind::kSingle: {
+      const auto* type = Cast<SingleType>(other);
+      return type && type->GetTypeData() == static_cast<const SingleType*>(this)->GetTypeData();
+    }
+    case TypeKind::kError:
+      return Is<ErrorType>(other);
+  }
+
+  return false;
+}
+
 }
 
 #endif //HELIUM_COMPILER_SRC_TYPE_HPP_
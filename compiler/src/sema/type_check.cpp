@@ -2,46 +2,232 @@
 // Created by vasniktel on 08.09.2019.
 //
 
+#include <algorithm>
+#include <deque>
+#include <numeric>
+#include <thread>
+#include <absl/container/flat_hash_map.h>
+#include <absl/container/flat_hash_set.h>
 #include <absl/strings/string_view.h>
-#include "absl/memory/memory.h"
+#include "parallel.hpp"
 #include "type_check.hpp"
 #include "type.hpp"
 
 namespace helium {
 
 using ::absl::string_view;
-using ::absl::make_unique;
-using ::std::unique_ptr;
-using ::absl::optional;
-using ::absl::make_optional;
-using ::absl::nullopt;
-
-void TypeCheck::Visit(UnaryExpr& expr) {
-  const auto& operand = expr.Operand();
-  operand->Accept(*this);
-
-  const auto& type = operand->GetType();
-  if (!Is<ErrorType>(type) &&
-      !type->Match(kInt.get()) &&
-      !type->Match(kReal.get())) {
-    reporter_.ErrorAt("Operand type must be Int or Real", expr.Op());
+
+namespace {
+
+// diagnostics point at the operator
+Token OpToken(TokenType op, Span span) {
+  return {op, span, Spelling(op), 0};
+}
+
+// the name a top level statement declares
+struct GlobalName final : public PatternVisitor {
+  Interner::Data name = 0;
+
+  void Visit(TypedPattern& pattern) override { name = pattern.GetName(); }
+};
+
+// Finds the global names a top level statement uses and the names of
+// the types it declares, without checking it. A local that shadows
+// a global name is taken for it, which only joins more statements
+class UnitScan final : public PatternVisitor {
+  const ::absl::flat_hash_set<Interner::Data>& globals_;
+  std::vector<Interner::Data>& names_;
+  std::vector<Interner::Data>& types_;
+
+ public:
+  UnitScan(const ::absl::flat_hash_set<Interner::Data>& globals,
+           std::vector<Interner::Data>& names, std::vector<Interner::Data>& types)
+  : globals_(globals),
+    names_(names),
+    types_(types)
+  {}
+
+  void Scan(AstNode& root) {
+    struct Entry {
+      AstNode* node;
+      size_t next; // child to be scanned next
+    };
+
+    std::vector<Entry> stack;
+    stack.push_back({&root, 0});
+    while (!stack.empty()) {
+      auto& top = stack.back();
+      if (auto* child = ChildAt(*top.node, top.next++)) {
+        stack.push_back({child, 0});
+        continue;
+      }
+
+      auto* node = top.node;
+      stack.pop_back();
+      switch (node->GetKind()) {
+        case AstKind::kVariable:
+          static_cast<VariableStmt*>(node)->GetPattern()->Accept(*this);
+          break;
+        case AstKind::kIdentifier:
+          Use(static_cast<IdentifierExpr*>(node)->Name());
+          break;
+        case AstKind::kAssign:
+          Use(static_cast<AssignExpr*>(node)->Name());
+          break;
+        default:
+          break;
+      }
+    }
+  }
+
+  void Visit(TypedPattern& pattern) override {
+    if (const auto* decl = Cast<SingleType>(pattern.GetType())) {
+      types_.push_back(decl->GetTypeData());
+    }
+  }
+
+ private:
+  void Use(Interner::Data name) {
+    if (globals_.find(name) != globals_.end()) names_.push_back(name);
+  }
+};
+
+}
+
+constexpr size_t TypeCheck::kParallelStatements;
+constexpr size_t TypeCheck::kParallelThreads;
+
+void TypeCheck::Check(const AstTree& ast, ErrorReporter& reporter, TypeContext& context) {
+  const size_t threads = std::thread::hardware_concurrency();
+  if (ast.size() >= kParallelStatements && threads >= kParallelThreads && !ast.IsLazy()) {
+    CheckParallel(ast, reporter, context, threads);
+    return;
+  }
+
+  TypeCheck check(reporter, context);
+  for (auto* node : ast) {
+    node->Accept(check);
+  }
+}
+
+void TypeCheck::CheckParallel(const AstTree& ast, ErrorReporter& reporter,
+                              TypeContext& context, size_t threads) {
+  assert(!ast.IsLazy() && "Lazy bodies can't be parsed by several threads");
+  struct Statement {
+    std::vector<Interner::Data> names; // global ones it declares or uses
+    std::vector<Interner::Data> types; // it declares
+    size_t unit;
+    size_t errors_end; // in the buffer of the unit
+  };
+
+  const size_t size = ast.size();
+  std::vector<Statement> statements(size);
+  ::absl::flat_hash_set<Interner::Data> globals;
+  for (size_t i = 0; i < size; i++) {
+    if (ast[i]->GetKind() == AstKind::kVariable) {
+      GlobalName global;
+      static_cast<VariableStmt*>(ast[i])->GetPattern()->Accept(global);
+      statements[i].names.push_back(global.name);
+      globals.insert(global.name);
+    }
+  }
+
+  RunParallel(size, threads, [&](size_t i) {
+    UnitScan(globals, statements[i].names, statements[i].types).Scan(*ast[i]);
+  });
+
+  // the statements sharing a name are joined, a name is
+  // represented by the first statement it is in
+  std::vector<size_t> parent(size);
+  std::iota(parent.begin(), parent.end(), 0);
+  auto find = [&](size_t i) {
+    while (parent[i] != i) i = parent[i] = parent[parent[i]];
+    return i;
+  };
+
+  ::absl::flat_hash_map<Interner::Data, size_t> first;
+  for (size_t i = 0; i < size; i++) {
+    for (auto name : statements[i].names) {
+      const auto root = find(first.emplace(name, i).first->second);
+      parent[find(i)] = root;
+    }
+
+    // the workers only look the declared types up
+    for (auto type : statements[i].types) {
+      context.Single(type);
+    }
+  }
+
+  std::vector<std::vector<size_t>> units; // statements in order
+  std::vector<size_t> unit_of(size, size); // of the root statements
+  for (size_t i = 0; i < size; i++) {
+    auto& unit = unit_of[find(i)];
+    if (unit == size) {
+      unit = units.size();
+      units.emplace_back();
+    }
+
+    units[unit].push_back(i);
+    statements[i].unit = unit;
   }
 
-  expr.SetType(type->Copy());
+  if (units.size() < 2) {
+    TypeCheck check(reporter, context);
+    for (auto* node : ast) {
+      node->Accept(check);
+    }
 
-  SetIntrinsic(expr);
+    return;
+  }
+
+  // the largest units are started first
+  std::vector<size_t> order(units.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return units[a].size() > units[b].size();
+  });
+
+  std::deque<ErrorReporter> buffers;
+  for (size_t i = 0; i < units.size(); i++) {
+    buffers.emplace_back(reporter.FileName());
+    buffers.back().ShareSource(reporter);
+  }
+
+  RunParallel(units.size(), threads, [&](size_t i) {
+    const auto unit = order[i];
+    TypeCheck check(buffers[unit], context);
+    for (auto statement : units[unit]) {
+      ast[statement]->Accept(check);
+      statements[statement].errors_end = buffers[unit].GetErrors().size();
+    }
+  });
+
+  std::vector<size_t> merged(units.size(), 0); // of the buffers
+  for (const auto& statement : statements) {
+    auto& begin = merged[statement.unit];
+    const string_view errors = buffers[statement.unit].GetErrors();
+    reporter.Append(errors.substr(begin, statement.errors_end - begin));
+    begin = statement.errors_end;
+  }
+}
+
+Token TypeCheck::NameToken(Interner::Data name, Span span) const {
+  return {TokenType::kIdentifier, span, *interner_.LookUp(name), 0};
+}
+
+const Type* TypeCheck::UnaryRule(TokenType op, Span span, const Type* operand) {
+  if (!Is<ErrorType>(operand) && operand != kInt && operand != kReal) {
+    reporter_.ErrorAt("Operand type must be Int or Real", OpToken(op, span));
+  }
+
+  return operand;
 }
 
 // TODO: revisit later when operator execution is determined by traits
-void TypeCheck::Visit(BinaryExpr& expr) {
-  const auto& left = expr.Left();
-  const auto& right = expr.Right();
-  left->Accept(*this);
-  right->Accept(*this);
-
-  const auto& ltype = left->GetType();
-  const auto& rtype = right->GetType();
-  switch (expr.Op().type) {
+const Type* TypeCheck::BinaryRule(TokenType op, Span span,
+                                  const Type* ltype, const Type* rtype) {
+  const auto token = OpToken(op, span);
+  switch (op) {
     case TokenType::kPlus:
     case TokenType::kMinus:
     case TokenType::kStar:
@@ -49,257 +235,406 @@ void TypeCheck::Visit(BinaryExpr& expr) {
       // if any of the operands' types is an error -
       // bail out without checking the other one
       if (Is<ErrorType>(ltype) || Is<ErrorType>(rtype)) {
-        expr.SetType(make_unique<ErrorType>());
-        return;
+        return kError;
       }
 
       bool error = false;
       if (!Is<SingleType>(ltype) || !Is<SingleType>(rtype)) {
-        reporter_.ErrorAt("Wrong operand types for binary expr", expr.Op());
+        reporter_.ErrorAt("Wrong operand types for binary expr", token);
         error = true;
       }
 
-      if (!error && !ltype->Match(rtype)) {
-        reporter_.ErrorAt("Operands must have the same type", expr.Op());
+      if (!error && ltype != rtype) {
+        reporter_.ErrorAt("Operands must have the same type", token);
         error = true;
       }
 
-      if (!error && !ltype->Match(kInt.get()) && !ltype->Match(kReal.get())) {
-        reporter_.ErrorAt("Operands must be either ints or reals", expr.Op());
+      if (!error && ltype != kInt && ltype != kReal) {
+        reporter_.ErrorAt("Operands must be either ints or reals", token);
         error = true;
       }
 
-      if (error) expr.SetType(make_unique<ErrorType>());
-      else expr.SetType(ltype->Copy());
-
-      SetIntrinsic(expr);
-      return;
+      return error ? kError : ltype;
     }
 
-    default: assert(false && "Token is not a binary op");
+    default:
+      assert(false && "Token is not a binary op");
+      return kError;
   }
 }
 
 // TODO: find a better way to deal with intrinsics
-void TypeCheck::SetIntrinsic(BinaryExpr& expr) const {
-#define CHECK_TYPE(if_int, if_real) \
-    do { \
-      if (expr.GetType()->Match(kInt.get())) { \
-        expr.SetIntrinsic(if_int); \
-      } else if (expr.GetType()->Match(kReal.get())) { \
-        expr.SetIntrinsic(if_real); \
-      } \
-    } while (false)
-
-  switch (expr.Op().type) {
+IntrinsicOp TypeCheck::Intrinsic(TokenType op, const Type* type, bool unary) const {
+  const bool is_int = type == kInt;
+  const bool is_real = type == kReal;
+  if (!is_int && !is_real) return IntrinsicOp::kNone;
+
+  if (unary) {
+    switch (op) {
+      case TokenType::kMinus:
+        return is_int ? IntrinsicOp::kIntNeg : IntrinsicOp::kRealNeg;
+      case TokenType::kPlus:
+        return IntrinsicOp::kNone;
+      default:
+        assert(false && "Not an unary op");
+        return IntrinsicOp::kNone;
+    }
+  }
+
+  switch (op) {
     case TokenType::kPlus:
-      CHECK_TYPE(IntrinsicOp::kIntAdd, IntrinsicOp::kRealAdd);
-      break;
+      return is_int ? IntrinsicOp::kIntAdd : IntrinsicOp::kRealAdd;
     case TokenType::kMinus:
-      CHECK_TYPE(IntrinsicOp::kIntSub, IntrinsicOp::kRealSub);
-      break;
+      return is_int ? IntrinsicOp::kIntSub : IntrinsicOp::kRealSub;
     case TokenType::kStar:
-      CHECK_TYPE(IntrinsicOp::kIntMul, IntrinsicOp::kRealMul);
-      break;
+      return is_int ? IntrinsicOp::kIntMul : IntrinsicOp::kRealMul;
     case TokenType::kSlash:
-      CHECK_TYPE(IntrinsicOp::kIntDiv, IntrinsicOp::kRealDiv);
-      break;
+      return is_int ? IntrinsicOp::kIntDiv : IntrinsicOp::kRealDiv;
     default:
       assert(false && "Unreachable");
+      return IntrinsicOp::kNone;
   }
-
-#undef CHECK_TYPE
-}
-
-void TypeCheck::SetIntrinsic(UnaryExpr& expr) const {
-#define CHECK_TYPE(if_int, if_real) \
-    do { \
-      if (expr.GetType()->Match(kInt.get())) { \
-        expr.SetIntrinsic(if_int); \
-      } else if (expr.GetType()->Match(kReal.get())) { \
-        expr.SetIntrinsic(if_real); \
-      } \
-    } while (false)
-
-  switch (expr.Op().type) {
-    case TokenType::kMinus:
-      CHECK_TYPE(IntrinsicOp::kIntNeg, IntrinsicOp::kRealNeg);
-      break;
-    case TokenType::kPlus: break;
-    default: assert(false && "Not an unary op");
-  }
-
-#undef CHECK_TYPE
-}
-
-optional<const Type*> TypeCheck::Lookup(absl::string_view name)  {
-  for (auto check = this; check; check = check->parent_) {
-    auto it = check->locals_.find(name);
-    if (it != check->locals_.end()) return make_optional(it->second);
-  }
-
-  return nullopt;
 }
 
-void PatternMatcher::Visit(TypedPattern& pattern) {
+void TypeCheck::DeclareRule(Interner::Data name, Span span,
+                            const Type* decl, const Type* type) {
   const Type* var = nullptr;
-  const auto& decl = pattern.GetType();
+  const auto token = NameToken(name, span);
 
-  assert(type_);
-  if (decl && decl->Match(type_)) var = decl.get();
-  else if (!decl) var = type_;
-  else check_.reporter_.ErrorAt("Incompatible type decl", pattern.GetName());
+  assert(type);
+  if (decl && decl == type) var = decl;
+  else if (!decl) var = type;
+  else reporter_.ErrorAt("Incompatible type decl", token);
 
-  if (check_.locals_.contains(pattern.GetName().lexeme)) {
-    check_.reporter_.ErrorAt("Redefinition of a name is not allowed", pattern.GetName());
-  } else {
-    check_.locals_[pattern.GetName().lexeme] = var;
+  if (!symbols_.Declare(name, var)) {
+    reporter_.ErrorAt("Redefinition of a name is not allowed", token);
   }
 }
 
-void TypeCheck::Visit(VariableStmt& stmt) {
-  stmt.GetExpr()->Accept(*this);
-
-  const Type* expr_type = stmt.GetExpr()->GetType().get();
-  PatternMatcher match(expr_type, *this);
-
-  stmt.GetPattern()->Accept(match);
+void PatternMatcher::Visit(TypedPattern& pattern) {
+  // the declared type is made by the parser
+  check_.DeclareRule(pattern.GetName(), pattern.GetSpan(),
+                     check_.context_.Canonical(pattern.GetType()), type_);
 }
 
-void TypeCheck::Visit(LiteralExpr& expr) {
-  switch (expr.Value().type) {
+const Type* TypeCheck::LiteralRule(TokenType kind) const {
+  switch (kind) {
     case TokenType::kInt:
-      expr.SetType(kInt->Copy());
-      return;
+      return kInt;
     case TokenType::kReal:
-      expr.SetType(kReal->Copy());
-      return;
+      return kReal;
     case TokenType::kChar:
-      expr.SetType(kChar->Copy());
-      return;
+      return kChar;
     case TokenType::kString:
       assert(false && "Unimplemented");
-      return;
+      return nullptr;
     case TokenType::kTrue:
     case TokenType::kFalse:
-      expr.SetType(kBool->Copy());
-      return;
+      return kBool;
     case TokenType::kUnit:
-      expr.SetType(kUnit->Copy());
-      return;
-    default: assert(false && "Invalid literal expr");
+      return kUnit;
+    default:
+      assert(false && "Invalid literal expr");
+      return nullptr;
   }
 }
 
-void TypeCheck::Visit(IdentifierExpr& expr) {
-  if (auto var = Lookup(expr.Value().lexeme)) {
-    if (*var) expr.SetType((*var)->Copy());
-    else expr.SetType(make_unique<ErrorType>());
-  } else {
-    reporter_.ErrorAt("Undeclared identifier", expr.Value());
-    expr.SetType(make_unique<ErrorType>());
+const Type* TypeCheck::IdentifierRule(Interner::Data name, Span span) {
+  if (auto var = symbols_.Lookup(name)) {
+    return *var ? *var : kError;
   }
-}
 
-void TypeCheck::Visit(IfExpr& expr) {
-  expr.Cond()->Accept(*this);
-  const auto& cond_type = expr.Cond()->GetType();
+  reporter_.ErrorAt("Undeclared identifier", NameToken(name, span));
+  return kError;
+}
 
-  bool cond_good = !Is<ErrorType>(cond_type);
-  if (cond_good && !cond_type->Match(kBool.get())) {
-    reporter_.ErrorAt("Type of condition must be Bool", 0, 0); // TODO
-    cond_good = false;
+void TypeCheck::ConditionRule(const Type* cond, string_view msg) {
+  if (!Is<ErrorType>(cond) && cond != kBool) {
+    reporter_.ErrorAt(msg, 0, 0); // TODO
   }
+}
 
-  expr.Then()->Accept(*this);
-  const auto& then_type = expr.Then()->GetType();
-
-  if (!expr.Else()) {
-    if (cond_good && !Is<ErrorType>(then_type)) {
-      expr.SetType(kUnit->Copy());
-    } else {
-      expr.SetType(make_unique<ErrorType>());
-    }
-
-    return;
+const Type* TypeCheck::IfRule(const Type* cond, const Type* then_type,
+                              const Type* else_type) {
+  bool cond_good = !Is<ErrorType>(cond) && cond == kBool;
+  if (!else_type) {
+    return cond_good && !Is<ErrorType>(then_type) ? kUnit : kError;
   }
 
-  expr.Else()->Accept(*this);
-  const auto& else_type = expr.Else()->GetType();
-
   if (Is<ErrorType>(then_type) || Is<ErrorType>(else_type)) {
     cond_good = false;
   }
 
-  if (cond_good && !then_type->Match(else_type)) {
+  if (cond_good && then_type != else_type) {
     reporter_.ErrorAt("Two clauses of an 'if' expression have different types", 0, 0);
     cond_good = false;
   }
 
-  if (cond_good) expr.SetType(then_type->Copy());
-  else expr.SetType(make_unique<ErrorType>());
+  return cond_good ? then_type : kError;
 }
 
 // TODO: define the order of assignment execution
-void TypeCheck::Visit(AssignExpr& expr) {
-  assert(!expr.Receiver() && "Unimplemented"); // TODO: fix when classes are introduced
-  expr.Expr()->Accept(*this);
-
-  auto dest_type_opt = Lookup(expr.Name().lexeme);
+const Type* TypeCheck::AssignRule(Interner::Data name, Span span, const Type* value_type) {
+  auto dest_type_opt = symbols_.Lookup(name);
   if (!dest_type_opt) {
-    reporter_.ErrorAt("Undefined name", expr.Name());
-    expr.SetType(make_unique<ErrorType>());
-    return;
+    reporter_.ErrorAt("Undefined name", NameToken(name, span));
+    return kError;
   }
 
   auto dest_type = *dest_type_opt;
-  const auto& value_type = expr.Expr()->GetType();
   if (!Is<ErrorType>(dest_type) || !Is<ErrorType>(value_type)) {
-    expr.SetType(make_unique<ErrorType>());
-    return;
+    return kError;
   }
 
-  if (!dest_type->Match(value_type.get())) {
+  if (dest_type != value_type) {
     reporter_.ErrorAt("Invalid assignment types", 0, 0);
-    expr.SetType(make_unique<ErrorType>());
-    return;
+    return kError;
   }
 
-  expr.SetType(kUnit->Copy());
+  return kUnit;
 }
 
-void TypeCheck::Visit(BlockExpr& expr) {
-  Type* result = kUnit.get();
+const Type* TypeCheck::WhileRule(const Type* cond, const Type* body) const {
+  return !Is<ErrorType>(cond) && !Is<ErrorType>(body) ? kUnit : kError;
+}
 
-  TypeCheck scope(this);
-  for (const auto& stmt : expr.Body()) {
-    stmt->Accept(scope);
-    if (!Is<ErrorType>(result)) {
-      if (stmt->IsExpr()) {
-        result = static_cast<const Expr*>(stmt.get())->GetType().get();
-      } else result = kUnit.get();
+void TypeCheck::Visit(VariableStmt& stmt) { Walk(stmt); }
+void TypeCheck::Visit(BinaryExpr& expr) { Walk(expr); }
+void TypeCheck::Visit(UnaryExpr& expr) { Walk(expr); }
+void TypeCheck::Visit(LiteralExpr& expr) { Walk(expr); }
+void TypeCheck::Visit(IdentifierExpr& expr) { Walk(expr); }
+void TypeCheck::Visit(AssignExpr& expr) { Walk(expr); }
+void TypeCheck::Visit(BlockExpr& expr) { Walk(expr); }
+void TypeCheck::Visit(IfExpr& expr) { Walk(expr); }
+void TypeCheck::Visit(WhileExpr& expr) { Walk(expr); }
+
+// A node is checked once its children are, the children are walked
+// with an explicit stack so the depth of the tree doesn't matter.
+// Blocks open a scope when they are entered
+void TypeCheck::Walk(AstNode& root) {
+  struct Entry {
+    AstNode* node;
+    size_t next; // child to be checked next
+  };
+
+  std::vector<Entry> stack;
+
+  auto enter = [&](AstNode* node) {
+    if (node->GetKind() == AstKind::kBlock) {
+      symbols_.Enter();
+    }
+
+    stack.push_back({node, 0});
+  };
+
+  enter(&root);
+  while (!stack.empty()) {
+    auto& top = stack.back();
+    auto* node = top.node;
+
+    if (auto* child = ChildAt(*node, top.next)) {
+      // conditions are reported before the branches are checked
+      if (top.next == 1) {
+        if (node->GetKind() == AstKind::kIf) {
+          ConditionRule(TypeOf(ChildAt(*node, 0)), "Type of condition must be Bool");
+        } else if (node->GetKind() == AstKind::kWhile) {
+          ConditionRule(TypeOf(ChildAt(*node, 0)), "Type of condition expression must be Bool");
+        }
+      }
+
+      top.next++;
+      enter(child);
+      continue;
+    }
+
+    stack.pop_back();
+    Complete(*node);
+    if (node->GetKind() == AstKind::kBlock) {
+      symbols_.Exit();
     }
   }
+}
 
-  if (result) expr.SetType(result->Copy());
+const Type* TypeCheck::TypeOf(const AstNode* node) {
+  return static_cast<const Expr*>(node)->GetType();
 }
 
-void TypeCheck::Visit(WhileExpr& expr) {
-  expr.Cond()->Accept(*this);
-  const auto& cond_type = expr.Cond()->GetType();
+// the children have been checked in this scope
+void TypeCheck::Complete(AstNode& node) {
+  switch (node.GetKind()) {
+    case AstKind::kVariable: {
+      auto& stmt = static_cast<VariableStmt&>(node);
+      PatternMatcher match(TypeOf(stmt.GetExpr()), *this);
+      stmt.GetPattern()->Accept(match);
+      break;
+    }
+
+    case AstKind::kBinary: {
+      auto& expr = static_cast<BinaryExpr&>(node);
+      const auto* type = BinaryRule(expr.Op(), expr.GetSpan(),
+          TypeOf(expr.Left()), TypeOf(expr.Right()));
+      expr.SetType(type);
+      expr.SetIntrinsic(Intrinsic(expr.Op(), type, false));
+      break;
+    }
+
+    case AstKind::kUnary: {
+      auto& expr = static_cast<UnaryExpr&>(node);
+      const auto* type = UnaryRule(expr.Op(), expr.GetSpan(), TypeOf(expr.Operand()));
+      expr.SetType(type);
+      expr.SetIntrinsic(Intrinsic(expr.Op(), type, true));
+      break;
+    }
+
+    case AstKind::kLiteral: {
+      auto& expr = static_cast<LiteralExpr&>(node);
+      if (const auto* type = LiteralRule(expr.Kind())) {
+        expr.SetType(type);
+      }
+      break;
+    }
+
+    case AstKind::kIdentifier: {
+      auto& expr = static_cast<IdentifierExpr&>(node);
+      expr.SetType(IdentifierRule(expr.Name(), expr.GetSpan()));
+      break;
+    }
+
+    case AstKind::kAssign: {
+      auto& expr = static_cast<AssignExpr&>(node);
+      assert(!expr.Receiver() && "Unimplemented"); // TODO: fix when classes are introduced
+      expr.SetType(AssignRule(expr.Name(), expr.GetSpan(), TypeOf(expr.Expr())));
+      break;
+    }
+
+    case AstKind::kBlock: {
+      auto& expr = static_cast<BlockExpr&>(node);
+      const Type* result = kUnit;
+      for (auto* stmt : expr.Body()) {
+        if (!Is<ErrorType>(result)) {
+          result = stmt->IsExpr() ? TypeOf(stmt) : kUnit;
+        }
+      }
+
+      if (result) expr.SetType(result);
+      break;
+    }
+
+    case AstKind::kIf: {
+      auto& expr = static_cast<IfExpr&>(node);
+      const Type* else_type = expr.Else() ? TypeOf(expr.Else()) : nullptr;
+      expr.SetType(IfRule(TypeOf(expr.Cond()), TypeOf(expr.Then()), else_type));
+      break;
+    }
 
-  if (!Is<ErrorType>(cond_type) && !cond_type->Match(kBool.get())) {
-    // TODO
-    reporter_.ErrorAt("Type of condition expression must be Bool", 0, 0);
+    case AstKind::kWhile: {
+      auto& expr = static_cast<WhileExpr&>(node);
+      expr.SetType(WhileRule(TypeOf(expr.Cond()), TypeOf(expr.Body())));
+      break;
+    }
   }
+}
 
-  expr.Body()->Accept(*this);
-  const auto& body_type = expr.Body()->GetType();
-  if (!Is<ErrorType>(cond_type) && !Is<ErrorType>(body_type)) {
-    expr.SetType(kUnit->Copy());
-  } else {
-    expr.SetType(make_unique<ErrorType>());
+// Same rules as the visitors in one forward pass: a node is checked
+// once its subtree ends, blocks open a scope when they are entered
+void TypeCheck::Check(FlatAst& ast) {
+  using Kind = FlatAst::Kind;
+  using Index = FlatAst::Index;
+
+  std::vector<const Type*> types(ast.Size(), nullptr);
+  std::vector<Index> open; // nodes whose subtrees are being checked
+
+  auto declared = [&](FlatAst::TypeId id) -> const Type* {
+    if (id == FlatAst::kNoType) return nullptr;
+    if (id == FlatAst::kErrorType) return kError;
+    return context_.Single(id);
+  };
+
+  auto complete = [&](Index node) {
+    const auto child = ast.FirstChild(node);
+    const auto op = ast.Op(node);
+    const auto span = ast.GetSpan(node);
+    const Type* type = nullptr;
+
+    switch (ast.GetKind(node)) {
+      case Kind::kVariable:
+        DeclareRule(ast.Data(child), ast.GetSpan(child),
+                    declared(ast.Aux(child)), types[ast.NextSibling(child)]);
+        break;
+      case Kind::kPattern:
+        break;
+      case Kind::kBinary:
+        type = BinaryRule(op, span, types[child], types[ast.NextSibling(child)]);
+        ast.SetIntrinsic(node, Intrinsic(op, type, false));
+        break;
+      case Kind::kUnary:
+        type = UnaryRule(op, span, types[child]);
+        ast.SetIntrinsic(node, Intrinsic(op, type, true));
+        break;
+      case Kind::kLiteral:
+        type = LiteralRule(op);
+        break;
+      case Kind::kIdentifier:
+        type = IdentifierRule(ast.Data(node), span);
+        break;
+      case Kind::kBlock:
+        type = kUnit;
+        for (auto stmt = child; stmt < ast.End(node); stmt = ast.NextSibling(stmt)) {
+          if (!Is<ErrorType>(type)) {
+            type = ast.GetKind(stmt) == Kind::kVariable ? kUnit : types[stmt];
+          }
+        }
+
+        symbols_.Exit();
+        break;
+      case Kind::kIf: {
+        const auto then_branch = ast.NextSibling(child);
+        const auto else_branch = ast.NextSibling(then_branch);
+        type = IfRule(types[child], types[then_branch],
+            else_branch < ast.End(node) ? types[else_branch] : nullptr);
+        break;
+      }
+      case Kind::kWhile:
+        type = WhileRule(types[child], types[ast.NextSibling(child)]);
+        break;
+      case Kind::kAssign:
+        type = AssignRule(ast.Data(node), span, types[child]);
+        break;
+    }
+
+    types[node] = type;
+    ast.SetType(node, FlatAst::IdOf(type));
+
+    // conditions are reported before the branches are checked
+    if (!open.empty() && node == ast.FirstChild(open.back())) {
+      if (ast.GetKind(open.back()) == Kind::kIf) {
+        ConditionRule(type, "Type of condition must be Bool");
+      } else if (ast.GetKind(open.back()) == Kind::kWhile) {
+        ConditionRule(type, "Type of condition expression must be Bool");
+      }
+    }
+  };
+
+  auto close = [&](Index until) {
+    while (!open.empty() && ast.End(open.back()) <= until) {
+      auto node = open.back();
+      open.pop_back();
+      complete(node);
+    }
+  };
+
+  for (Index node = 0; node < ast.Size(); node++) {
+    close(node);
+
+    if (ast.GetKind(node) == Kind::kBlock) {
+      symbols_.Enter();
+    }
+
+    if (ast.IsLeaf(node)) complete(node);
+    else open.push_back(node);
   }
+
+  close(ast.Size());
 }
 
 }
@@ -5,12 +5,14 @@
 #ifndef HELIUM_COMPILER_SRC_TYPE_CHECK_HPP_
 #define HELIUM_COMPILER_SRC_TYPE_CHECK_HPP_
 
-#include <absl/container/flat_hash_map.h>
-#include "absl/types/optional.h"
 #include <parser/ast.hpp>
+#include <parser/flat_ast.hpp>
+#include <cstddef>
 #include <utility>
 #include "error_reporter.hpp"
 #include "interner.hpp"
+#include "symbol_table.hpp"
+#include "type_context.hpp"
 
 namespace helium {
 
@@ -30,56 +32,42 @@ class PatternMatcher : public PatternVisitor {
   void Visit(TypedPattern& pattern) override;
 };
 
-class TypeCheck : public AstVisitor {
+class TypeCheck final : public AstVisitor {
   friend class PatternMatcher;
+  friend class SinglePass; // applies the rules while parsing
+  friend class DocumentCheck; // binds the globals of units it doesn't walk
 
-  TypeCheck* parent_; // Enclosing scope's type check
-  absl::flat_hash_map<::absl::string_view, const Type*> locals_;
+  SymbolTable symbols_; // of the open scopes
   ErrorReporter& reporter_;
+  TypeContext& context_; // all the types are its, they are compared by pointer
+  Interner& interner_;
 
-  const std::shared_ptr<Type> kInt;
-  const std::shared_ptr<Type> kReal;
-  const std::shared_ptr<Type> kUnit;
-  const std::shared_ptr<Type> kChar;
-  const std::shared_ptr<Type> kBool;
-
-  TypeCheck(
-      TypeCheck* parent, ErrorReporter& reporter,
-      std::shared_ptr<Type> kInt,
-      std::shared_ptr<Type> kReal,
-      std::shared_ptr<Type> kUnit,
-      std::shared_ptr<Type> kChar,
-      std::shared_ptr<Type> kBool)
-  : parent_(parent),
-    locals_(),
-    reporter_(reporter),
-    kInt(std::move(kInt)),
-    kReal(std::move(kReal)),
-    kUnit(std::move(kUnit)),
-    kChar(std::move(kChar)),
-    kBool(std::move(kBool))
-  {}
-
-  explicit TypeCheck(TypeCheck* parent)
-  : TypeCheck(
-      parent,
-      parent->reporter_,
-      parent->kInt,
-      parent->kReal,
-      parent->kUnit,
-      parent->kChar,
-      parent->kBool)
-  {}
+  const Type* const kInt;
+  const Type* const kReal;
+  const Type* const kUnit;
+  const Type* const kChar;
+  const Type* const kBool;
+  const Type* const kError;
 
  public:
+  static constexpr size_t kParallelStatements = 1 << 10;
+  // the units are scanned before they are checked, which makes
+  // a single thread take about twice as long as Walk() does
+  static constexpr size_t kParallelThreads = 4;
+
   TypeCheck() = delete;
-  TypeCheck(ErrorReporter& reporter, Interner& interner)
-  : TypeCheck(nullptr, reporter,
-              std::make_shared<SingleType>(interner.Intern("Int")),
-              std::make_shared<SingleType>(interner.Intern("Real")),
-              std::make_shared<SingleType>(interner.Intern("Unit")),
-              std::make_shared<SingleType>(interner.Intern("Char")),
-              std::make_shared<SingleType>(interner.Intern("Bool")))
+  // the checked expressions point to the types of the context
+  TypeCheck(ErrorReporter& reporter, TypeContext& context)
+  : symbols_(),
+    reporter_(reporter),
+    context_(context),
+    interner_(context.GetInterner()),
+    kInt(context.Int()),
+    kReal(context.Real()),
+    kUnit(context.Unit()),
+    kChar(context.Char()),
+    kBool(context.Bool()),
+    kError(context.Error())
   {}
 
   void Visit(VariableStmt& stmt) override;
@@ -92,13 +80,50 @@ class TypeCheck : public AstVisitor {
   void Visit(IfExpr& expr) override;
   void Visit(WhileExpr& expr) override;
 
- private:
-  ::absl::optional<const Type*> Lookup(absl::string_view name);
+  // fills the type and intrinsic columns in a single linear pass
+  void Check(FlatAst& ast);
+
+  // checks the statements of a program one after another in a global scope
+  // of their own, with CheckParallel() if there are many of them and cores
+  // and the tree isn't lazy
+  static void Check(const AstTree& ast, ErrorReporter& reporter, TypeContext& context);
+  // Splits the statements into units that share no global names: every
+  // statement is in the unit of the statements that declare or use the
+  // global names it declares or uses. The units are checked on the given
+  // number of threads, each reports to a buffer of its own. The buffers
+  // are merged in the order of the statements, so the types and the
+  // errors are the ones checking them one after another gives.
+  // The tree must not be lazy, its bodies are parsed without locking
+  static void CheckParallel(const AstTree& ast, ErrorReporter& reporter,
+                            TypeContext& context, size_t threads);
 
-  // Set intrinsic on binary and unary expressions
-  // Expect exprs already have been type checked
-  void SetIntrinsic(BinaryExpr& expr) const;
-  void SetIntrinsic(UnaryExpr& expr) const;
+ private:
+  void Walk(AstNode& root);
+  // applies the rule of a node whose children are checked
+  void Complete(AstNode& node);
+  static const Type* TypeOf(const AstNode* expr);
+
+  // diagnostics point at the name
+  Token NameToken(Interner::Data name, Span span) const;
+
+  // Typing rules shared by the tree and the flat walks. They take
+  // the types of checked operands, report errors and return the type
+  // of the expression, which is one of the k* types or an operand's type
+  const Type* UnaryRule(TokenType op, Span span, const Type* operand);
+  const Type* BinaryRule(TokenType op, Span span, const Type* left, const Type* right);
+  const Type* LiteralRule(TokenType kind) const;
+  const Type* IdentifierRule(Interner::Data name, Span span);
+  const Type* AssignRule(Interner::Data name, Span span, const Type* value);
+  const Type* IfRule(const Type* cond, const Type* then_type, const Type* else_type);
+  const Type* WhileRule(const Type* cond, const Type* body) const;
+  // reported as soon as the condition is checked
+  void ConditionRule(const Type* cond, absl::string_view msg);
+  // binds a pattern in the current scope, decl is the declared type (might be null),
+  // both types are of the context
+  void DeclareRule(Interner::Data name, Span span, const Type* decl, const Type* type);
+
+  // intrinsic of a binary or unary operator with the given result type
+  IntrinsicOp Intrinsic(TokenType op, const Type* type, bool unary) const;
 };
 
 }
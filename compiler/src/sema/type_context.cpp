@@ -0,0 +1,34 @@
+#include "absl/memory/memory.h"
+#include "type_context.hpp"
+
+namespace helium {
+
+TypeContext::TypeContext(Interner& interner)
+: interner_(interner),
+  singles_(),
+  error_(),
+  int_(Single(interner.Intern("Int"))),
+  real_(Single(interner.Intern("Real"))),
+  unit_(Single(interner.Intern("Unit"))),
+  char_(Single(interner.Intern("Char"))),
+  bool_(Single(interner.Intern("Bool")))
+{}
+
+const SingleType* TypeContext::Single(Interner::Data name) {
+  auto it = singles_.find(name);
+  if (it != singles_.end()) return it->second.get();
+
+  auto& type = singles_[name];
+  type = ::absl::make_unique<SingleType>(name);
+  return type.get();
+}
+
+const Type* TypeContext::Canonical(const Type* type) {
+  if (const auto* single = Cast<SingleType>(type)) {
+    return Single(single->GetTypeData());
+  }
+
+  return Is<ErrorType>(type) ? Error() : nullptr;
+}
+
+}
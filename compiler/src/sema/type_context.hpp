@@ -0,0 +1,50 @@
+#ifndef HELIUM_COMPILER_SRC_SEMA_TYPE_CONTEXT_HPP_
+#define HELIUM_COMPILER_SRC_SEMA_TYPE_CONTEXT_HPP_
+
+#include <memory>
+#include "absl/container/flat_hash_map.h"
+#include "interner.hpp"
+#include "type.hpp"
+
+namespace helium {
+
+// Owns a single instance of every type, so two types of a context are
+// equal if their pointers are. Checked expressions point to the types
+// of the context they were checked in, it must outlive them
+class TypeContext final {
+  Interner& interner_;
+  ::absl::flat_hash_map<Interner::Data, std::unique_ptr<SingleType>> singles_;
+  ErrorType error_;
+
+  const SingleType* const int_;
+  const SingleType* const real_;
+  const SingleType* const unit_;
+  const SingleType* const char_;
+  const SingleType* const bool_;
+
+ public:
+  TypeContext() = delete;
+  explicit TypeContext(Interner& interner);
+
+  TypeContext(const TypeContext&) = delete;
+  TypeContext& operator =(const TypeContext&) = delete;
+
+  Interner& GetInterner() const { return interner_; }
+
+  // the type of the given interned name. Types that exist already are
+  // only looked up, so they can be asked for on several threads at once
+  const SingleType* Single(Interner::Data name);
+  // the instance equal to a type made elsewhere, e.g. by the parser
+  const Type* Canonical(const Type* type);
+
+  const Type* Int() const { return int_; }
+  const Type* Real() const { return real_; }
+  const Type* Unit() const { return unit_; }
+  const Type* Char() const { return char_; }
+  const Type* Bool() const { return bool_; }
+  const Type* Error() const { return &error_; }
+};
+
+}
+
+#endif //HELIUM_COMPILER_SRC_SEMA_TYPE_CONTEXT_HPP_
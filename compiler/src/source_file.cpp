@@ -0,0 +1,97 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <utility>
+#include "source_file.hpp"
+
+namespace helium {
+namespace {
+
+using ::std::string;
+using ::absl::optional;
+using ::absl::nullopt;
+
+constexpr size_t kReadChunk = 1 << 16;
+
+bool ReadAll(int fd, string& data) {
+  char chunk[kReadChunk];
+  while (true) {
+    ssize_t n = read(fd, chunk, sizeof(chunk));
+    if (n == 0) return true;
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    data.append(chunk, static_cast<size_t>(n));
+  }
+}
+
+}
+
+SourceFile::SourceFile(SourceFile&& other) noexcept
+: data_(other.data_),
+  size_(other.size_),
+  buffer_(::std::move(other.buffer_))
+{
+  other.data_ = nullptr;
+  other.size_ = 0;
+}
+
+SourceFile::~SourceFile() {
+  if (data_) munmap(const_cast<char*>(data_), size_);
+}
+
+optional<SourceFile> SourceFile::Open(const string& name) {
+  const bool is_stdin = name == "-";
+  int fd = is_stdin ? STDIN_FILENO : open(name.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return nullopt;
+
+  SourceFile file;
+  bool ok = true;
+
+  struct stat info{};
+  if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+    auto size = static_cast<size_t>(info.st_size);
+    void* addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr != MAP_FAILED) {
+      madvise(addr, size, MADV_SEQUENTIAL);
+      file.data_ = static_cast<const char*>(addr);
+      file.size_ = size;
+    } else {
+      ok = ReadAll(fd, file.buffer_);
+    }
+  } else {
+    // empty, special or unstat-able file, read whatever is there
+    ok = ReadAll(fd, file.buffer_);
+  }
+
+  if (!is_stdin) close(fd);
+  if (!ok) return nullopt;
+  return optional<SourceFile>(::std::move(file));
+}
+
+SourceStream SourceStream::FromFd(int fd) {
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL); // fails for pipes, that's fine
+  return SourceStream(fd, nullptr);
+}
+
+size_t SourceStream::Read(char* data, size_t size) {
+  if (!stream_) {
+    while (true) {
+      ssize_t n = read(fd_, data, size);
+      if (n >= 0) return static_cast<size_t>(n);
+      if (errno != EINTR) {
+        failed_ = true;
+        return 0;
+      }
+    }
+  }
+
+  stream_->read(data, static_cast<::std::streamsize>(size));
+  failed_ = stream_->bad();
+  return static_cast<size_t>(stream_->gcount());
+}
+
+}
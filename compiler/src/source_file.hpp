@@ -0,0 +1,70 @@
+#ifndef HELIUM_COMPILER_SRC_SOURCE_FILE_HPP_
+#define HELIUM_COMPILER_SRC_SOURCE_FILE_HPP_
+
+#include <cstddef>
+#include <istream>
+#include <string>
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+
+namespace helium {
+
+// read-only contents of a source file; regular files are memory mapped,
+// anything that can't be mapped (pipes, ttys, "-" for stdin) is read
+// into an owned buffer. Interner, tokens, ast and reporter keep views
+// into the contents, so this object must outlive all of them
+class SourceFile final {
+  const char* data_; // start of the mapping, null if not mapped
+  size_t size_;
+  std::string buffer_; // used when the file can't be mapped
+
+  SourceFile()
+  : data_(nullptr),
+    size_(0),
+    buffer_()
+  {}
+
+ public:
+  SourceFile(const SourceFile&) = delete;
+  SourceFile& operator =(const SourceFile&) = delete;
+  SourceFile(SourceFile&& other) noexcept;
+  ~SourceFile();
+
+  static absl::optional<SourceFile> Open(const std::string& name);
+
+  absl::string_view Contents() const {
+    return data_ ? absl::string_view(data_, size_) : absl::string_view(buffer_);
+  }
+
+  bool IsMapped() const { return data_ != nullptr; }
+};
+
+// source that is read piece by piece, either from a file
+// descriptor or from a stream. Doesn't own either of them
+class SourceStream final {
+  int fd_; // -1 if reading from stream_
+  std::istream* stream_;
+  bool failed_;
+
+  SourceStream(int fd, std::istream* stream)
+  : fd_(fd),
+    stream_(stream),
+    failed_(false)
+  {}
+
+ public:
+  SourceStream() = delete;
+  static SourceStream FromFd(int fd);
+  static SourceStream FromStream(std::istream& stream) {
+    return SourceStream(-1, &stream);
+  }
+
+  // reads at most size bytes, 0 means end of input or an error
+  size_t Read(char* data, size_t size);
+  // a read failed, the input seen so far is incomplete
+  bool Failed() const { return failed_; }
+};
+
+}
+
+#endif //HELIUM_COMPILER_SRC_SOURCE_FILE_HPP_
@@ -0,0 +1,113 @@
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <gtest/gtest.h>
+#include <parser/ast_arena.hpp>
+#include <parser/parser.hpp>
+
+namespace helium {
+namespace {
+
+struct Counted {
+  int& destroyed;
+  explicit Counted(int& destroyed) : destroyed(destroyed) {}
+  ~Counted() { destroyed++; }
+};
+
+struct alignas(32) Aligned {
+  char data[3];
+};
+
+}
+
+TEST(AstArena, Allocate) {
+  AstArena arena;
+  EXPECT_EQ(arena.Blocks(), 0);
+
+  auto* c = arena.New<char>('a');
+  auto* aligned = arena.New<Aligned>();
+  auto* value = arena.New<int64_t>(42);
+  EXPECT_EQ(*c, 'a');
+  EXPECT_EQ(*value, 42);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(aligned) % 32, 0);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(value) % alignof(int64_t), 0);
+  EXPECT_EQ(arena.Blocks(), 1);
+
+  // large objects get a block of their own
+  auto* large = static_cast<char*>(arena.Allocate(AstArena::kBlockSize * 2, 8));
+  large[AstArena::kBlockSize * 2 - 1] = 'z';
+  EXPECT_EQ(arena.Blocks(), 2);
+
+  // small ones keep using the current block
+  arena.New<int>(1);
+  EXPECT_EQ(arena.Blocks(), 2);
+
+  for (int i = 0; i < 100000; i++) arena.New<int>(i);
+  EXPECT_GT(arena.Blocks(), 2);
+  EXPECT_GE(arena.Allocated(), 100000 * sizeof(int));
+}
+
+TEST(AstArena, Destroy) {
+  int destroyed = 0;
+  {
+    AstArena arena;
+    for (int i = 0; i < 10; i++) arena.New<Counted>(destroyed);
+
+    AstArena moved(std::move(arena));
+    EXPECT_EQ(destroyed, 0);
+    EXPECT_EQ(arena.Blocks(), 0);
+
+    moved.Clear();
+    EXPECT_EQ(destroyed, 10);
+    EXPECT_EQ(moved.Blocks(), 0);
+
+    moved.New<Counted>(destroyed);
+  }
+
+  EXPECT_EQ(destroyed, 11);
+}
+
+TEST(AstArena, Merge) {
+  int destroyed = 0;
+  {
+    AstArena arena;
+    arena.New<Counted>(destroyed);
+
+    AstArena other;
+    auto* value = other.New<int>(42);
+    for (int i = 0; i < 3; i++) other.New<Counted>(destroyed);
+
+    arena.Merge(std::move(other));
+    EXPECT_EQ(destroyed, 0);
+    EXPECT_EQ(other.Blocks(), 0);
+    EXPECT_EQ(arena.Blocks(), 2);
+    EXPECT_EQ(*value, 42);
+    EXPECT_GE(arena.Allocated(), sizeof(int) + 4 * sizeof(Counted));
+
+    arena.New<Counted>(destroyed);
+    EXPECT_EQ(arena.Blocks(), 2);
+  }
+
+  EXPECT_EQ(destroyed, 5);
+}
+
+TEST(AstArena, OwnsTree) {
+  ErrorReporter reporter("");
+  Interner interner;
+  ConstantPool constants;
+
+  std::string source;
+  for (int i = 0; i < 1000; i++) source += "var x: Int = { 1 + 2 * -(3 - 4) }\n";
+
+  auto ast = Parser::Parse(source, reporter, interner, constants);
+  ASSERT_FALSE(reporter.HadErrors());
+  EXPECT_EQ(ast.size(), 1000);
+  EXPECT_GT(ast.Arena().Allocated(), 1000 * sizeof(BinaryExpr));
+
+  // nodes stay where they are
+  auto* first = ast[0];
+  auto moved = std::move(ast);
+  EXPECT_EQ(moved[0], first);
+}
+
+}
@@ -0,0 +1,220 @@
+#include <unistd.h>
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include <codegen/code_gen.hpp>
+#include <compiler.hpp>
+#include <parser/ast_cache.hpp>
+#include <parser/parser.hpp>
+#include <sema/type_check.hpp>
+#include <sema/type_context.hpp>
+#include "common.hpp"
+
+namespace helium {
+namespace {
+
+using ::std::string;
+
+// with type errors, so not all the types and intrinsics are set
+string Source() {
+  return Joined(kWellTyped) + Joined(kTypeErrors);
+}
+
+string TempPath(const string& name) {
+  return ::testing::TempDir() + name + std::to_string(getpid());
+}
+
+struct Checked {
+  ErrorReporter reporter;
+  string printed;
+
+  Checked() : reporter("") {}
+
+  void Check(const string& source, FlatAst& ast, Interner& interner) {
+    reporter.SetSource(source);
+    TypeContext types(interner);
+    TypeCheck check(reporter, types);
+    check.Check(ast);
+    printed = PrintFlat(ast, true, interner);
+  }
+};
+
+}
+
+TEST(AstCache, RoundTrip) {
+  const string source = Source();
+  const auto path = TempPath("round_trip");
+
+  ErrorReporter reporter("");
+  Interner interner;
+  ConstantPool constants;
+  auto tree = Parser::Parse(source, reporter, interner, constants);
+  ASSERT_FALSE(reporter.HadErrors()) << reporter.GetErrors();
+
+  auto parsed = FlatAst::From(tree);
+  ASSERT_TRUE(AstCache::Save(path, source, parsed, interner, constants));
+
+  Interner loaded_interner;
+  ConstantPool loaded_constants;
+  FlatAst loaded;
+  auto cache = AstCache::Load(path, source, loaded, loaded_interner, loaded_constants);
+  ASSERT_TRUE(cache);
+
+  ASSERT_EQ(loaded_interner.Size(), interner.Size());
+  for (size_t i = 0; i < interner.Size(); i++) {
+    EXPECT_EQ(loaded_interner.LookUp(i), interner.LookUp(i));
+  }
+
+  ASSERT_EQ(loaded_constants.Size(), constants.Size());
+  for (ConstantPool::Index i = 0; i < constants.Size(); i++) {
+    EXPECT_EQ(loaded_constants.Get(i), constants.Get(i));
+  }
+
+  ASSERT_EQ(loaded.Size(), parsed.Size());
+  ASSERT_EQ(loaded.Roots().size(), parsed.Roots().size());
+  for (FlatAst::Index node = 0; node < parsed.Size(); node++) {
+    EXPECT_EQ(loaded.GetKind(node), parsed.GetKind(node));
+    EXPECT_EQ(loaded.GetSpan(node).offset, parsed.GetSpan(node).offset);
+    EXPECT_EQ(loaded.End(node), parsed.End(node));
+  }
+
+  // the loaded ast checks and prints the same, intrinsics included
+  Checked expected, actual;
+  expected.Check(source, parsed, interner);
+  actual.Check(source, loaded, loaded_interner);
+  EXPECT_EQ(actual.reporter.GetErrors(), expected.reporter.GetErrors());
+  EXPECT_EQ(actual.printed, expected.printed);
+  for (FlatAst::Index node = 0; node < parsed.Size(); node++) {
+    EXPECT_EQ(loaded.GetIntrinsic(node), parsed.GetIntrinsic(node));
+    EXPECT_EQ(loaded.GetType(node), parsed.GetType(node));
+  }
+
+  // checking wrote to private pages, the file is still the parsed ast
+  FlatAst again;
+  Interner again_interner;
+  ConstantPool again_constants;
+  auto again_cache = AstCache::Load(path, source, again, again_interner, again_constants);
+  ASSERT_TRUE(again_cache);
+  for (FlatAst::Index node = 0; node < again.Size(); node++) {
+    EXPECT_EQ(again.GetType(node), FlatAst::kNoType);
+  }
+
+  std::remove(path.c_str());
+}
+
+TEST(AstCache, Rejects) {
+  const string source = Source();
+  const auto path = TempPath("rejects");
+
+  ErrorReporter reporter("");
+  Interner interner;
+  ConstantPool constants;
+  auto tree = Parser::Parse(source, reporter, interner, constants);
+  auto parsed = FlatAst::From(tree);
+
+  FlatAst ast;
+  Interner fresh;
+  ConstantPool pool;
+  EXPECT_FALSE(AstCache::Load(path, source, ast, fresh, pool)); // missing
+
+  ASSERT_TRUE(AstCache::Save(path, source, parsed, interner, constants));
+  EXPECT_FALSE(AstCache::Load(path, source + " ", ast, fresh, pool));
+
+  // the tables must be empty for the names to keep their numbers
+  EXPECT_FALSE(AstCache::Load(path, source, ast, interner, pool));
+
+  // truncated
+  std::ifstream in(path, std::ios::binary);
+  string image((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  in.close();
+  std::ofstream(path, std::ios::binary | std::ios::trunc) << image.substr(0, image.size() - 8);
+  EXPECT_FALSE(AstCache::Load(path, source, ast, fresh, pool));
+  EXPECT_EQ(fresh.Size(), 0);
+  EXPECT_EQ(pool.Size(), 0);
+
+  std::remove(path.c_str());
+}
+
+// every byte of the file flipped in turn: what loads must check and
+// compile like any parsed ast
+TEST(AstCache, Corrupt) {
+  const string source = Source();
+  const auto path = TempPath("corrupt");
+
+  ErrorReporter reporter("");
+  Interner interner;
+  ConstantPool constants;
+  auto tree = Parser::Parse(source, reporter, interner, constants);
+  auto parsed = FlatAst::From(tree);
+  ASSERT_TRUE(AstCache::Save(path, source, parsed, interner, constants));
+
+  std::ifstream in(path, std::ios::binary);
+  const string image((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  in.close();
+
+  size_t rejected = 0;
+  for (size_t i = 0; i < image.size(); i++) {
+    auto corrupt = image;
+    corrupt[i] = static_cast<char>(corrupt[i] ^ 0xFF);
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << corrupt;
+
+    FlatAst ast;
+    Interner names;
+    ConstantPool pool;
+    auto cache = AstCache::Load(path, source, ast, names, pool);
+    if (!cache) {
+      EXPECT_EQ(names.Size(), 0);
+      rejected++;
+      continue;
+    }
+
+    Checked checked;
+    checked.Check(source, ast, names);
+    if (!checked.reporter.HadErrors()) {
+      std::vector<uint8_t> out;
+      CodeGen::Generate(ast, names, pool, out);
+      EXPECT_FALSE(out.empty());
+    }
+  }
+
+  // names and constant values can change, the structure can't
+  EXPECT_GT(rejected, image.size() / 2);
+  std::remove(path.c_str());
+}
+
+TEST(AstCache, Compiler) {
+  const auto file = TempPath("program.he");
+  const string source = Joined(kWellTyped);
+  std::ofstream(file) << source;
+
+  char key[17];
+  snprintf(key, sizeof(key), "%016" PRIx64, AstCache::Hash(source));
+  const auto cache = ::testing::TempDir() + "/" + key + ".ast";
+
+  std::vector<uint8_t> code;
+  ::testing::internal::CaptureStdout();
+  auto plain_errors = Compiler::FromFile(file, code);
+  auto plain = ::testing::internal::GetCapturedStdout();
+
+  // a miss parses and writes the cache, a hit loads it
+  for (int run = 0; run < 2; run++) {
+    std::vector<uint8_t> out;
+    ::testing::internal::CaptureStdout();
+    auto errors = Compiler::FromFileCached(file, ::testing::TempDir(), out);
+    EXPECT_EQ(::testing::internal::GetCapturedStdout(), plain) << run;
+    EXPECT_EQ(out, code) << run;
+    EXPECT_EQ(errors, plain_errors) << run;
+    EXPECT_EQ(access(cache.c_str(), R_OK), 0);
+  }
+
+  EXPECT_FALSE(plain_errors);
+  EXPECT_FALSE(plain.empty());
+  EXPECT_FALSE(code.empty());
+  std::remove(file.c_str());
+  std::remove(cache.c_str());
+}
+
+}
@@ -0,0 +1,114 @@
+#include <sstream>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include <compiler.hpp>
+#include <codegen/bytecode.hpp>
+#include "common.hpp"
+
+namespace helium {
+namespace {
+
+using ::std::string;
+using ::std::vector;
+
+struct Result {
+  absl::optional<string> errors;
+  vector<uint8_t> code;
+};
+
+Result Pipeline(const string& source) {
+  Result result;
+  ::testing::internal::CaptureStdout();
+  result.errors = Compiler::FromSource(source, result.code);
+  ::testing::internal::GetCapturedStdout();
+  return result;
+}
+
+Result SinglePass(const string& source) {
+  Result result;
+  result.errors = Compiler::FromSourceSinglePass(source, result.code);
+  return result;
+}
+
+string Disassembled(const vector<uint8_t>& code) {
+  std::stringstream ss;
+  Disassemble(code, ss);
+  return ss.str();
+}
+
+void ExpectSame(const string& source) {
+  auto expected = Pipeline(source);
+  auto actual = SinglePass(source);
+  EXPECT_EQ(actual.errors, expected.errors) << source;
+  EXPECT_EQ(Disassembled(actual.code), Disassembled(expected.code)) << source;
+  EXPECT_EQ(actual.code, expected.code) << source;
+}
+
+}
+
+TEST(CodeGen, Code) {
+  vector<uint8_t> code;
+  ASSERT_FALSE(Compiler::FromSourceSinglePass(
+      "var x = 1\n{ var y = x\n if (true) y = 2 else x = 3 }\nwhile (false) -x\nx + 2", code));
+  EXPECT_EQ(Disassembled(code),
+            "0: int 1\n"
+            "9: store 0\n"
+            "14: load 0\n"
+            "19: store 1\n"
+            "24: true\n"
+            "25: jump_if_false -> 50\n"
+            "30: int 2\n"
+            "39: store 1\n"
+            "44: unit\n"
+            "45: jump -> 65\n"
+            "50: int 3\n"
+            "59: store 0\n"
+            "64: unit\n"
+            "65: pop\n"
+            "66: false\n"
+            "67: jump_if_false -> 84\n"
+            "72: load 0\n"
+            "77: int_neg\n"
+            "78: pop\n"
+            "79: jump -> 66\n"
+            "84: unit\n"
+            "85: pop\n"
+            "86: load 0\n"
+            "91: int 2\n"
+            "100: int_add\n"
+            "101: return\n");
+}
+
+TEST(CodeGen, SameAsPipeline) {
+  for (auto source : WellFormed()) ExpectSame(source);
+  for (auto source : kSyntaxErrors) ExpectSame(source);
+  ExpectSame(Joined(kWellTyped));
+}
+
+// neither pass recurses on the depth of the input
+TEST(CodeGen, Deep) {
+  const int depth = 100000;
+  ExpectSame(string(depth, '{') + "1" + string(depth, '}'));
+  ExpectSame(string(depth, '-') + "1.5");
+
+  string ifs;
+  for (int i = 0; i < depth; i++) ifs += "if (true) ";
+  ExpectSame(ifs + "1");
+  ExpectSame(string(depth, '(') + "1 +");
+}
+
+TEST(CodeGen, Appends) {
+  vector<uint8_t> code = {42};
+  ASSERT_FALSE(Compiler::FromSourceSinglePass("1", code));
+  EXPECT_EQ(code.size(), 11);
+  EXPECT_EQ(code[0], 42);
+
+  // nothing is added if there are errors
+  code.resize(1);
+  EXPECT_TRUE(Compiler::FromSourceSinglePass("1 + true", code));
+  EXPECT_TRUE(Compiler::FromSource("1 +", code));
+  EXPECT_EQ(code.size(), 1);
+}
+
+}
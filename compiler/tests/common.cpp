@@ -0,0 +1,68 @@
+#include <iterator>
+#include <sstream>
+#include <parser/ast_printer.hpp>
+#include <parser/parser.hpp>
+#include <sema/type_check.hpp>
+#include <sema/type_context.hpp>
+#include "absl/strings/string_view.h"
+#include "common.hpp"
+
+namespace helium {
+
+using ::std::string;
+using ::std::stringstream;
+using ::std::vector;
+using ::absl::string_view;
+
+vector<const char*> WellFormed() {
+  vector<const char*> programs(std::begin(kWellTyped), std::end(kWellTyped));
+  programs.insert(programs.end(), std::begin(kTypeErrors), std::end(kTypeErrors));
+  return programs;
+}
+
+string PrintTree(const AstTree& ast, bool typed, const Interner& interner) {
+  stringstream ss;
+  AstPrinter printer(typed, ss, interner);
+  for (auto* node : ast) {
+    node->Accept(printer);
+  }
+
+  return ss.str();
+}
+
+string PrintUnits(const Document& document, bool typed, const Interner& interner) {
+  stringstream ss;
+  AstPrinter printer(typed, ss, interner);
+  document.ForEachUnit([&](const vector<AstNode*>& nodes, string_view, uint32_t, int) {
+    for (auto* node : nodes) node->Accept(printer);
+  });
+
+  return ss.str();
+}
+
+Scratch FromScratch(const string& source) {
+  ErrorReporter reporter("");
+  Interner interner;
+  ConstantPool constants;
+  auto ast = Parser::Parse(source, reporter, interner, constants);
+
+  Scratch result{reporter.HadErrors(), PrintTree(ast, false, interner), "", ""};
+  if (!result.parse_errors) {
+    TypeContext types(interner);
+    TypeCheck check(reporter, types);
+    for (auto* node : ast) node->Accept(check);
+    result.typed = PrintTree(ast, true, interner);
+    result.type_errors = reporter.GetErrors();
+  }
+
+  return result;
+}
+
+string PrintFlat(const FlatAst& ast, bool typed, const Interner& interner) {
+  stringstream ss;
+  AstPrinter printer(typed, ss, interner);
+  printer.Print(ast);
+  return ss.str();
+}
+
+}
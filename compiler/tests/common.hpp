@@ -0,0 +1,76 @@
+#ifndef HELIUM_COMPILER_TESTS_COMMON_HPP_
+#define HELIUM_COMPILER_TESTS_COMMON_HPP_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <parser/ast.hpp>
+#include <parser/document.hpp>
+#include <parser/flat_ast.hpp>
+#include <interner.hpp>
+
+namespace helium {
+
+// Programs the suites compile in more than one way and compare. The well
+// typed ones declare distinct globals, so they can be joined into one
+const char* const kWellTyped[] = {
+    "",
+    "1 + 2 * 3 - -4 / +5",
+    "var x = 1.5\nvar y: Real = x * 2.\n{ var x = 'c'\n x }\nx - y",
+    "if (true) { 1 } else { 2 }\nwhile (false) { var a = unit }\n{ if (false) 1 }",
+    "var a = 1\na = 2\n{ }\n{ var a = 1\n { a } }",
+    "var f = { var b = { var c = 1\n c * 2 }\n b + 1 }\nvar d = f\n{ var e = d\n e }",
+    "var i = 1\nwhile (true) { i = i - 1\n var y = -i }\ni",
+    "if (true) if (false) 1 else 2 else 3\n'\\''\n'\\\\'\n'\xc3\xa9'",
+    "var n = 1\nvar n2 = { var n = 2.5\n n }\n-n + +n",
+};
+
+const char* const kTypeErrors[] = {
+    "1 + 2.0\n-true\nundefined\nvar x: Int = 1.0\nvar x = 1\nvar x = 2",
+    "if (1) 2 else 3.0\nwhile ('c') 1\nif (true) 1 else 'a'\n{ 1 + 'a'\n 2 }",
+    "{ var a = 1 }\na\nb = 1\n-(a = 1)",
+};
+
+// the type errors before a syntax error aren't reported
+const char* const kSyntaxErrors[] = {
+    "1 + 'a'\nvar = 2",
+    "{ 1 + 2.\n",
+    "if (true 1\nx",
+    "1 2\n3 +",
+    "99999999999999999999999\n1 + true",
+};
+
+// the well typed programs and the ones with type errors
+std::vector<const char*> WellFormed();
+
+// the programs one after another
+template <size_t N>
+std::string Joined(const char* const (&programs)[N]) {
+  std::string source;
+  for (auto* program : programs) {
+    source += program;
+    source += '\n';
+  }
+
+  return source;
+}
+
+std::string PrintTree(const AstTree& ast, bool typed, const Interner& interner);
+std::string PrintFlat(const FlatAst& ast, bool typed, const Interner& interner);
+// the units one after another
+std::string PrintUnits(const Document& document, bool typed, const Interner& interner);
+
+// a source parsed and checked from scratch, what the incremental
+// suites compare with. Errors are reported for the file ""
+struct Scratch {
+  bool parse_errors;
+  std::string tree;
+  std::string typed;       // if it parsed
+  std::string type_errors; // if it parsed
+};
+
+Scratch FromScratch(const std::string& source);
+
+}
+
+#endif //HELIUM_COMPILER_TESTS_COMMON_HPP_
@@ -0,0 +1,196 @@
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include <parser/ast_printer.hpp>
+#include <parser/document.hpp>
+#include <parser/parser.hpp>
+#include <sema/type_check.hpp>
+#include <sema/type_context.hpp>
+#include "absl/strings/string_view.h"
+#include "common.hpp"
+
+namespace helium {
+namespace {
+
+using ::std::string;
+using ::std::stringstream;
+using ::std::vector;
+using ::absl::string_view;
+
+// each unit is checked with spans resolved against its own text
+Scratch FromDocument(const Document& document) {
+  Scratch result{document.HadErrors(), PrintUnits(document, false, document.GetInterner()),
+                 "", ""};
+  stringstream typed;
+  if (!result.parse_errors) {
+    // names of the checker are interned after the ones of the document
+    Interner names;
+    for (size_t name = 0; name < document.GetInterner().Size(); name++) {
+      names.Intern(*document.GetInterner().LookUp(name));
+    }
+
+    ErrorReporter reporter("");
+    TypeContext types(names);
+    TypeCheck check(reporter, types);
+    AstPrinter typed_printer(true, typed, names);
+    document.ForEachUnit([&](const vector<AstNode*>& nodes, string_view text,
+                             uint32_t, int line) {
+      reporter.SetSource(text);
+      reporter.SetFirstLine(line);
+      for (auto* node : nodes) node->Accept(check);
+      for (auto* node : nodes) node->Accept(typed_printer);
+    });
+    result.type_errors = reporter.GetErrors();
+  }
+
+  result.typed = typed.str();
+  return result;
+}
+
+void ExpectSame(const Document& document, const string& source) {
+  ASSERT_EQ(document.Text(), source);
+  auto expected = FromScratch(source);
+  auto actual = FromDocument(document);
+  ASSERT_EQ(actual.parse_errors, expected.parse_errors) << source;
+  if (expected.parse_errors) return;
+
+  EXPECT_EQ(actual.tree, expected.tree) << source;
+  EXPECT_EQ(actual.typed, expected.typed) << source;
+  EXPECT_EQ(actual.type_errors, expected.type_errors) << source;
+}
+
+string Program(int statements) {
+  string source;
+  for (int i = 0; i < statements; i++) {
+    auto n = std::to_string(i);
+    source += "var x" + n + " = (1 + 2.5 * -3.) / 4\n";
+    source += "{ var y = x" + n + "\n  if (true) { -y } else { y - 1. } }\n\n";
+    source += "while (false) x" + n + " = x" + n + " - 1.\n";
+  }
+
+  return source;
+}
+
+}
+
+TEST(Document, Units) {
+  const string source = "\n// a comment\nvar x = 1\n\n{ 1\n  2 }\nif (true) 1\nelse 2\nx";
+  Document document(source);
+  EXPECT_EQ(document.Text(), source);
+  EXPECT_EQ(document.Units(), 5); // the blank lines and four statements
+  ExpectSame(document, source);
+
+  Document empty("");
+  EXPECT_EQ(empty.Text(), "");
+  empty.Apply({0, 0, "var a = 1"});
+  ExpectSame(empty, "var a = 1");
+}
+
+TEST(Document, Edits) {
+  string source = "var x = 1\nx + 2\n{ var y = x\n  y }\nx";
+  Document document(source);
+
+  auto apply = [&](uint32_t offset, uint32_t length, string_view text) {
+    document.Apply({offset, length, text});
+    source.replace(offset, length, text.data(), text.size());
+    ExpectSame(document, source);
+  };
+
+  apply(10, 1, "-x");      // in a statement
+  apply(0, 0, "var z = 2.\n"); // a new one
+  apply(source.find("{"), 0, "while (false) "); // around a block
+  apply(source.size(), 0, " * 3");
+  apply(source.find("x + 2"), 5, "if (true) 1\n"); // runs into the next one
+  apply(source.find("\n{") + 1, 0, "else 2\n"); // continues the one before
+  apply(0, static_cast<uint32_t>(source.size()), "");
+  apply(0, 0, "1\n2\n3");
+}
+
+// random edits compared with parsing from scratch. An edit that breaks
+// the source is undone by another one, so most of the time it parses
+// and statements are joined and split again
+TEST(Document, RandomEdits) {
+  const char* const kPieces[] = {
+      "x", "1", " + ", "-", "\n", "{", "}", "(", ")", "if (true) ", " else ",
+      "var a = 2.\n", "while (false) ", "a = 1.\n", "'c'", ":", " = ", "var ",
+      "// comment\n", "{ a }\n", "{ 1\n", "}\n", "\nelse 1", "if (x1) { 2 }\n",
+  };
+
+  std::mt19937 random(42);
+  string source = Program(20);
+  Document document(source);
+
+  int clean = 0;
+  for (int step = 0; step < 2000; step++) {
+    auto offset = static_cast<uint32_t>(random() % (source.size() + 1));
+    auto length = static_cast<uint32_t>(
+        std::min<size_t>(random() % 3 == 0 ? random() % 8 : 0, source.size() - offset));
+    string text = random() % 4 == 0 ? "" : kPieces[random() % (sizeof(kPieces) / sizeof(*kPieces))];
+    auto removed = source.substr(offset, length);
+
+    document.Apply({offset, length, text});
+    source.replace(offset, length, text);
+    ExpectSame(document, source);
+
+    if (document.HadErrors()) {
+      document.Apply({offset, static_cast<uint32_t>(text.size()), removed});
+      source.replace(offset, text.size(), removed);
+      ExpectSame(document, source);
+    } else {
+      clean++;
+    }
+
+    if (testing::Test::HasFatalFailure()) {
+      FAIL() << "step " << step;
+    }
+  }
+
+  EXPECT_GT(clean, 500);
+}
+
+TEST(Document, ReparsesLittle) {
+  const string source = Program(10000);
+  Document document(source);
+  EXPECT_EQ(document.Reparsed(), source.size());
+
+  // the edited statement and the ones around it
+  auto offset = static_cast<uint32_t>(source.find("x5000 = (1"));
+  document.Apply({offset, 10, "x5000 = (1 + y"});
+  EXPECT_FALSE(document.HadErrors());
+  EXPECT_LT(document.Reparsed(), 200);
+  document.Apply({offset - 4, 0, "var q = 1\n"});
+  EXPECT_LT(document.Reparsed(), 200);
+
+  // an unclosed block runs to the end
+  const auto rest = source.size() - offset;
+  document.Apply({offset - 4, 0, "{ "});
+  EXPECT_GT(document.Reparsed(), rest);
+  EXPECT_LT(document.Reparsed(), 3 * rest);
+  EXPECT_TRUE(document.HadErrors());
+  document.Apply({offset - 4, 2, ""});
+  EXPECT_FALSE(document.HadErrors());
+  EXPECT_EQ(document.Units(), 3 * 10000 + 1);
+}
+
+TEST(Document, Errors) {
+  string source = Program(3) + "1 +\n" + Program(2);
+  Document document(source);
+
+  ErrorReporter reporter("file");
+  Interner interner;
+  ConstantPool constants;
+  Parser::Parse(source, reporter, interner, constants);
+  EXPECT_EQ(document.Errors("file"), reporter.GetErrors());
+
+  // lines before the error change
+  document.Apply({0, 0, "\n\n1\n"});
+  source.insert(0, "\n\n1\n");
+  ErrorReporter moved("file");
+  Parser::Parse(source, moved, interner, constants);
+  EXPECT_EQ(document.Errors("file"), moved.GetErrors());
+  EXPECT_NE(moved.GetErrors(), reporter.GetErrors());
+}
+
+}
@@ -0,0 +1,137 @@
+#include <random>
+#include <string>
+#include <gtest/gtest.h>
+#include <parser/document.hpp>
+#include <sema/document_check.hpp>
+#include "absl/strings/string_view.h"
+#include "common.hpp"
+
+namespace helium {
+namespace {
+
+using ::std::string;
+using ::absl::string_view;
+
+// the type errors and the typed tree
+string Expected(const string& source) {
+  auto scratch = FromScratch(source);
+  EXPECT_FALSE(scratch.parse_errors);
+  return scratch.type_errors + scratch.typed;
+}
+
+string Checked(Document& document, DocumentCheck& check) {
+  check.Check(document);
+  return check.GetErrors() + PrintUnits(document, true, document.GetInterner());
+}
+
+// well typed
+string Program(int statements) {
+  string source;
+  for (int i = 0; i < statements; i++) {
+    auto n = std::to_string(i);
+    source += "var x" + n + " = (1. + 2.5 * -3.) / 4.\n";
+    source += "{ var y = x" + n + "\n  if (true) { -y } else { y - 1. } }\n\n";
+    source += "while (false) x" + n + " = x" + n + " - 1.\n";
+  }
+
+  return source;
+}
+
+}
+
+TEST(DocumentCheck, Edits) {
+  string source = "var x = 1\nx + 2\n{ var y = x\n  y }\nvar z = x * 'c'\nz";
+  Document document(source);
+  DocumentCheck check("");
+  EXPECT_EQ(Checked(document, check), Expected(source));
+  EXPECT_TRUE(check.HadErrors());
+
+  auto apply = [&](uint32_t offset, uint32_t length, string_view text) {
+    document.Apply({offset, length, text});
+    source.replace(offset, length, text.data(), text.size());
+    EXPECT_EQ(Checked(document, check), Expected(source)) << source;
+  };
+
+  apply(8, 1, "2.");                 // the type of a global
+  apply(0, 0, "\n\n");               // the errors move
+  apply(source.find("'c'"), 3, "x"); // and go away
+  apply(2, 0, "var x = 3\n");        // x is redefined
+  apply(2, 10, "");
+  apply(source.find("var z"), 0, "z = 1.\n"); // before z is declared
+  apply(0, static_cast<uint32_t>(source.size()), "");
+  apply(0, 0, "a\nvar a = 1\na");
+}
+
+// random edits that keep the source well formed,
+// compared with checking it from scratch
+TEST(DocumentCheck, RandomEdits) {
+  const char* const kPieces[] = {
+      "x1", "x2", "1", "2.", "'c'", " + ", "-", "var x1 = 1\n", "var x2 = 'c'\n",
+      "x1 = 1.\n", "{ var x1 = 2\n x1 }\n", "var q = x2 + 1\n", "\n",
+  };
+
+  std::mt19937 random(7);
+  string source = Program(20);
+  Document document(source);
+  DocumentCheck check("");
+  ASSERT_EQ(Checked(document, check), Expected(source));
+
+  int checked = 0;
+  for (int step = 0; step < 1000; step++) {
+    auto offset = static_cast<uint32_t>(random() % (source.size() + 1));
+    auto length = static_cast<uint32_t>(
+        std::min<size_t>(random() % 3 == 0 ? random() % 4 : 0, source.size() - offset));
+    string text = random() % 4 == 0 ? "" : kPieces[random() % (sizeof(kPieces) / sizeof(*kPieces))];
+    auto removed = source.substr(offset, length);
+
+    document.Apply({offset, length, text});
+    source.replace(offset, length, text);
+    if (document.HadErrors()) {
+      document.Apply({offset, static_cast<uint32_t>(text.size()), removed});
+      source.replace(offset, text.size(), removed);
+      continue;
+    }
+
+    ASSERT_EQ(Checked(document, check), Expected(source)) << "step " << step;
+    checked++;
+  }
+
+  EXPECT_GT(checked, 300);
+}
+
+// only the edited units and the ones reading what changed are walked
+TEST(DocumentCheck, ChecksLittle) {
+  const string source = Program(10000);
+  Document document(source);
+  DocumentCheck check("");
+  check.Check(document);
+  EXPECT_EQ(check.Rechecked(), document.Units());
+
+  check.Check(document);
+  EXPECT_EQ(check.Rechecked(), 0);
+
+  // the edited unit, the one before it and the units after it
+  // that read the changed global
+  EXPECT_FALSE(check.HadErrors());
+  auto offset = static_cast<uint32_t>(source.find("x5000 = (1."));
+  document.Apply({offset + 9, 1, "3"});
+  check.Check(document);
+  EXPECT_EQ(check.Rechecked(), 2);
+
+  document.Apply({offset + 9, 2, "'c'"});
+  check.Check(document);
+  EXPECT_TRUE(check.HadErrors());
+  EXPECT_EQ(check.Rechecked(), 4);
+
+  // lines are inserted before the error
+  document.Apply({0, 0, "\n\n"});
+  check.Check(document);
+  EXPECT_LT(check.Rechecked(), 5);
+
+  document.Apply({offset + 2 + 9, 3, "1."});
+  check.Check(document);
+  EXPECT_FALSE(check.HadErrors());
+  EXPECT_LT(check.Rechecked(), 5);
+}
+
+}
@@ -0,0 +1,111 @@
+#include <string>
+#include <gtest/gtest.h>
+#include <parser/flat_ast.hpp>
+#include <parser/parser.hpp>
+#include <sema/type_check.hpp>
+#include <sema/type_context.hpp>
+#include "common.hpp"
+
+namespace helium {
+namespace {
+
+using ::std::string;
+
+}
+
+TEST(FlatAst, SameAsTree) {
+  for (auto source : WellFormed()) {
+    ErrorReporter reporter("");
+    Interner interner;
+    ConstantPool constants;
+    auto tree = Parser::Parse(source, reporter, interner, constants);
+    ASSERT_FALSE(reporter.HadErrors()) << source;
+
+    auto flat = FlatAst::From(tree);
+    EXPECT_EQ(PrintFlat(flat, false, interner), PrintTree(tree, false, interner));
+
+    // the same diagnostics in the same order
+    TypeContext tree_types(interner);
+    TypeCheck tree_check(reporter, tree_types);
+    for (auto* node : tree) {
+      node->Accept(tree_check);
+    }
+
+    ErrorReporter flat_reporter("");
+    flat_reporter.SetSource(source);
+    TypeContext flat_types(interner);
+    TypeCheck flat_check(flat_reporter, flat_types);
+    flat_check.Check(flat);
+
+    EXPECT_EQ(flat_reporter.GetErrors(), reporter.GetErrors()) << source;
+    EXPECT_EQ(PrintFlat(flat, true, interner), PrintTree(tree, true, interner)) << source;
+
+    // a checked tree keeps its types
+    EXPECT_EQ(PrintFlat(FlatAst::From(tree), true, interner), PrintTree(tree, true, interner));
+  }
+}
+
+TEST(FlatAst, Layout) {
+  ErrorReporter reporter("");
+  Interner interner;
+  ConstantPool constants;
+  auto tree = Parser::Parse("var x = (1 + 2) * 3\nif (true) x else -x\n{ }",
+                            reporter, interner, constants);
+  ASSERT_FALSE(reporter.HadErrors());
+
+  auto ast = FlatAst::From(tree);
+  ASSERT_EQ(ast.Roots().size(), 3);
+  EXPECT_EQ(ast.Roots()[0], 0);
+  EXPECT_EQ(ast.End(ast.Roots()[2]), ast.Size());
+
+  // var, pattern, *, +, 1, 2, 3
+  EXPECT_EQ(ast.GetKind(0), FlatAst::Kind::kVariable);
+  EXPECT_EQ(ast.GetKind(1), FlatAst::Kind::kPattern);
+  EXPECT_EQ(ast.GetKind(2), FlatAst::Kind::kBinary);
+  EXPECT_EQ(ast.Op(2), TokenType::kStar);
+  EXPECT_EQ(ast.NextSibling(ast.FirstChild(2)), 6);
+  EXPECT_EQ(ast.Roots()[1], 7);
+
+  // if, cond, then, else: -, x
+  EXPECT_EQ(ast.GetKind(7), FlatAst::Kind::kIf);
+  EXPECT_EQ(ast.End(7), 12);
+  EXPECT_TRUE(ast.IsLeaf(12));
+  EXPECT_EQ(ast.GetType(4), FlatAst::kNoType);
+
+  TypeContext types(interner);
+  TypeCheck check(reporter, types);
+  check.Check(ast);
+  EXPECT_FALSE(reporter.HadErrors());
+  EXPECT_EQ(ast.GetType(2), interner.Intern("Int"));
+  EXPECT_EQ(ast.GetIntrinsic(2), IntrinsicOp::kIntMul);
+  EXPECT_EQ(ast.GetIntrinsic(10), IntrinsicOp::kIntNeg);
+  EXPECT_EQ(ast.GetType(0), FlatAst::kNoType);
+}
+
+TEST(FlatAst, Memory) {
+  string source;
+  for (int i = 0; i < 2000; i++) {
+    auto n = std::to_string(i);
+    source += "var x" + n + " = { (1 + 2.5 * -3.) / 4 - x" + n + " }\n";
+    source += "if (x" + n + ") x" + n + " = 1 else { -x" + n + " }\n";
+  }
+
+  ErrorReporter reporter("");
+  Interner interner;
+  ConstantPool constants;
+  auto tree = Parser::Parse(source, reporter, interner, constants);
+  ASSERT_FALSE(reporter.HadErrors());
+
+  TypeContext types(interner);
+  TypeCheck check(reporter, types);
+  for (auto* node : tree) {
+    node->Accept(check);
+  }
+
+  // the types of both point into the context: 22 bytes a node
+  // against about 51, 44% of the tree
+  auto flat = FlatAst::From(tree);
+  EXPECT_LT(flat.Memory() * 20, tree.Arena().Allocated() * 9);
+}
+
+}
@@ -24,4 +24,19 @@ TEST(Interner, Intern) {
   ASSERT_FALSE(interner.LookUp(2));
 }
 
+TEST(Interner, PrecomputedHash) {
+  using ::absl::string_view;
+
+  Interner interner;
+  const string_view names[] = {"", "a", "abcdefgh", "abcdefghi", "a_rather_long_identifier_name"};
+  for (auto name : names) {
+    auto data = interner.Intern(name, Interner::Hash(name));
+    EXPECT_EQ(interner.Intern(name), data);
+  }
+
+  EXPECT_FALSE(interner.LookUp(5));
+  EXPECT_NE(Interner::Hash("abcdefgh"), Interner::Hash("abcdefgh_"));
+  EXPECT_NE(Interner::Hash("a"), Interner::Hash(string_view("a\0", 2)));
+}
+
 }
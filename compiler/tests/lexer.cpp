@@ -0,0 +1,214 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include <compiler.hpp>
+#include <parser/lexer.hpp>
+#include <parser/parser.hpp>
+#include <parser/ast_printer.hpp>
+#include "absl/strings/string_view.h"
+
+namespace helium {
+namespace {
+
+using ::std::string;
+using ::std::stringstream;
+using ::std::vector;
+using ::absl::string_view;
+using TT = TokenType;
+
+template <typename Source>
+string Parse(Source& source) {
+  ErrorReporter reporter("");
+  Interner interner;
+  ConstantPool constants;
+  stringstream ss;
+  AstPrinter printer(false, ss, interner);
+
+  for (const auto& node : Parser::Parse(source, reporter, interner, constants)) {
+    if (node) node->Accept(printer);
+  }
+
+  return ss.str() + reporter.GetErrors();
+}
+
+string Stream(const string& source, size_t window) {
+  stringstream input(source);
+  auto stream = SourceStream::FromStream(input);
+  StreamLexer lexer(stream, window);
+  return Parse(lexer);
+}
+
+// lines that often end inside a string or a comment
+string RandomLines(size_t lines, unsigned seed) {
+  static const char* kPieces[] = {
+      "var a = 1\n", "\"str\n", "ing\" + 2\n", "// \"comment\n",
+      "'\\\n", "x // y\n", "\n", "\\\"\n", "{ 3.5 }\n", "$\n",
+      "\xc3\xa9t\xc3\xa9\n", "\"\xe2\x82\xac\n", "\xff\n"
+  };
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<size_t> pick(0, sizeof(kPieces) / sizeof(*kPieces) - 1);
+
+  string result;
+  for (size_t i = 0; i < lines; i++) {
+    result += kPieces[pick(gen)];
+  }
+
+  return result;
+}
+
+void ExpectSameTokens(const TokenBuffer& actual, const TokenBuffer& expected) {
+  ASSERT_EQ(actual.Size(), expected.Size());
+  for (size_t i = 0; i < expected.Size(); i++) {
+    ASSERT_EQ(actual.Type(i), expected.Type(i)) << i;
+    ASSERT_EQ(actual.GetSpan(i).offset, expected.GetSpan(i).offset) << i;
+    ASSERT_EQ(actual.GetSpan(i).length, expected.GetSpan(i).length) << i;
+  }
+
+  ASSERT_EQ(actual.Errors().size(), expected.Errors().size());
+  for (size_t i = 0; i < expected.Errors().size(); i++) {
+    EXPECT_EQ(actual.Errors()[i].token, expected.Errors()[i].token);
+    EXPECT_EQ(actual.Errors()[i].msg, expected.Errors()[i].msg);
+  }
+}
+
+}
+
+TEST(Lexer, TokenBuffer) {
+  auto tokens = Lexer::Lex("var x = 12 // c\n  {\"s\"}");
+
+  const vector<TT> types = {
+      TT::kVar, TT::kIdentifier, TT::kEqual, TT::kInt, TT::kEol,
+      TT::kLeftBrace, TT::kString, TT::kRightBrace, TT::kEof
+  };
+  const vector<string_view> lexemes = {
+      "var", "x", "=", "12", "\n", "{", "\"s\"", "}", ""
+  };
+
+  ASSERT_EQ(tokens.Size(), types.size());
+  for (size_t i = 0; i < types.size(); i++) {
+    EXPECT_EQ(tokens.Type(i), types[i]) << i;
+    EXPECT_EQ(tokens.Lexeme(i), lexemes[i]) << i;
+    EXPECT_EQ(tokens.Hash(i), types[i] == TT::kIdentifier ? Interner::Hash(lexemes[i]) : 0) << i;
+  }
+
+  EXPECT_EQ(tokens.At(3).span.offset, 8);
+  EXPECT_EQ(tokens.At(3).span.length, 2);
+  EXPECT_EQ(tokens.At(5).span.offset, 18);
+  EXPECT_TRUE(tokens.Errors().empty());
+}
+
+TEST(Lexer, EmptySource) {
+  auto tokens = Lexer::Lex("");
+  ASSERT_EQ(tokens.Size(), 1);
+  EXPECT_EQ(tokens.Type(0), TT::kEof);
+}
+
+TEST(Lexer, Errors) {
+  auto tokens = Lexer::Lex("1 $ 02\n'a");
+
+  ASSERT_EQ(tokens.Errors().size(), 3);
+  for (const auto& error : tokens.Errors()) {
+    EXPECT_EQ(tokens.Type(error.token), TT::kError);
+  }
+
+  EXPECT_EQ(tokens.Lexeme(tokens.Errors()[0].token), "$");
+  EXPECT_EQ(tokens.Lexeme(tokens.Errors()[1].token), "02");
+  EXPECT_EQ(tokens.GetSpan(tokens.Errors()[2].token).offset, 7);
+}
+
+TEST(Lexer, ReusedBuffer) {
+  auto tokens = Lexer::Lex("1 + 2\n3");
+
+  for (int i = 0; i < 2; i++) {
+    ErrorReporter reporter("");
+    Interner interner;
+    ConstantPool constants;
+    std::stringstream ss;
+    AstPrinter printer(false, ss, interner);
+
+    for (const auto& node : Parser::Parse(tokens, reporter, interner, constants)) {
+      node->Accept(printer);
+    }
+
+    EXPECT_FALSE(reporter.HadErrors());
+    EXPECT_EQ(ss.str(), "(+ (int 1) (int 2))(int 3)");
+  }
+}
+
+TEST(Lexer, StreamSameAsBatch) {
+  const string sources[] = {
+      "",
+      "\n\n   ",
+      "var long_name = 1234567 + 89.0125 // a comment\n"
+      "{ \"a string\nthat spans lines \\\" and \\q\" }\n"
+      "if (x) '\\'' else '\"' / 2 // end",
+      "  0123 $ \"unterminated\n\n",
+      "{\n 3 \n 4 }\n{\n 3  4 \n\n }",
+      "var \xc3\xa9t\xc3\xa9 = \"\xe2\x82\xac\n\xf0\x9f\x98\x80\" + '\xf0\x9f\x98\x80'\n"
+      "\xe5\x90\x8d\xe5\x89\x8d + \xe2\x82\xac \xc3 \"\xff\" x\xcc\x81\n",
+  };
+
+  for (const auto& source : sources) {
+    auto expected = Parse(source);
+    for (size_t window = 1; window < 20; window++) {
+      EXPECT_EQ(Stream(source, window), expected) << window << ": " << source;
+    }
+    EXPECT_EQ(Stream(source, 1 << 16), expected);
+  }
+}
+
+// reading a directory fails, it doesn't look like an empty source
+TEST(Lexer, StreamReadError) {
+  int fd = open(::testing::TempDir().c_str(), O_RDONLY | O_DIRECTORY);
+  ASSERT_GE(fd, 0);
+  auto stream = SourceStream::FromFd(fd);
+  char data[16];
+  EXPECT_EQ(stream.Read(data, sizeof(data)), 0);
+  EXPECT_TRUE(stream.Failed());
+
+  // and from the compiler, which reads "-" as a stream
+  int in = dup(STDIN_FILENO);
+  ASSERT_GE(in, 0);
+  ASSERT_EQ(dup2(fd, STDIN_FILENO), STDIN_FILENO);
+  vector<uint8_t> out;
+  auto errors = Compiler::FromFile("-", out);
+  dup2(in, STDIN_FILENO);
+  close(in);
+  close(fd);
+  EXPECT_EQ(errors, string("Unable to read from file: -"));
+}
+
+TEST(Lexer, StreamLongTokens) {
+  string source = "var s = \"" + string(1000, 'x') + "\"\n// " + string(1000, 'c') +
+      "\n" + string(1000, ' ') + string(500, 'i') + " + " + string(300, '1');
+  EXPECT_EQ(Stream(source, 7), Parse(source));
+}
+
+TEST(Lexer, ParallelSameAsSequential) {
+  const string sources[] = {
+      "",
+      "\n\n\n",
+      "\"a\nb\nc\nd\ne\nf\" + 1\n2\n3\n",
+      "no newline at all",
+      RandomLines(50, 1),
+      RandomLines(2000, 2),
+      RandomLines(2000, 3),
+  };
+
+  for (const auto& source : sources) {
+    auto expected = Lexer::Lex(source);
+    for (size_t chunks : {1, 2, 3, 7, 16, 100, 5000}) {
+      for (size_t threads : {1, 4}) {
+        SCOPED_TRACE(std::to_string(chunks) + " chunks, " +
+                     std::to_string(threads) + " threads");
+        ExpectSameTokens(Lexer::LexParallel(source, chunks, threads), expected);
+      }
+    }
+  }
+}
+
+}
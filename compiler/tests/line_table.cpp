@@ -0,0 +1,34 @@
+#include <gtest/gtest.h>
+#include "line_table.hpp"
+
+namespace helium {
+
+TEST(LineTable, Lazy) {
+  LineTable lines;
+  lines.Reset("ab\n\ncd\n");
+
+  EXPECT_EQ(lines.At(0).line, 1);
+  EXPECT_EQ(lines.At(0).col, 1);
+  EXPECT_EQ(lines.At(2).line, 1); // the newline itself
+  EXPECT_EQ(lines.At(2).col, 3);
+  EXPECT_EQ(lines.At(3).line, 2);
+  EXPECT_EQ(lines.At(5).line, 3);
+  EXPECT_EQ(lines.At(5).col, 2);
+  EXPECT_EQ(lines.At(7).line, 4);
+  EXPECT_EQ(lines.At(7).col, 1);
+}
+
+TEST(LineTable, Append) {
+  LineTable lines;
+  lines.Append("ab\nc", 0);
+  lines.Append("d\n", 4);
+  lines.Append("\nef", 6);
+
+  EXPECT_EQ(lines.At(4).line, 2);
+  EXPECT_EQ(lines.At(4).col, 2);
+  EXPECT_EQ(lines.At(6).line, 3);
+  EXPECT_EQ(lines.At(8).line, 4);
+  EXPECT_EQ(lines.At(8).col, 2);
+}
+
+}
@@ -0,0 +1,139 @@
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <gtest/gtest.h>
+#include <parser/number.hpp>
+#include <parser/parser.hpp>
+#include "constant_pool.hpp"
+
+namespace helium {
+namespace {
+
+using ::std::string;
+
+// bits of the double, so that signed zeros differ
+uint64_t Bits(double value) {
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+void ExpectSameAsStrtod(const string& lexeme) {
+  double value = -1;
+  double expected = std::strtod(lexeme.c_str(), nullptr);
+  EXPECT_EQ(number::ParseReal(lexeme, &value), !std::isinf(expected)) << lexeme;
+  if (!std::isinf(expected)) {
+    EXPECT_EQ(Bits(value), Bits(expected)) << lexeme;
+  }
+}
+
+string RandomDigits(std::mt19937& gen, size_t count) {
+  std::uniform_int_distribution<int> digit(0, 9);
+  string result;
+  for (size_t i = 0; i < count; i++) {
+    result += static_cast<char>('0' + digit(gen));
+  }
+  return result;
+}
+
+}
+
+TEST(Number, Int) {
+  int64_t value;
+  ASSERT_TRUE(number::ParseInt("0", &value));
+  EXPECT_EQ(value, 0);
+  ASSERT_TRUE(number::ParseInt("1234567890", &value));
+  EXPECT_EQ(value, 1234567890);
+  ASSERT_TRUE(number::ParseInt("9223372036854775807", &value));
+  EXPECT_EQ(value, std::numeric_limits<int64_t>::max());
+
+  EXPECT_FALSE(number::ParseInt("9223372036854775808", &value));
+  EXPECT_FALSE(number::ParseInt("18446744073709551616", &value));
+  EXPECT_FALSE(number::ParseInt("100000000000000000000000", &value));
+}
+
+TEST(Number, Real) {
+  const char* lexemes[] = {
+      "0.", "0.0", "1.", "0.1", "0.5", "3.14159", "123456789.987654321",
+      "9007199254740993.", "9007199254740992.5", // halfway, round to even
+      "0.30000000000000004", "2.2250738585072011", "1.7976931348623157",
+      // long mantissas
+      "1797693134862315708145274237317043567980705675258449965989174768031.5",
+      "0.000000000000000000000000000000000000000000000000000000000000000000001",
+      "0.1000000000000000055511151231257827021181583404541015625",
+      "0.1000000000000000055511151231257827021181583404541015624",
+      "0.1000000000000000055511151231257827021181583404541015626",
+  };
+
+  for (auto lexeme : lexemes) {
+    ExpectSameAsStrtod(lexeme);
+  }
+
+  // subnormals and the limits
+  ExpectSameAsStrtod("0." + string(307, '0') + "22250738585072014");
+  ExpectSameAsStrtod("0." + string(323, '0') + "49406564584124654");
+  ExpectSameAsStrtod("0." + string(323, '0') + "24703282292062328");
+  ExpectSameAsStrtod("0." + string(400, '0') + "1");
+  ExpectSameAsStrtod("17976931348623158" + string(292, '0') + ".");
+  ExpectSameAsStrtod("2" + string(308, '0') + ".");
+}
+
+TEST(Number, RandomReals) {
+  std::mt19937 gen(7);
+  std::uniform_int_distribution<size_t> length(1, 40);
+  std::uniform_int_distribution<size_t> zeros(0, 330);
+
+  for (int i = 0; i < 20000; i++) {
+    string lexeme;
+    switch (i % 3) {
+      case 0: lexeme = RandomDigits(gen, length(gen)) + "." + RandomDigits(gen, length(gen));
+        break;
+      case 1: lexeme = "0." + string(zeros(gen), '0') + RandomDigits(gen, length(gen));
+        break;
+      default: lexeme = "1" + RandomDigits(gen, zeros(gen)) + "." + RandomDigits(gen, 3);
+    }
+
+    // the grammar has no leading zeros
+    if (lexeme[0] == '0' && lexeme[1] != '.') lexeme[0] = '1';
+    ExpectSameAsStrtod(lexeme);
+  }
+}
+
+TEST(ConstantPool, Dedup) {
+  ConstantPool pool;
+  auto one = pool.AddInt(1);
+  auto real = pool.AddReal(1.0);
+  EXPECT_NE(one, real);
+  EXPECT_EQ(pool.AddInt(1), one);
+  EXPECT_EQ(pool.AddReal(1.0), real);
+  EXPECT_NE(pool.AddReal(0.0), pool.AddReal(-0.0));
+  EXPECT_EQ(pool.Size(), 4);
+
+  EXPECT_EQ(pool.Get(one).Int(), 1);
+  EXPECT_EQ(pool.Get(real).Real(), 1.0);
+}
+
+TEST(ConstantPool, Literals) {
+  ErrorReporter reporter("");
+  Interner interner;
+  ConstantPool constants;
+  auto ast = Parser::Parse("1 + 1.0 + 1\n1.00 * 2 + 1.5", reporter, interner, constants);
+  ASSERT_FALSE(reporter.HadErrors());
+  // 1, 1.0, 2, 1.5
+  EXPECT_EQ(constants.Size(), 4);
+
+  // out of range values are errors
+  for (const string& source : {string("9223372036854775808"), string(400, '1') + ".5"}) {
+    ErrorReporter reporter("");
+    Interner interner;
+    ConstantPool constants;
+    Parser::Parse(source, reporter, interner, constants);
+    EXPECT_TRUE(reporter.HadErrors()) << source;
+    EXPECT_EQ(constants.Size(), 0);
+  }
+}
+
+}
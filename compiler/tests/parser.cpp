@@ -2,7 +2,13 @@
 // Created by vasniktel on 04.09.2019.
 //
 
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
 #include <gtest/gtest.h>
+#include <compiler.hpp>
 #include <parser/parser.hpp>
 #include <parser/ast_printer.hpp>
 #include "absl/strings/string_view.h"
@@ -10,16 +16,18 @@
 namespace helium {
 namespace {
 
+using ::std::string;
 using ::std::stringstream;
 using ::absl::string_view;
 
 void ParseTest(string_view input, string_view expected, bool success) {
   ErrorReporter reporter("");
   Interner interner;
+  ConstantPool constants;
   stringstream ss;
   AstPrinter printer(false, ss, interner);
 
-  auto ast = Parser::Parse(input, reporter, interner);
+  auto ast = Parser::Parse(input, reporter, interner, constants);
 
   if (success) {
     EXPECT_FALSE(reporter.HadErrors());
@@ -34,6 +42,61 @@ void ParseTest(string_view input, string_view expected, bool success) {
   EXPECT_EQ(ss.str(), expected);
 }
 
+// everything the parser produces, printed
+string ParseAll(string_view input, size_t slices) {
+  ErrorReporter reporter("");
+  Interner interner;
+  ConstantPool constants;
+  stringstream ss;
+  AstPrinter printer(false, ss, interner);
+
+  auto tokens = Lexer::Lex(input);
+  auto ast = slices
+      ? Parser::ParseParallel(tokens, reporter, interner, constants, slices, 4)
+      : Parser::Parse(tokens, reporter, interner, constants);
+
+  for (const auto& node : ast) {
+    node->Accept(printer);
+  }
+
+  ss << '\n' << reporter.GetErrors();
+  for (size_t name = 0; name < interner.Size(); name++) {
+    ss << *interner.LookUp(name) << ' ';
+  }
+
+  for (ConstantPool::Index index = 0; index < constants.Size(); index++) {
+    ss << constants.Get(index).bits << ' ';
+  }
+
+  return ss.str();
+}
+
+// without recursion, the trees can be very deep
+size_t Depth(const AstNode* root) {
+  size_t depth = 0;
+  std::vector<std::pair<const AstNode*, size_t>> stack = {{root, 1}};
+  while (!stack.empty()) {
+    auto top = stack.back();
+    stack.pop_back();
+    depth = std::max(depth, top.second);
+    for (size_t i = 0; auto* child = ChildAt(*top.first, i); i++) {
+      stack.push_back({child, top.second + 1});
+    }
+  }
+
+  return depth;
+}
+
+string Repeat(string_view s, size_t times) {
+  string result;
+  result.reserve(s.size() * times);
+  for (size_t i = 0; i < times; i++) {
+    result.append(s.data(), s.size());
+  }
+
+  return result;
+}
+
 #define PARSE_SUCCESS(input, expected_ast) \
     EXPECT_NO_FATAL_FAILURE(ParseTest((input), (expected_ast), true))
 
@@ -67,6 +130,32 @@ TEST(Lexer, Identifier) {
   PARSE_SUCCESS(" mdieZN3920_", "(id mdieZN3920_)");
   PARSE_SUCCESS(" __03  ", "(id __03)");
   PARSE_SUCCESS("  a__0  ", "(id a__0)");
+  PARSE_SUCCESS("\xc3\xa9t\xc3\xa9", "(id \xc3\xa9t\xc3\xa9)");
+  PARSE_SUCCESS("_\xe5\x90\x8d\xe5\x89\x8d" "2", "(id _\xe5\x90\x8d\xe5\x89\x8d" "2)");
+  PARSE_SUCCESS("x\xcc\x81", "(id x\xcc\x81)"); // combining mark continues
+  PARSE_SUCCESS("\xf0\x9d\x90\x80", "(id \xf0\x9d\x90\x80)"); // U+1D400
+  PARSE_FAILURE("\xcc\x81x"); // combining mark can't start
+  PARSE_FAILURE("\xe2\x82\xac"); // euro sign
+  PARSE_FAILURE("\xc3");
+  PARSE_FAILURE("\xc0\xaf");
+}
+
+TEST(Lexer, Keywords) {
+  EXPECT_EQ(IdentifierType("var"), TokenType::kVar);
+  EXPECT_EQ(IdentifierType("while"), TokenType::kWhile);
+  EXPECT_EQ(IdentifierType("if"), TokenType::kIf);
+  EXPECT_EQ(IdentifierType("else"), TokenType::kElse);
+  EXPECT_EQ(IdentifierType("true"), TokenType::kTrue);
+  EXPECT_EQ(IdentifierType("false"), TokenType::kFalse);
+  EXPECT_EQ(IdentifierType("unit"), TokenType::kUnit);
+
+  for (auto id : {"", "v", "va", "vars", "iff", "i", "If", "elsa",
+                  "trve", "unix", "fals", "falsee", "whale", "_while"}) {
+    EXPECT_EQ(IdentifierType(id), TokenType::kIdentifier) << id;
+  }
+
+  PARSE_SUCCESS("variable", "(id variable)");
+  PARSE_SUCCESS("if_", "(id if_)");
 }
 
 TEST(Lexer, CharLiteral) {
@@ -92,6 +181,12 @@ TEST(Lexer, CharLiteral) {
   PARSE_FAILURE("'\\\n'");
   PARSE_FAILURE("'\\\t'");
   PARSE_FAILURE("'\\\r'");
+  PARSE_SUCCESS("'\xc3\xa9'", "(char '\xc3\xa9')");
+  PARSE_SUCCESS("'\xf0\x9f\x98\x80'", "(char '\xf0\x9f\x98\x80')");
+  PARSE_SUCCESS("'\\\xe2\x82\xac'", "(char '\\\xe2\x82\xac')");
+  PARSE_FAILURE("'\xc3'");
+  PARSE_FAILURE("'\xed\xa0\x80'");
+  PARSE_FAILURE("'\xc3\xa9\xc3\xa9'");
 }
 
 TEST(Lexer, StringLiteral) {
@@ -106,6 +201,10 @@ TEST(Lexer, StringLiteral) {
   PARSE_FAILURE("\"\\\t\"");
   PARSE_FAILURE("\"\\\r\"");
   PARSE_FAILURE(R"("\")");
+  PARSE_SUCCESS("\"\xe2\x82\xac \xf0\x9f\x98\x80\"", "(string \"\xe2\x82\xac \xf0\x9f\x98\x80\")");
+  PARSE_FAILURE("\"\xff\"");
+  PARSE_FAILURE("\"ok\xe2\x82\"");
+  PARSE_FAILURE("\"\\\xc0\xaf\"");
 }
 
 TEST(Parser, AtomLiterals) {
@@ -115,13 +214,15 @@ TEST(Parser, AtomLiterals) {
 }
 
 TEST(Parser, VarStmt) {
-  PARSE_SUCCESS("var k : int \n\n", "(var k : int)");
-  PARSE_SUCCESS("var k", "(var k)");
   PARSE_SUCCESS("var k : sdd = (2 + 22)\n", "(var k : sdd (+ (int 2) (int 22)))");
   PARSE_SUCCESS("var k = 5", "(var k (int 5))");
   PARSE_SUCCESS("var qw \n\n : \n q \n = 4", "(var qw : q (int 4))");
   PARSE_FAILURE("var 34");
-  PARSE_FAILURE("var \n qw \n\n : \n q \n");
+  // the initializer is required
+  PARSE_FAILURE("var k : int \n\n");
+  PARSE_FAILURE("var k");
+  PARSE_FAILURE("var qw \n\n : \n q \n");
+  PARSE_FAILURE("var \n qw = 1");
 }
 
 TEST(Parser, IfExpr) {
@@ -192,4 +293,143 @@ TEST(Parser, Precedence) {
   PARSE_FAILURE("a + b = c");
 }
 
+TEST(Parser, ParallelSameAsSequential) {
+  string source;
+  for (int i = 0; i < 50; i++) {
+    auto n = std::to_string(i);
+    source += "var x" + n + "\n: Int = (1 + 2.5 * -" + n + ")\n\n";
+    source += "if (x" + n + ") { -x" + n + "\n}\nelse 1.0\n";
+    source += "var y" + n + "\n= { 'c'\n x }\nwhile (y) y = " + n + "\n";
+  }
+
+  const string programs[] = {
+      source,
+      source + "1 +\n2\n" + source,          // an error in the middle
+      source + "if (c) 1\n2\n" + source,     // a missing separator
+      source + "var x = 99999999999999999999\n",
+      "\n\n1\n\n2\n\n",
+      "",
+  };
+
+  for (const auto& program : programs) {
+    auto expected = ParseAll(program, 0);
+    for (size_t slices = 1; slices <= 16; slices *= 2) {
+      EXPECT_EQ(ParseAll(program, slices), expected) << slices;
+    }
+  }
+}
+
+TEST(Parser, LazyBlocks) {
+  const char* const programs[] = {
+      "var x = { 1\n { var y = 2.5\n y } }\nif (x) {} else { -x }\nwhile (x) { x = 1 }",
+      "{ { { 1 } }\n2 }\n3 + {}",
+      "{ 1 + }\n{ 2 }", // the error is reported when the body is parsed
+  };
+
+  for (auto source : programs) {
+    ErrorReporter reporter("");
+    Interner interner;
+    ConstantPool constants;
+    auto tokens = Lexer::Lex(source);
+    auto ast = Parser::ParseLazy(tokens, reporter, interner, constants);
+    EXPECT_FALSE(reporter.HadErrors());
+
+    stringstream ss;
+    AstPrinter printer(false, ss, interner);
+    for (const auto& node : ast) {
+      node->Accept(printer);
+    }
+
+    // an eager parse drops the nodes after an error, the lazy one
+    // only drops the statements with errors
+    if (!reporter.HadErrors()) {
+      ErrorReporter eager_reporter("");
+      Interner eager_interner;
+      ConstantPool eager_constants;
+      stringstream eager;
+      AstPrinter eager_printer(false, eager, eager_interner);
+      for (const auto& node : Parser::Parse(source, eager_reporter,
+                                            eager_interner, eager_constants)) {
+        node->Accept(eager_printer);
+      }
+
+      EXPECT_EQ(ss.str(), eager.str());
+      EXPECT_EQ(constants.Size(), eager_constants.Size());
+    } else {
+      EXPECT_EQ(ss.str(), "(block)(block (int 2))");
+    }
+  }
+
+  ErrorReporter reporter("");
+  Interner interner;
+  ConstantPool constants;
+  auto tokens = Lexer::Lex("{ 1 }\n{ {} }\n{");
+  auto ast = Parser::ParseLazy(tokens, reporter, interner, constants);
+
+  // an unclosed block is parsed right away
+  EXPECT_TRUE(reporter.HadErrors());
+  ASSERT_EQ(ast.size(), 2);
+  auto& block = static_cast<BlockExpr&>(*ast[1]);
+  EXPECT_FALSE(block.IsParsed());
+  ASSERT_EQ(block.Body().size(), 1);
+  EXPECT_TRUE(block.IsParsed());
+  EXPECT_FALSE(static_cast<BlockExpr&>(*block.Body()[0]).IsParsed());
+}
+
+TEST(Parser, DeepNesting) {
+  constexpr size_t kDepth = 1000000;
+  const std::pair<string, size_t> programs[] = {
+      {Repeat("(", kDepth) + "1" + Repeat(")", kDepth), 1},
+      {Repeat("-", kDepth) + "1", kDepth + 1},
+      {"1" + Repeat(" + 1", kDepth), kDepth + 1},
+      {Repeat("a = ", kDepth) + "1", kDepth + 1},
+      {Repeat("{", kDepth) + Repeat("}", kDepth), kDepth},
+      {Repeat("if (true) ", kDepth) + "1", kDepth + 1},
+      {Repeat("while (false) ", kDepth) + "1", kDepth + 1},
+  };
+
+  for (const auto& program : programs) {
+    ErrorReporter reporter("");
+    Interner interner;
+    ConstantPool constants;
+    auto ast = Parser::Parse(program.first, reporter, interner, constants);
+    ASSERT_FALSE(reporter.HadErrors()) << reporter.GetErrors();
+    ASSERT_EQ(ast.size(), 1);
+    EXPECT_EQ(Depth(ast[0]), program.second);
+  }
+
+  // errors are found at any depth
+  ErrorReporter reporter("");
+  Interner interner;
+  ConstantPool constants;
+  Parser::Parse(Repeat("(", kDepth) + "1" + Repeat(")", kDepth - 1),
+                reporter, interner, constants);
+  EXPECT_TRUE(reporter.HadErrors());
+}
+
+// the whole pipeline, the checked tree is printed too
+TEST(Parser, DeepCompile) {
+  constexpr size_t kDepth = 1000000;
+  const string programs[] = {
+      Repeat("(", kDepth) + "1" + Repeat(")", kDepth),
+      Repeat("-", kDepth) + "1.5",
+      "1" + Repeat(" * 2", kDepth),
+      Repeat("{ ", kDepth) + "'c'" + Repeat(" }", kDepth),
+      Repeat("if (true) ", kDepth) + "1",
+      Repeat("while (false) ", kDepth) + "1",
+  };
+
+  for (const auto& program : programs) {
+    stringstream printed;
+    auto* const cout = std::cout.rdbuf(printed.rdbuf());
+    std::vector<uint8_t> code;
+    const auto errors = Compiler::FromSource(program, code);
+    std::cout.rdbuf(cout);
+
+    EXPECT_FALSE(errors) << *errors;
+    EXPECT_FALSE(printed.str().empty());
+    EXPECT_FALSE(code.empty());
+  }
+}
+
 }
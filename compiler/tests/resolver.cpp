@@ -0,0 +1,80 @@
+#include <sstream>
+#include <string>
+#include <gtest/gtest.h>
+#include <parser/ast_printer.hpp>
+#include <parser/parser.hpp>
+#include <sema/resolver.hpp>
+
+namespace helium {
+namespace {
+
+using ::std::string;
+
+struct Resolved {
+  ErrorReporter reporter;
+  Interner interner;
+  ConstantPool constants;
+  AstTree ast;
+
+  explicit Resolved(const string& source)
+  : reporter(""),
+    ast(Parser::Parse(source, reporter, interner, constants)) {
+    Resolver resolver;
+    for (auto* node : ast) resolver.Resolve(*node);
+  }
+
+  string Printed() {
+    std::stringstream ss;
+    AstPrinter printer(false, true, ss, interner);
+    for (auto* node : ast) node->Accept(printer);
+    return ss.str();
+  }
+};
+
+}
+
+// names are followed by #symbol@slot
+TEST(Resolver, Slots) {
+  EXPECT_EQ(Resolved("var x = 1\n{ var y = x\n var x = y\n x = 2\n x }\nvar z = x\nz").Printed(),
+            "(var x#0@0 (int 1))"
+            "(block (var y#1@1 (id x#0@0)) (var x#2@2 (id y#1@1)) (= (id x#2@2) (int 2)) (id x#2@2))"
+            "(var z#3@1 (id x#0@0))"
+            "(id z#3@1)");
+
+  // the slots of a block are free once it ends
+  EXPECT_EQ(Resolved("{ var a = 1 }\n{ var b = 2\n b }\nvar c = 3\nc").Printed(),
+            "(block (var a#0@0 (int 1)))"
+            "(block (var b#1@0 (int 2)) (id b#1@0))"
+            "(var c#2@0 (int 3))"
+            "(id c#2@0)");
+}
+
+TEST(Resolver, Unresolved) {
+  // an initializer doesn't see the name it initializes
+  EXPECT_EQ(Resolved("a\nvar a = a\na = a").Printed(),
+            "(id a#?)(var a#0@0 (id a#?))(= (id a#0@0) (id a#0@0))");
+}
+
+TEST(Resolver, Deep) {
+  constexpr int kDepth = 100000;
+  string source;
+  for (int i = 0; i < kDepth; i++) source += "{ var x = 1\n";
+  source += "x";
+  for (int i = 0; i < kDepth; i++) source += " }";
+
+  Resolved resolved(source);
+  ASSERT_FALSE(resolved.reporter.HadErrors());
+
+  // the innermost x is the last declared one
+  AstNode* node = resolved.ast[0];
+  while (node->GetKind() == AstKind::kBlock) {
+    node = static_cast<BlockExpr*>(node)->Body().back();
+  }
+
+  ASSERT_EQ(node->GetKind(), AstKind::kIdentifier);
+  const auto resolution = static_cast<IdentifierExpr*>(node)->GetResolution();
+  EXPECT_EQ(resolution.symbol, kDepth - 1);
+  EXPECT_EQ(resolution.slot, kDepth - 1);
+}
+
+}
@@ -0,0 +1,180 @@
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <gtest/gtest.h>
+#include <parser/scan.hpp>
+#include <parser/parser.hpp>
+#include <parser/ast_printer.hpp>
+
+namespace helium {
+namespace {
+
+using ::std::string;
+using ::std::stringstream;
+using ::absl::string_view;
+
+const scan::Level kLevels[] = {
+    scan::Level::kScalar,
+    scan::Level::kSse2,
+    scan::Level::kAvx2
+};
+
+// mostly characters the scanners stop at
+string RandomSource(size_t size, unsigned seed) {
+  static const char kAlphabet[] = "aZ_09 \t\r\n\"\\'/.+{}\x80\xff";
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<size_t> pick(0, sizeof(kAlphabet) - 2);
+  std::uniform_int_distribution<size_t> run(0, 40);
+
+  string result;
+  while (result.size() < size) {
+    result.append(run(gen), kAlphabet[pick(gen)]);
+  }
+
+  result.resize(size);
+  return result;
+}
+
+// valid characters of every length with some broken bytes
+string RandomUtf8(size_t size, unsigned seed) {
+  static const char* kPieces[] = {
+      "a", "0 ", "\xc3\xa9", "\xe2\x82\xac", "\xf0\x9f\x98\x80", "\xed\x9f\xbf",
+      "\xf4\x8f\xbf\xbf", "\xef\xbf\xbf", "\xc2\x80", "\xe0\xa0\x80", "\xf0\x90\x80\x80",
+      // broken
+      "\x80", "\xc0\xaf", "\xed\xa0\x80", "\xf4\x90\x80\x80", "\xe2\x82", "\xff"
+  };
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<size_t> valid(0, 10);
+  std::uniform_int_distribution<size_t> any(0, sizeof(kPieces) / sizeof(*kPieces) - 1);
+  std::bernoulli_distribution broken(0.01);
+
+  string result;
+  while (result.size() < size) {
+    result += kPieces[broken(gen) ? any(gen) : valid(gen)];
+  }
+
+  return result;
+}
+
+// diagnostics contain line and column numbers
+string Parse(string_view source, scan::Level level) {
+  scan::Select(level);
+  ErrorReporter reporter("");
+  Interner interner;
+  ConstantPool constants;
+  stringstream ss;
+  AstPrinter printer(false, ss, interner);
+
+  for (const auto& node : Parser::Parse(source, reporter, interner, constants)) {
+    if (node) node->Accept(printer);
+  }
+
+  scan::Select(scan::BestLevel());
+  return ss.str() + reporter.GetErrors();
+}
+
+}
+
+TEST(Scan, MatchesScalar) {
+  const auto& scalar = scan::Get(scan::Level::kScalar);
+
+  for (auto level : kLevels) {
+    if (!scan::IsSupported(level)) continue;
+    const auto& table = scan::Get(level);
+
+    for (unsigned seed = 0; seed < 20; seed++) {
+      auto source = RandomSource(300, seed);
+      const char* data = source.data();
+      size_t size = source.size();
+
+      for (size_t pos = 0; pos <= size; pos++) {
+        ASSERT_EQ(table.blanks(data, pos, size), scalar.blanks(data, pos, size));
+        ASSERT_EQ(table.identifier(data, pos, size), scalar.identifier(data, pos, size));
+        ASSERT_EQ(table.digits(data, pos, size), scalar.digits(data, pos, size));
+        ASSERT_EQ(table.line(data, pos, size), scalar.line(data, pos, size));
+        ASSERT_EQ(table.string(data, pos, size), scalar.string(data, pos, size));
+        ASSERT_EQ(table.utf8(data, pos, size), scalar.utf8(data, pos, size));
+      }
+    }
+  }
+}
+
+TEST(Scan, LongRuns) {
+  for (auto level : kLevels) {
+    if (!scan::IsSupported(level)) continue;
+    const auto& table = scan::Get(level);
+
+    for (size_t size = 0; size < 100; size++) {
+      string blanks(size, ' ');
+      EXPECT_EQ(table.blanks(blanks.data(), 0, size), size);
+
+      string id(size, 'q');
+      EXPECT_EQ(table.identifier(id.data(), 0, size), size);
+
+      string body(size, '\n');
+      EXPECT_EQ(table.string(body.data(), 0, size), size);
+    }
+  }
+}
+
+TEST(Scan, Utf8) {
+  const std::pair<string, size_t> cases[] = {
+      {"", 0},
+      {"plain ascii", 11},
+      {"\xc3\xa9t\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80", 14},
+      {"a\x80", 1},               // lone continuation
+      {"ab\xc0\xaf", 2},          // overlong
+      {"\xe0\x9f\xbf", 0},         // overlong
+      {"\xf0\x8f\xbf\xbf", 0},     // overlong
+      {"x\xed\xa0\x80", 1},       // surrogate
+      {"\xf4\x90\x80\x80", 0},     // past U+10FFFF
+      {"\xf5\x80\x80\x80", 0},
+      {"abc\xe2\x82", 3},         // cut
+      {"\xe2\x82\xac\xe2\x82x", 3},
+  };
+
+  for (auto level : kLevels) {
+    if (!scan::IsSupported(level)) continue;
+    const auto& table = scan::Get(level);
+
+    for (const auto& c : cases) {
+      // the same with a long ascii prefix for the vector loops
+      string prefixed = string(61, 'p') + c.first;
+      EXPECT_EQ(table.utf8(c.first.data(), 0, c.first.size()), c.second) << c.first;
+      EXPECT_EQ(table.utf8(prefixed.data(), 0, prefixed.size()), c.second + 61) << c.first;
+    }
+
+    const auto& scalar = scan::Get(scan::Level::kScalar);
+    for (unsigned seed = 0; seed < 200; seed++) {
+      auto source = RandomUtf8(400, seed);
+      for (size_t pos = 0; pos < 40; pos++) {
+        ASSERT_EQ(table.utf8(source.data(), pos, source.size()),
+                  scalar.utf8(source.data(), pos, source.size())) << seed;
+      }
+    }
+  }
+}
+
+TEST(Scan, SameDiagnostics) {
+  const string sources[] = {
+      "var a = \"first line\nsecond line\n\\\n\" + )\n",
+      "   // comment that is long enough for a couple of vector blocks\n"
+      "longidentifier_with_digits_0123456789 = 12345678901234567890.5 +\n"
+      "                                          '\n",
+      "{\n\t\t\"\\q\" 2\n}\n  \"unterminated\n\n\n",
+      "var \xc3\xa9t\xc3\xa9 = \"\xe2\x82\xac\xff\" + '\xc3\xa9' + \xe2\x82\xac\n",
+      RandomUtf8(5000, 7),
+      RandomSource(5000, 42)
+  };
+
+  for (const auto& source : sources) {
+    auto expected = Parse(source, scan::Level::kScalar);
+    for (auto level : kLevels) {
+      if (!scan::IsSupported(level)) continue;
+      EXPECT_EQ(Parse(source, level), expected);
+    }
+  }
+}
+
+}
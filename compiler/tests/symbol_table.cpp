@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+#include <sema/symbol_table.hpp>
+#include <sema/type_context.hpp>
+
+namespace helium {
+
+TEST(SymbolTable, Shadowing) {
+  Interner interner;
+  TypeContext types(interner);
+  SymbolTable symbols;
+  const auto x = interner.Intern("x");
+  const auto y = interner.Intern("y");
+
+  EXPECT_FALSE(symbols.Lookup(x));
+  EXPECT_TRUE(symbols.Declare(x, types.Int()));
+  EXPECT_FALSE(symbols.Declare(x, types.Real()));
+  EXPECT_EQ(*symbols.Lookup(x), types.Int());
+
+  symbols.Enter();
+  EXPECT_EQ(*symbols.Lookup(x), types.Int());
+  EXPECT_TRUE(symbols.Declare(x, types.Real()));
+  EXPECT_TRUE(symbols.Declare(y, nullptr));
+  EXPECT_EQ(*symbols.Lookup(x), types.Real());
+  EXPECT_EQ(*symbols.Lookup(y), nullptr);
+
+  symbols.Enter();
+  EXPECT_TRUE(symbols.Declare(x, types.Char()));
+  EXPECT_EQ(*symbols.Lookup(x), types.Char());
+  symbols.Exit();
+
+  EXPECT_EQ(*symbols.Lookup(x), types.Real());
+  symbols.Exit();
+
+  EXPECT_EQ(*symbols.Lookup(x), types.Int());
+  EXPECT_FALSE(symbols.Lookup(y));
+
+  // a name left with its scope can be bound again
+  symbols.Enter();
+  EXPECT_TRUE(symbols.Declare(y, types.Bool()));
+  EXPECT_EQ(*symbols.Lookup(y), types.Bool());
+  symbols.Exit();
+}
+
+TEST(SymbolTable, Deep) {
+  constexpr int kDepth = 100000;
+  Interner interner;
+  TypeContext types(interner);
+  SymbolTable symbols;
+  const auto x = interner.Intern("x");
+  const auto y = interner.Intern("y");
+
+  symbols.Declare(y, types.Unit());
+  for (int i = 0; i < kDepth; i++) {
+    symbols.Enter();
+    symbols.Declare(x, i % 2 ? types.Int() : types.Real());
+  }
+
+  EXPECT_EQ(*symbols.Lookup(x), types.Int());
+  EXPECT_EQ(*symbols.Lookup(y), types.Unit());
+  for (int i = 0; i < kDepth; i++) symbols.Exit();
+  EXPECT_FALSE(symbols.Lookup(x));
+}
+
+}
@@ -2,9 +2,155 @@
 // Created by vasniktel on 20.09.2019.
 //
 
+#include <sstream>
+#include <string>
 #include "gtest/gtest.h"
+#include <parser/ast_printer.hpp>
+#include <parser/flat_ast.hpp>
+#include <parser/parser.hpp>
+#include <sema/type_check.hpp>
+#include <sema/type_context.hpp>
 
 namespace helium {
+namespace {
 
+using ::std::string;
+
+string Repeat(const string& s, size_t times) {
+  string result;
+  for (size_t i = 0; i < times; i++) {
+    result += s;
+  }
+
+  return result;
+}
+
+}
+
+TEST(TypeCheck, DeepNesting) {
+  constexpr size_t kDepth = 1000000;
+  const std::pair<string, const char*> programs[] = {
+      {Repeat("(", kDepth) + "1" + Repeat(")", kDepth), "Int"},
+      {Repeat("-", kDepth) + "1.5", "Real"},
+      {"1" + Repeat(" * 2", kDepth), "Int"},
+      {Repeat("{ ", kDepth) + "'c'" + Repeat(" }", kDepth), "Char"},
+      {Repeat("if (true) ", kDepth) + "1", "Unit"},
+  };
+
+  for (const auto& program : programs) {
+    ErrorReporter reporter("");
+    Interner interner;
+    ConstantPool constants;
+    auto ast = Parser::Parse(program.first, reporter, interner, constants);
+    ASSERT_FALSE(reporter.HadErrors());
+
+    TypeContext types(interner);
+    TypeCheck check(reporter, types);
+    ast[0]->Accept(check);
+    EXPECT_FALSE(reporter.HadErrors()) << reporter.GetErrors();
+
+    const auto* type = static_cast<const Expr*>(ast[0])->GetType();
+    ASSERT_TRUE(Is<SingleType>(type));
+    EXPECT_EQ(*interner.LookUp(Cast<SingleType>(type)->GetTypeData()), program.second);
+
+    // the flat ast is built and checked without recursion as well
+    auto flat = FlatAst::From(ast);
+    EXPECT_EQ(flat.End(0), flat.Size());
+    TypeContext flat_types(interner);
+    TypeCheck flat_check(reporter, flat_types);
+    flat_check.Check(flat);
+    EXPECT_FALSE(reporter.HadErrors());
+    EXPECT_EQ(flat.GetType(0), Cast<SingleType>(type)->GetTypeData());
+  }
+}
+
+// expressions of equal types point to the same instance of the context
+TEST(TypeCheck, CanonicalTypes) {
+  ErrorReporter reporter("");
+  Interner interner;
+  ConstantPool constants;
+  auto ast = Parser::Parse("var x: Int = 1\n{ var y = x + 2\n y }\n1.5 * 2.\nx = 3",
+                           reporter, interner, constants);
+  ASSERT_FALSE(reporter.HadErrors());
+
+  TypeContext types(interner);
+  TypeCheck check(reporter, types);
+  for (auto* node : ast) node->Accept(check);
+  ASSERT_FALSE(reporter.HadErrors()) << reporter.GetErrors();
+
+  auto type_of = [](const AstNode* node) {
+    return static_cast<const Expr*>(node)->GetType();
+  };
+
+  EXPECT_EQ(type_of(static_cast<VariableStmt*>(ast[0])->GetExpr()), types.Int());
+  EXPECT_EQ(type_of(ast[1]), types.Int());
+  EXPECT_EQ(type_of(ast[2]), types.Real());
+  EXPECT_EQ(types.Single(interner.Intern("Real")), types.Real());
+  EXPECT_NE(types.Single(interner.Intern("Foo")), types.Error());
+  EXPECT_EQ(types.Canonical(types.Int()), types.Int());
+}
+
+// units are checked on several threads with the result of a sequential check
+TEST(TypeCheck, ParallelUnits) {
+  // statements of 8 groups of names, with errors
+  string source;
+  for (int i = 0; i < 4000; i++) {
+    const auto name = [&](int n) {
+      return "x" + std::to_string(i % 8) + "_" + std::to_string(n);
+    };
+
+    const int n = i / 8;
+    switch (n % 5) {
+      case 0: source += "var " + name(n) + ": Int = " + (i % 8 < 4 ? "1" : "1.5"); break;
+      case 1: source += name(n - 1) + " + 1"; break;
+      case 2: source += "{ var y = " + name(n - 2) + " * 2\n y }"; break;
+      case 3: source += "var " + name(n - 3) + " = 'c'"; break;
+      case 4: source += name(n + 1) + " = 1"; break;
+    }
+
+    source += i % 10 == 9 ? "\n1 + 'c'\n" : "\n";
+  }
+
+  auto check = [&](size_t threads) {
+    ErrorReporter reporter("");
+    Interner interner;
+    ConstantPool constants;
+    auto ast = Parser::Parse(source, reporter, interner, constants);
+    EXPECT_FALSE(reporter.HadErrors());
+    EXPECT_FALSE(ast.IsLazy());
+
+    TypeContext types(interner);
+    if (threads) {
+      TypeCheck::CheckParallel(ast, reporter, types, threads);
+    } else {
+      TypeCheck check(reporter, types);
+      for (auto* node : ast) node->Accept(check);
+    }
+
+    std::stringstream ss;
+    AstPrinter printer(true, ss, interner);
+    for (auto* node : ast) node->Accept(printer);
+    return reporter.GetErrors() + ss.str();
+  };
+
+  const auto expected = check(0);
+  EXPECT_NE(expected.find("Redefinition"), string::npos);
+  EXPECT_EQ(check(1), expected);
+  EXPECT_EQ(check(4), expected);
+
+  // a lazy tree is checked sequentially whatever the cores
+  ErrorReporter reporter("");
+  Interner interner;
+  ConstantPool constants;
+  auto tokens = Lexer::Lex(source);
+  auto ast = Parser::ParseLazy(tokens, reporter, interner, constants);
+  ASSERT_TRUE(ast.IsLazy());
+  TypeContext types(interner);
+  TypeCheck::Check(ast, reporter, types);
+  std::stringstream ss;
+  AstPrinter printer(true, ss, interner);
+  for (auto* node : ast) node->Accept(printer);
+  EXPECT_EQ(reporter.GetErrors() + ss.str(), expected);
+}
 
 }
@@ -1,3 +1,4 @@
+#include <cstring>
 #include <iostream>
 #include <string>
 #include <compiler.hpp>
@@ -5,14 +6,20 @@
 using namespace std;
 using ::helium::Compiler;
 
-int main() {
+// Compiles each line of the input on its own. Lines are checked and
+// compiled while they are parsed, --tree prints the checked tree of
+// each line instead
+int main(int argc, char** argv) {
+  const bool tree = argc > 1 && strcmp(argv[1], "--tree") == 0;
   vector<uint8_t> dummy;
   for (string s; getline(cin, s);) {
     s += "\n";
-    if (auto error = Compiler::FromSource(s, dummy)) {
+    auto error = tree ? Compiler::FromSource(s, dummy)
+                      : Compiler::FromSourceSinglePass(s, dummy);
+    if (error) {
       cout << error.value();
     }
     cout << endl;
   }
   return 0;
-}
\ No newline at end of file
+}